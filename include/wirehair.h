@@ -33,6 +33,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
 #define WIREHAIR_VERSION 3
 
 /*
@@ -61,17 +63,34 @@ typedef void *wirehair_state;
  * start to overflow, so too many blocks is unsupported.  The most efficient values
  * for N are around 1000.
  *
+ * Building the library with WIREHAIR_LARGE_N defined widens those variables so that
+ * N can be up to 1000000.  Such a build produces the same blocks as the normal one
+ * for N <= 64000.  Above that the solver time grows faster than N, and there are no
+ * tables of peel seeds, so the codec solves the matrix to find one that works for N.
+ * The encoder only does extra work for the few N that need a backup seed.  The first
+ * decoder for each N has to do it before reading any blocks, which takes about as long
+ * as encoding with small blocks, and later ones reuse the seed.  For speed, the large
+ * object functions below are usually better.
+ *
  * Pass 0 for reuse_E if you do not want to reuse a state object.
  *
  * Preconditions:
  * 	N >= 2
- * 	N <= 64000
+ * 	N <= 64000 (or 1000000 with WIREHAIR_LARGE_N)
  *
  * Returns a valid state object on success.
  * Returns 0 on failure.
  */
 extern wirehair_state wirehair_encode(wirehair_state reuse_E, const void *message, int bytes, int block_bytes);
 
+/*
+ * Same as wirehair_encode(), but bytes is a size_t, so a message of large
+ * blocks can be bigger than 2 GB.  The preconditions on N are the same.
+ * Byte offsets are computed in size_t inside the codec, so any message
+ * that fits in memory can be encoded.
+ */
+extern wirehair_state wirehair_encode64(wirehair_state reuse_E, const void *message, size_t bytes, int block_bytes);
+
 /*
  * Returns the number of blocks N in the encoded message.
  */
@@ -83,6 +102,14 @@ extern int wirehair_count(wirehair_state E);
  * The first id < N blocks are the same as the input data.  This can be
  * used to run the encoder in parallel with normal data transmission.
  *
+ * Thread safety: After wirehair_encode() returns, any number of threads
+ * may call wirehair_write() and wirehair_count() on the same encoder at
+ * once.  They only read the encoder state, apart from taking blocks out
+ * of the repair ring atomically, so one encoder can feed senders on every
+ * core.  No other function may be called on the state object while they
+ * run, except wirehair_peek() and wirehair_pop() from one thread, and the
+ * message must stay unmodified.
+ *
  * Preconditions:
  *	block pointer has block_bytes of space available to store data
  *
@@ -91,6 +118,108 @@ extern int wirehair_count(wirehair_state E);
  */
 extern int wirehair_write(wirehair_state E, unsigned int id, void *block);
 
+/*
+ * Release encoder memory that is only needed while encoding the message.
+ *
+ * After wirehair_encode() succeeds, wirehair_write() and wirehair_count()
+ * only need the recovery blocks and the message.  This frees the peeling
+ * workspace (about 100 bytes per block) and the solver matrices, which can
+ * be larger than the recovery blocks themselves when blocks are small.
+ *
+ * The state object can still be passed as reuse_E to wirehair_encode(),
+ * which will allocate the released memory again.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, including decoder state objects.
+ */
+extern int wirehair_trim(wirehair_state E);
+
+/*
+ * Replace some blocks of the message and update the encoder to match.
+ *
+ * blocks[i] holds the new data for block ids[i], and ids are less than N.
+ * The last block only has the bytes of the message that fall in it.
+ *
+ * The check matrix only depends on the message size, so the encoder keeps
+ * the matrix solved by wirehair_encode() and only generates its recovery
+ * blocks again.  This is much faster than encoding the new message when
+ * blocks are small, and still saves about a sixth for 1300-byte blocks.
+ *
+ * The first update copies the message into the encoder, which uses its
+ * own copy from then on, so the caller's message is never written and may
+ * be freed.  Precomputed blocks from wirehair_precompute() are dropped.
+ *
+ * Preconditions:
+ *	E is an encoder returned by wirehair_encode(), and not trimmed
+ *	by wirehair_trim() or created by wirehair_encode_many()
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input or out of memory.
+ */
+extern int wirehair_update_blocks(wirehair_state E, const unsigned int *ids, const void * const *blocks, int count);
+
+/*
+ * Precompute upcoming repair blocks in the background.
+ *
+ * This keeps a ring of count repair blocks for ids first_id, first_id + 1,
+ * and so on, so that wirehair_write() for those ids is a memcpy and does
+ * not add encoding time to the send path.  Writing an id also releases
+ * the ring slots of any earlier ids that were skipped.
+ *
+ * With an executor set by wirehair_set_executor(), the ring is filled by
+ * a background task that is submitted again each time half of the ring
+ * has been used.  Without one, the ring is filled before this returns,
+ * and calling it again with the same first_id and count fills the free
+ * slots, for example from a thread owned by the application.
+ *
+ * Pass a count of 0 to stop precomputing and free the ring.  Starting a
+ * new ring, wirehair_encode() and wirehair_free() stop the old one.
+ *
+ * Preconditions:
+ *	E is an encoder returned by wirehair_encode()
+ *	first_id is at least N, so that the ring only holds repair blocks
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input or out of memory.
+ */
+extern int wirehair_precompute(wirehair_state E, unsigned int first_id, int count);
+
+/*
+ * Get the next precomputed repair block without copying it.
+ *
+ * The block stays valid until wirehair_pop() is called.  Only one thread
+ * may peek and pop at a time.  Ids are returned in order, starting from
+ * the first_id passed to wirehair_precompute().
+ *
+ * Returns a pointer to block_bytes of data and sets id on success.
+ * Returns 0 if the next block is not ready yet or there is no ring.
+ */
+extern const void *wirehair_peek(wirehair_state E, unsigned int *id);
+
+/*
+ * Release the block returned by wirehair_peek() so that its slot can be
+ * filled with the next repair block.
+ */
+extern void wirehair_pop(wirehair_state E);
+
+/*
+ * Encode many independent messages at once, with the same block_bytes.
+ *
+ * This is equivalent to calling wirehair_encode() followed by
+ * wirehair_trim() for each message, where encoders[i] is passed as reuse_E
+ * and receives the new state object.  Entries that fail are set to 0.
+ *
+ * With an executor set by wirehair_set_executor(), one task is started
+ * per worker and each task keeps claiming the next message until none
+ * are left.  Each thread solves its messages with one set of solver
+ * memory that is kept between calls, and per-N tables are shared, so
+ * encoding many small messages mostly avoids allocation and setup.
+ * That memory is released by wirehair_pool_flush() on the same thread.
+ *
+ * Returns the number of messages encoded successfully.
+ */
+extern int wirehair_encode_many(wirehair_state *encoders, const void * const *messages, const int *bytes, int count, int block_bytes);
+
 /*
  * Initialize a decoder for a message of size bytes with block_bytes bytes
  * per received block.
@@ -102,6 +231,53 @@ extern int wirehair_write(wirehair_state E, unsigned int id, void *block);
  */
 extern wirehair_state wirehair_decode(wirehair_state reuse_E, int bytes, int block_bytes);
 
+/*
+ * Same as wirehair_decode(), but bytes is a size_t, for the messages
+ * produced by wirehair_encode64().  The decoder keeps a copy of every
+ * received block, so it needs about twice the message size in memory.
+ */
+extern wirehair_state wirehair_decode64(wirehair_state reuse_E, size_t bytes, int block_bytes);
+
+/*
+ * Reset a decoder to receive a new message of the same size.
+ *
+ * This keeps the matrix parameters and memory of the decoder, so it is
+ * much cheaper than initializing it again: it runs in constant time.
+ * Passing a decoder as reuse_E to wirehair_decode() with the same bytes
+ * and block_bytes does the same thing.
+ *
+ * Returns non-zero on success.
+ * Returns 0 if E is not an initialized decoder.
+ */
+extern int wirehair_decode_reset(wirehair_state E);
+
+/*
+ * Declare the ids of blocks that are expected to arrive next, before their
+ * data, for example when a retransmission of known repair ids has been
+ * scheduled.
+ *
+ * The rows of the decoder matrix depend only on block ids, so this peels
+ * the expected rows and, once N rows are accounted for, solves the matrix
+ * right away.  When the expected blocks are later passed to wirehair_read()
+ * their data is just stored, and the last one only has to generate the
+ * recovery blocks, which cuts the time from the final block to completion.
+ *
+ * List ids in the order they are expected to arrive, leaving out ids
+ * that were already read.  The first ids up to N blocks in total are
+ * solved for, and up to 32 more are kept as spares in case some of those
+ * are lost.  If every spare arrives before the expected blocks are all
+ * in, or a block that was not listed arrives, the missing ones are
+ * assumed lost and the decoder goes back to collecting blocks normally,
+ * keeping all of the blocks it received.
+ *
+ * This may be called more than once per message.  Do not use it with
+ * wirehair_deposit() or wirehair_decode_async().
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, or if N blocks were already read or expected.
+ */
+extern int wirehair_expect(wirehair_state E, const unsigned int *ids, int count);
+
 /*
  * Feed a block to the decoder.
  *
@@ -115,6 +291,95 @@ extern wirehair_state wirehair_decode(wirehair_state reuse_E, int bytes, int blo
  */
 extern int wirehair_read(wirehair_state E, unsigned int id, const void *block);
 
+/*
+ * Feed the decoder original blocks that are already known locally, such
+ * as the unchanged blocks of an older version of the message.
+ *
+ * Block i is marked by bit (i & 7) of bitmap[i / 8], which holds (N + 7) / 8
+ * bytes, and is read from message + i * block_bytes.  message is laid out
+ * like the message being decoded, and the last block only has the bytes
+ * of the message that fall in it.  The blocks are copied in one pass, so
+ * message may be freed after this returns.
+ *
+ * After seeding K blocks, about N - K more blocks are needed, so only the
+ * difference has to be sent.  Leave out blocks that were already read.
+ * Do not use it with wirehair_expect(), wirehair_deposit() or
+ * wirehair_decode_async().
+ *
+ * Returns non-zero when decoding is complete.
+ * Returns 0 on invalid input or not enough data received yet.
+ */
+extern int wirehair_seed_known(wirehair_state E, const unsigned char *bitmap, const void *message);
+
+/*
+ * Number of blocks the decoder still needs, for example to ask the sender
+ * for exactly that many repair blocks over a feedback channel.
+ *
+ * Before N blocks are read it returns N minus the blocks read so far,
+ * which is usually enough.  Once N blocks are read and decoding failed,
+ * it returns the number of pivots the matrix solver is missing, which is
+ * a lower bound that is almost always exact, and usually 1.  Blocks passed
+ * to wirehair_expect() that have not arrived yet are added to the count.
+ *
+ * Do not use it with wirehair_deposit() or wirehair_decode_async(),
+ * where blocks are only counted once the N-th one arrives.
+ *
+ * Returns 0 when decoding is complete or on invalid input.
+ */
+extern int wirehair_needed(wirehair_state E);
+
+/*
+ * Feed a block to the decoder from one of several threads.
+ *
+ * This works like wirehair_read(), but any number of threads may call it
+ * at the same time on one decoder, for example one thread per receive
+ * queue.  The first N blocks are copied into their own slots in parallel
+ * without a lock.  The thread that finishes copying the N-th block then
+ * peels and solves on its own; the other threads return right away.
+ * Blocks that arrive while a thread is solving are dropped like lost
+ * packets instead of waiting.
+ *
+ * Do not mix wirehair_read() and wirehair_deposit() on the same message.
+ * Call wirehair_reconstruct() after any thread sees a non-zero return.
+ *
+ * Preconditions:
+ *	block pointer has block_bytes of space available to store data
+ *
+ * Returns non-zero when decoding is complete.
+ * Returns 0 on invalid input or not enough data received yet.
+ */
+extern int wirehair_deposit(wirehair_state E, unsigned int id, const void *block);
+
+/*
+ * Called once when a background solve finishes.  success is non-zero if
+ * the message was decoded, and 0 if the decoder failed.
+ */
+typedef void (*wirehair_callback)(void *context, int success);
+
+/*
+ * Solve on an executor worker instead of the threads that feed blocks.
+ *
+ * After this call, feed the decoder with wirehair_deposit().  The call that
+ * completes the N-th block starts the solve on the executor set by
+ * wirehair_set_executor() and returns 0 right away.  Blocks that arrive
+ * during the solve are copied into a small queue, and if the solve needs
+ * more rows the worker uses them automatically.  If the queue is full,
+ * extra blocks are dropped like lost packets.  So wirehair_deposit() only
+ * ever copies a block, and never waits for the solver.
+ *
+ * The callback runs on the worker.  After it reports success, call
+ * wirehair_reconstruct() from any thread.  It must not free or reset the
+ * decoder itself, since freeing waits for the worker to return.
+ *
+ * Call it after wirehair_decode() or wirehair_decode_reset(), before any
+ * blocks are fed.  It applies to the current message only.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, if blocks were already fed, or if no
+ * executor has been set.
+ */
+extern int wirehair_decode_async(wirehair_state E, wirehair_callback callback, void *context);
+
 /*
  * Reconstruct the message after reading is complete.
  *
@@ -138,11 +403,434 @@ extern int wirehair_reconstruct(wirehair_state E, void *message);
  */
 extern int wirehair_reconstruct_block(wirehair_state E, unsigned int id, void *block);
 
+/*
+ * Reconstruct bytes [offset, offset + bytes) of a single block of the
+ * message after reading is complete.
+ *
+ * Only the requested bytes of the blocks it depends on are read, so a
+ * small read from a large block costs in proportion to its size.
+ *
+ * Preconditions:
+ *	out buffer contains enough space to hold the range (bytes)
+ *	the range is within the block, which is shorter for the last block
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input.
+ */
+extern int wirehair_reconstruct_range(wirehair_state E, unsigned int id, unsigned int offset, unsigned int bytes, void *out);
+
+/*
+ * Reconstruct several byte ranges of the message after reading is
+ * complete.  Range ii covers bytes [offsets[ii], offsets[ii] + bytes[ii])
+ * of the message and is written to outs[ii].  Ranges may span blocks.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, such as a range past the end of the message.
+ */
+extern int wirehair_reconstruct_ranges(wirehair_state E, const size_t *offsets, const size_t *bytes, void * const *outs, int count);
+
 /*
  * Free memory associated with a state object
+ *
+ * If a pool budget is set with wirehair_pool_budget(), the object may be
+ * kept in the pool of the calling thread instead of being freed.
  */
 extern void wirehair_free(wirehair_state E);
 
+/*
+ * Set the number of bytes of state objects each thread may keep pooled.
+ *
+ * With a pool, wirehair_free() keeps state objects in a free list owned by
+ * the calling thread as long as the pooled memory stays within the budget.
+ * wirehair_encode() and wirehair_decode() called with reuse_E = 0 then take
+ * a warm object from the pool whose buffers already fit the new message,
+ * instead of allocating a new one.  This avoids allocator traffic for
+ * applications that encode and decode many short-lived messages.
+ *
+ * The budget is 0 by default, which disables pooling.  It is shared by all
+ * threads and may be changed from any thread at any time, even while other
+ * threads free state objects.  A new budget applies to objects freed after
+ * it is set, and objects already pooled stay until they are taken again or
+ * wirehair_pool_flush() is called.
+ */
+extern void wirehair_pool_budget(unsigned int bytes);
+
+/*
+ * Free all state objects pooled by the calling thread.
+ *
+ * Pools are per-thread, so a thread that frees state objects with a pool
+ * budget set should call this before it exits to avoid leaking them.
+ * This also frees the solver memory that wirehair_encode_many() keeps
+ * on the calling thread, so executor worker threads should call it too.
+ */
+extern void wirehair_pool_flush();
+
+
+/*
+ * Task handed to an executor: Run it by calling task(job, index).
+ */
+typedef void (*wirehair_task)(void *job, int index);
+
+/*
+ * Executor interface for running the parallel parts of the codec on the
+ * thread pool of the application, instead of the calling thread.
+ *
+ * For each batch of work the codec calls submit() once per task and then
+ * wait() once.  wait() must return after every task submitted for that
+ * job has finished running, and it may run queued tasks itself.  Batches
+ * are never nested, and the codec does not use any other threads.
+ *
+ * The repair ring of wirehair_precompute() and the background solve of
+ * wirehair_decode_async() are the exception: their tasks are submitted on
+ * their own and may keep running after the call that submitted them
+ * returns.  wait() is called for them when the state object is reset,
+ * reused or freed.
+ *
+ * grain_bytes is roughly how many bytes of block operations the task
+ * will perform.  The codec picks it from N and the block size so that
+ * tasks are large enough to be worth scheduling, and there are only a
+ * few tasks per worker.  It can be used for load balancing or for
+ * accounting of core time.
+ */
+typedef struct
+{
+	void *context;		/* Passed to submit() and wait() */
+	int worker_count;	/* Number of tasks that can run at once, including the calling thread */
+
+	void (*submit)(void *context, wirehair_task task, void *job, int index, unsigned int grain_bytes);
+	void (*wait)(void *context, void *job);
+} wirehair_executor;
+
+/*
+ * Set the executor used by state objects for recovery block generation
+ * and reconstruction, and by wirehair_encode_many(), or pass 0 to run
+ * everything on the calling thread.
+ * The codec is serial by default, and an executor with a worker_count
+ * of 1 or less is ignored.
+ *
+ * The executor structure is copied.  Set it once during startup, before
+ * any state objects are created.  wirehair_encode() and wirehair_decode()
+ * apply the current executor to the state objects they initialize.
+ */
+extern void wirehair_set_executor(const wirehair_executor *executor);
+
+
+/*
+ * Large objects
+ *
+ * A single state object is limited to N <= 64000 blocks.  These functions
+ * code larger objects, up to 2^32 - 1 blocks, by splitting them into the
+ * fewest segments of at most 64000 blocks with sizes that differ by at
+ * most one block.  Block ids are interleaved across the segments so that
+ * a burst of losses is spread over all of them.  Segments are encoded and
+ * decoded in parallel on the executor set by wirehair_set_executor().
+ *
+ * Ids below wirehair_object_count() are the original data and higher ids
+ * are repair blocks.  With S segments, id i is block i / S of segment
+ * i % S, so the original ids are not in object order when S > 1: use
+ * wirehair_object_offset() to find the data for an id.  Each segment has
+ * its own small overhead, so the receiver needs a few more blocks in
+ * total than a single state object would.
+ */
+typedef void *wirehair_object;
+
+/*
+ * Encode the given object into blocks of size block_bytes.
+ *
+ * The object is used in place, so it must stay unmodified until
+ * wirehair_object_free() is called.
+ *
+ * Returns a valid object encoder on success.
+ * Returns 0 on failure.
+ */
+extern wirehair_object wirehair_object_encode(const void *object, size_t bytes, int block_bytes);
+
+/*
+ * Returns the number of blocks in the encoded object, CEIL(bytes / block_bytes).
+ */
+extern unsigned int wirehair_object_count(wirehair_object O);
+
+/*
+ * Find where the data for an original block id is in the object.
+ *
+ * Sets offset to the byte offset of the block in the object.  The block
+ * is block_bytes long, except the one that holds the end of the object,
+ * which stops there.  A sender streaming
+ * the object in order can use this to send each block under its id
+ * without calling wirehair_object_write().
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, or if id is not below wirehair_object_count().
+ */
+extern int wirehair_object_offset(wirehair_object O, unsigned int id, size_t *offset);
+
+/*
+ * Write an error correction block for the object.
+ *
+ * Like wirehair_write(), any number of threads may call this at once on
+ * the same object encoder.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input.
+ */
+extern int wirehair_object_write(wirehair_object O, unsigned int id, void *block);
+
+/*
+ * Free an object encoder.
+ */
+extern void wirehair_object_free(wirehair_object O);
+
+/*
+ * Decode an object of size bytes from count received blocks in one call.
+ *
+ * blocks[i] points to the block_bytes of data received for ids[i], and
+ * each id must appear only once.  The blocks are used in place, and each
+ * segment is decoded straight into its part of the object.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, or if some segment did not receive enough
+ * blocks.  In that case call it again after more blocks arrive.
+ */
+extern int wirehair_object_decode(size_t bytes, int block_bytes, const unsigned int *ids, const void * const *blocks, unsigned int count, void *object);
+
+
+/*
+ * Streams
+ *
+ * For live streams, where waiting to fill a whole message before sending
+ * repair blocks adds too much delay.  Source packets are numbered in order
+ * from 0 and sent as they are produced.  A repair packet covers the window
+ * of the last W source packets, and is identified by the sequence number
+ * of the last packet in its window and by its repair index, which the
+ * application sends along with it.
+ *
+ * Every repair packet whose window covers a lost packet helps to recover
+ * it, so the sender can interleave repair packets with the source packets
+ * in the ratio of the expected loss, for example one after every four.
+ * Each repair packet costs W multiply-adds of a packet to write, and the
+ * receiver only does work when packets are missing.
+ *
+ * The receiver releases packets in order as soon as they are present, so
+ * without loss there is no delay.  A packet that is still missing when a
+ * packet W sequence numbers later has been seen is skipped.
+ *
+ * All packets of a stream have the same size, block_bytes, and the window
+ * W must be the same on both sides, from 1 up to 1024.
+ *
+ * Sequence numbers are 32 bits and wrap around after 2^32 - 1, so the
+ * stream has no length limit.  The decoder takes each sequence number
+ * to be the one nearest the newest it has seen, so a packet that arrives
+ * 2^31 or more packets late is not told apart from a new one.
+ */
+typedef void *wirehair_stream;
+
+/*
+ * Create a stream encoder with the given window and packet size.
+ *
+ * Returns a valid stream encoder on success.
+ * Returns 0 on failure.
+ */
+extern wirehair_stream wirehair_stream_encoder(int window, int block_bytes);
+
+/*
+ * Set the sequence number of the first packet, for example to a random
+ * value as RTP does.  Call it on both sides before any packet is added or
+ * read, with the same value.  Without it the stream starts at 0.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, or if a packet was already added or read.
+ */
+extern int wirehair_stream_start(wirehair_stream S, unsigned int seq);
+
+/*
+ * Add the next source packet of block_bytes to the window.
+ *
+ * Packets are numbered in the order they are added, from 0 or from the
+ * value passed to wirehair_stream_start().
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input.
+ */
+extern int wirehair_stream_add(wirehair_stream S, const void *packet);
+
+/*
+ * Write a repair packet for the current window.
+ *
+ * last and index are set to the values that identify the repair packet,
+ * and must be passed to wirehair_stream_read_repair() by the receiver.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input, or if no packet was added yet.
+ */
+extern int wirehair_stream_repair(wirehair_stream S, unsigned int *last, unsigned int *index, void *block);
+
+/*
+ * Create a stream decoder with the given window and packet size.
+ *
+ * Returns a valid stream decoder on success.
+ * Returns 0 on failure.
+ */
+extern wirehair_stream wirehair_stream_decoder(int window, int block_bytes);
+
+/*
+ * Feed the decoder a source packet with its sequence number.
+ *
+ * Packets may arrive in any order, and duplicates and packets that are
+ * too late are ignored.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input.
+ */
+extern int wirehair_stream_read(wirehair_stream S, unsigned int seq, const void *packet);
+
+/*
+ * Feed the decoder a repair packet with the values from wirehair_stream_repair().
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input.
+ */
+extern int wirehair_stream_read_repair(wirehair_stream S, unsigned int last, unsigned int index, const void *block);
+
+/*
+ * Copy out the next source packet in sequence order, and set seq to its
+ * sequence number.  Packets that were given up on are skipped, so seq
+ * may jump ahead.
+ *
+ * Call this until it returns 0 after each read.  The decoder holds the
+ * last 2W packets, so packets that are left waiting longer may be lost.
+ *
+ * Returns non-zero if a packet was written.
+ * Returns 0 if the next packet is not ready yet.
+ */
+extern int wirehair_stream_pop(wirehair_stream S, unsigned int *seq, void *packet);
+
+/*
+ * Free a stream encoder or decoder.
+ */
+extern void wirehair_stream_free(wirehair_stream S);
+
+
+/*
+ * Packets
+ *
+ * For protecting a burst of datagrams of different sizes, such as the RTP
+ * packets of one video frame, without padding each of them out to the
+ * largest one.  The packets are packed back to back into one message after
+ * a table of their lengths, two bytes each, which is padded out to whole
+ * blocks, and the message is encoded as usual.
+ *
+ * The sender sends each packet as it is, along with its index and its
+ * offset from wirehair_packets_offset(), the table packets from
+ * wirehair_packets_table(), and then repair blocks of block_bytes from
+ * wirehair_packets_repair().  A table packet only carries the lengths, so
+ * the table adds two bytes per packet on the wire.  The receiver also
+ * needs the packet count and the message size, which can be sent with
+ * every packet.
+ *
+ * Each table packet is an original block of the message, so only a lost
+ * one has to be made up for by the repair blocks.  A block that holds the
+ * end of a lost packet and the start of a received one is also lost, so a
+ * lost packet usually costs one block more than its size.  Choosing
+ * block_bytes well below the typical packet size keeps that cost down.
+ *
+ * Packets may be up to 65535 bytes, and block_bytes must be even.  There
+ * must be at least two blocks in the message.
+ */
+typedef void *wirehair_packets;
+
+/*
+ * Pack the packets into a message and encode it.
+ *
+ * The packets are copied, so the caller may free them after this returns.
+ *
+ * Returns a valid packet encoder on success.
+ * Returns 0 on failure.
+ */
+extern wirehair_packets wirehair_packets_encode(const void * const *packets, const unsigned int *bytes, unsigned int count, int block_bytes);
+
+/*
+ * Returns the number of bytes in the packed message, which the receiver
+ * passes to wirehair_packets_decoder().
+ */
+extern size_t wirehair_packets_message_bytes(wirehair_packets P);
+
+/*
+ * Returns the offset of a packet in the packed message, which is sent
+ * along with the packet.
+ */
+extern unsigned int wirehair_packets_offset(wirehair_packets P, unsigned int index);
+
+/*
+ * Returns the number of table packets, which are numbered from 0.
+ */
+extern unsigned int wirehair_packets_table_count(wirehair_packets P);
+
+/*
+ * Write table packet number index, of up to block_bytes, and set bytes to
+ * its length.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input.
+ */
+extern int wirehair_packets_table(wirehair_packets P, unsigned int index, void *packet, unsigned int *bytes);
+
+/*
+ * Write repair block number index, counting from 0, of block_bytes.
+ *
+ * Returns non-zero on success.
+ * Returns 0 on invalid input.
+ */
+extern int wirehair_packets_repair(wirehair_packets P, unsigned int index, void *block);
+
+/*
+ * Create a packet decoder for a packed message.
+ *
+ * Returns a valid packet decoder on success.
+ * Returns 0 on failure.
+ */
+extern wirehair_packets wirehair_packets_decoder(size_t message_bytes, unsigned int count, int block_bytes);
+
+/*
+ * Feed the decoder a received packet with its index and offset.
+ *
+ * Returns non-zero once every lost packet can be recovered.
+ * Returns 0 if more packets or repair blocks are needed, or on invalid input.
+ */
+extern int wirehair_packets_read(wirehair_packets P, unsigned int index, unsigned int offset, const void *packet, unsigned int bytes);
+
+/*
+ * Feed the decoder a received table packet with its index.
+ *
+ * Returns non-zero once every lost packet can be recovered.
+ * Returns 0 if more packets or repair blocks are needed, or on invalid input.
+ */
+extern int wirehair_packets_read_table(wirehair_packets P, unsigned int index, const void *packet, unsigned int bytes);
+
+/*
+ * Feed the decoder a repair block with its index.
+ *
+ * Returns non-zero once every lost packet can be recovered.
+ * Returns 0 if more packets or repair blocks are needed, or on invalid input.
+ */
+extern int wirehair_packets_read_repair(wirehair_packets P, unsigned int index, const void *block);
+
+/*
+ * Copy out a packet, received or recovered, and set bytes to its length.
+ * The packet buffer must hold up to 65535 bytes.
+ *
+ * Only the blocks that overlap a lost packet are regenerated, so the
+ * packets that were received cost nothing to recover.
+ *
+ * Returns non-zero on success.
+ * Returns 0 if the packet is lost and cannot be recovered yet, or on invalid input.
+ */
+extern int wirehair_packets_recover(wirehair_packets P, unsigned int index, void *packet, unsigned int *bytes);
+
+/*
+ * Free a packet encoder or decoder.
+ */
+extern void wirehair_packets_free(wirehair_packets P);
+
 
 #ifdef __cplusplus
 }
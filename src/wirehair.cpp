@@ -36,12 +36,274 @@ using namespace std;
 #else
 #include "wirehair_codec_8.hpp"
 #endif
+#include "wirehair_segment.hpp"
+#include "wirehair_stream.hpp"
+#include "wirehair_packet.hpp"
+#include "wirehair_atomic.hpp"
 
 using namespace cat;
 using namespace wirehair;
 
 static bool m_init = false;
 
+
+//// Thread-local Codec pool
+
+static const int POOL_MAX = 32;		// Maximum number of objects pooled by each thread
+static volatile u32 m_pool_budget = 0;	// Bytes each thread may keep pooled, or 0 to disable the pool
+
+static CAT_TLS Codec *m_pool[POOL_MAX];	// Pooled objects for this thread
+static CAT_TLS int m_pool_count;		// Number of pooled objects
+static CAT_TLS size_t m_pool_bytes;	// Bytes allocated by pooled objects
+static CAT_TLS Codec *m_solver;			// Solver memory for batch encoding on this thread
+
+// Take the pooled object that best fits min_bytes, or allocate a new one
+static Codec *PoolAcquire(size_t min_bytes) {
+	// If pool is empty,
+	if (m_pool_count <= 0) {
+		return new Codec;
+	}
+
+	// Find the smallest object that is large enough, or else the largest one
+	int best_i = 0;
+	size_t best_bytes = m_pool[0]->AllocatedBytes();
+	for (int ii = 1; ii < m_pool_count; ++ii) {
+		size_t bytes = m_pool[ii]->AllocatedBytes();
+
+		// If best is too small any larger object is better, otherwise prefer smaller ones that fit
+		bool better = (best_bytes < min_bytes) ? (bytes > best_bytes) : (bytes >= min_bytes && bytes < best_bytes);
+
+		if (better) {
+			best_i = ii;
+			best_bytes = bytes;
+		}
+	}
+
+	// Remove it from the pool
+	Codec *codec = m_pool[best_i];
+	m_pool[best_i] = m_pool[--m_pool_count];
+	m_pool_bytes -= best_bytes;
+
+	return codec;
+}
+
+// Keep the object in the pool if it fits the budget, or free it
+static void PoolRelease(Codec *codec) {
+	// Stop background work before the object is reused
+	codec->StopRepairRing();
+	codec->StopAsyncSolve();
+
+	size_t bytes = codec->AllocatedBytes();
+
+	// The budget may be changed by another thread at any time
+	const u32 budget = AtomicLoad(&m_pool_budget);
+
+	// If it does not fit,
+	if (m_pool_count >= POOL_MAX || bytes > budget ||
+		m_pool_bytes + bytes > budget) {
+		delete codec;
+		return;
+	}
+
+	m_pool[m_pool_count++] = codec;
+	m_pool_bytes += bytes;
+}
+
+void wirehair_pool_budget(unsigned int bytes) {
+	AtomicStore(&m_pool_budget, bytes);
+}
+
+void wirehair_pool_flush() {
+	while (m_pool_count > 0) {
+		delete m_pool[--m_pool_count];
+	}
+
+	m_pool_bytes = 0;
+
+	if (m_solver) {
+		delete m_solver;
+		m_solver = 0;
+	}
+}
+
+
+//// Executor
+
+static wirehair_executor m_host_executor;	// Executor set by the application
+static Executor m_executor;					// Adapter from codec executor to host executor
+static bool m_has_executor = false;			// Has an executor been set?
+
+// Submit each task to the host executor and wait for them all to finish
+static void ExecutorRun(void *context, TaskFunction task, void *job, int count, u32 task_bytes) {
+	wirehair_executor *host = reinterpret_cast<wirehair_executor *>( context );
+
+	for (int ii = 0; ii < count; ++ii) {
+		host->submit(host->context, task, job, ii, task_bytes);
+	}
+
+	host->wait(host->context, job);
+}
+
+// Submit one task to the host executor without waiting for it
+static void ExecutorStart(void *context, TaskFunction task, void *job, u32 task_bytes) {
+	wirehair_executor *host = reinterpret_cast<wirehair_executor *>( context );
+
+	host->submit(host->context, task, job, 0, task_bytes);
+}
+
+// Wait for the tasks started by ExecutorStart()
+static void ExecutorFinish(void *context, void *job) {
+	wirehair_executor *host = reinterpret_cast<wirehair_executor *>( context );
+
+	host->wait(host->context, job);
+}
+
+void wirehair_set_executor(const wirehair_executor *executor) {
+	// If executor is invalid or disabled,
+	if (!executor || !executor->submit || !executor->wait ||
+		executor->worker_count <= 1) {
+		m_has_executor = false;
+		return;
+	}
+
+	m_host_executor = *executor;
+
+	m_executor.context = &m_host_executor;
+	m_executor.worker_count = executor->worker_count;
+	m_executor.run = ExecutorRun;
+	m_executor.start = ExecutorStart;
+	m_executor.finish = ExecutorFinish;
+
+	m_has_executor = true;
+}
+
+// Apply the current executor to a state object
+static void SetCodecExecutor(Codec *codec) {
+	codec->SetExecutor(m_has_executor ? &m_executor : 0);
+}
+
+
+//// Batch encoding
+
+struct EncodeManyJob {
+	wirehair_state *encoders;
+	const void * const *messages;
+	const int *bytes;
+	u32 count;
+	int block_bytes;
+	volatile u32 next;		// Number of messages claimed so far
+	volatile u32 encoded;	// Number of messages encoded successfully
+};
+
+/*
+	Each worker claims the next unclaimed message until there are none
+	left, so workers that finish early take over messages that would
+	otherwise wait behind slow ones.  Every message is solved with the
+	solver memory owned by the thread, and the encoder keeps only its
+	recovery blocks, as if wirehair_trim() had been called.
+*/
+static void EncodeManyTask(void *job, int index) {
+	EncodeManyJob *emj = reinterpret_cast<EncodeManyJob *>( job );
+
+	// Get solver memory for this thread
+	Codec *solver = m_solver;
+	if (!solver) {
+		solver = m_solver = new Codec;
+	}
+
+	u32 encoded = 0;
+
+	for (;;) {
+		// Claim next message
+		u32 ii = AtomicAdd(&emj->next, 1) - 1;
+		if (ii >= emj->count) {
+			break;
+		}
+
+		const void *message = emj->messages[ii];
+		int bytes = emj->bytes[ii];
+		Codec *codec = reinterpret_cast<Codec *>( emj->encoders[ii] );
+		Result r = R_BAD_INPUT;
+
+		if (message && bytes >= 1) {
+			// Allocate a new Codec object, warm from the pool if possible
+			if (!codec) {
+				codec = PoolAcquire(bytes);
+			}
+
+			// Already running on a worker, so do not split it further
+			codec->SetExecutor(0);
+
+			// Lend it the solver memory
+			codec->SwapSolverMemory(*solver);
+
+			r = codec->InitializeEncoder(bytes, emj->block_bytes);
+
+			if (!r) {
+				r = codec->EncodeFeed(message);
+			}
+
+			codec->SwapSolverMemory(*solver);
+		}
+
+		// On failure,
+		if (r) {
+			if (codec) {
+				PoolRelease(codec);
+			}
+			codec = 0;
+		} else {
+			++encoded;
+		}
+
+		emj->encoders[ii] = codec;
+	}
+
+	AtomicAdd(&emj->encoded, encoded);
+}
+
+int wirehair_encode_many(wirehair_state *encoders, const void * const *messages, const int *bytes, int count, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!m_init || !encoders || !messages || !bytes || count < 0 ||
+					block_bytes < 1 || block_bytes % 2 != 0) {
+		return 0;
+	}
+
+	EncodeManyJob job;
+	job.encoders = encoders;
+	job.messages = messages;
+	job.bytes = bytes;
+	job.count = count;
+	job.block_bytes = block_bytes;
+	job.next = 0;
+	job.encoded = 0;
+
+	// Start one task per worker
+	int task_count = m_has_executor ? m_host_executor.worker_count : 1;
+	if (task_count > count) {
+		task_count = count;
+	}
+
+	if (task_count > 1) {
+		// Each task encodes about an equal share of the bytes
+		u32 total_bytes = 0;
+		for (int ii = 0; ii < count; ++ii) {
+			if (bytes[ii] > 0) {
+				total_bytes += bytes[ii];
+			}
+		}
+
+		ExecutorRun(&m_host_executor, EncodeManyTask, &job, task_count, total_bytes / task_count);
+	} else {
+		EncodeManyTask(&job, 0);
+	}
+
+	return job.encoded;
+}
+
+
+//// C API
+
 int _wirehair_init(int expected_version) {
 	// If version mismatch,
 	if (expected_version != WIREHAIR_VERSION) {
@@ -54,6 +316,15 @@ int _wirehair_init(int expected_version) {
 }
 
 wirehair_state wirehair_encode(wirehair_state reuse_E, const void *message, int bytes, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(bytes < 1) {
+		return 0;
+	}
+
+	return wirehair_encode64(reuse_E, message, (size_t)bytes, block_bytes);
+}
+
+wirehair_state wirehair_encode64(wirehair_state reuse_E, const void *message, size_t bytes, int block_bytes) {
 	// If input is invalid,
 	if CAT_UNLIKELY(!m_init || !message || bytes < 1 ||
 					block_bytes < 1 || block_bytes % 2 != 0) {
@@ -62,11 +333,13 @@ wirehair_state wirehair_encode(wirehair_state reuse_E, const void *message, int
 
 	Codec *codec = reinterpret_cast<Codec *>( reuse_E );
 
-	// Allocate a new Codec object
+	// Allocate a new Codec object, warm from the pool if possible
 	if (!codec) {
-		codec = new Codec;
+		codec = PoolAcquire(bytes);
 	}
 
+	SetCodecExecutor(codec);
+
 	// Initialize codec
 	Result r = codec->InitializeEncoder(bytes, block_bytes);
 
@@ -77,7 +350,7 @@ wirehair_state wirehair_encode(wirehair_state reuse_E, const void *message, int
 
 	// On failure,
 	if (r) {
-		delete codec;
+		PoolRelease(codec);
 		codec = 0;
 	}
 
@@ -90,11 +363,29 @@ int wirehair_count(wirehair_state E) {
 		return 0;
 	}
 
-	Codec *codec = reinterpret_cast<Codec *>( E );
+	const Codec *codec = reinterpret_cast<const Codec *>( E );
 
 	return codec->BlockCount();
 }
 
+int wirehair_object_offset(wirehair_object O, unsigned int id, size_t *offset) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!O || !offset) {
+		return 0;
+	}
+
+	const SegmentedCodec *codec = reinterpret_cast<const SegmentedCodec *>( O );
+
+	// If id is not an original block,
+	if (id >= codec->BlockCount()) {
+		return 0;
+	}
+
+	*offset = (size_t)codec->BlockOffset(id);
+
+	return -1;
+}
+
 int wirehair_write(wirehair_state E, unsigned int id, void *block) {
 	// If input is invalid,
 	if CAT_UNLIKELY(!E || !block) {
@@ -103,12 +394,95 @@ int wirehair_write(wirehair_state E, unsigned int id, void *block) {
 
 	Codec *codec = reinterpret_cast<Codec *>( E );
 
-	codec->Encode(id, block); // Returns bytes written
+	// If the block was not precomputed,
+	if (!codec->ReadRepairRing(id, block)) {
+		codec->Encode(id, block); // Returns bytes written
+	}
+
+	return -1;
+}
+
+int wirehair_precompute(wirehair_state E, unsigned int first_id, int count) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || count < 0) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->StartRepairRing(first_id, count)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+const void *wirehair_peek(wirehair_state E, unsigned int *id) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !id) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	u32 block_id;
+	const u8 *block = codec->PeekRepairRing(block_id);
+
+	if (block) {
+		*id = block_id;
+	}
+
+	return block;
+}
+
+void wirehair_pop(wirehair_state E) {
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (codec) {
+		codec->PopRepairRing();
+	}
+}
+
+int wirehair_trim(wirehair_state E) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->TrimEncoder()) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_update_blocks(wirehair_state E, const unsigned int *ids, const void * const *blocks, int count) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !ids || !blocks || count < 0) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->UpdateBlocks(reinterpret_cast<const u32 *>( ids ), blocks, count)) {
+		return 0;
+	}
 
 	return -1;
 }
 
 wirehair_state wirehair_decode(wirehair_state reuse_E, int bytes, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(bytes < 1) {
+		return 0;
+	}
+
+	return wirehair_decode64(reuse_E, (size_t)bytes, block_bytes);
+}
+
+wirehair_state wirehair_decode64(wirehair_state reuse_E, size_t bytes, int block_bytes) {
 	// If input is invalid,
 	if CAT_UNLIKELY(bytes < 1 || block_bytes < 1 ||
 					block_bytes % 2 != 0) {
@@ -117,22 +491,55 @@ wirehair_state wirehair_decode(wirehair_state reuse_E, int bytes, int block_byte
 
 	Codec *codec = reinterpret_cast<Codec *>( reuse_E );
 
-	// Allocate a new Codec object
+	// Allocate a new Codec object, warm from the pool if possible
 	if (!codec) {
-		codec = new Codec;
+		// Decoders hold a copy of the received blocks as well as the recovery blocks
+		codec = PoolAcquire(bytes * 2);
 	}
 
+	SetCodecExecutor(codec);
+
 	// Allocate memory for decoding
 	Result r = codec->InitializeDecoder(bytes, block_bytes);
 
 	if (r) {
-		delete codec;
+		PoolRelease(codec);
 		codec = 0;
 	}
 
 	return codec;
 }
 
+int wirehair_decode_reset(wirehair_state E) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->ResetDecoder()) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_expect(wirehair_state E, const unsigned int *ids, int count) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !ids || count <= 0) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->ExpectBlocks(reinterpret_cast<const u32 *>( ids ), count)) {
+		return 0;
+	}
+
+	return -1;
+}
+
 int wirehair_read(wirehair_state E, unsigned int id, const void *block) {
 	// If input is invalid,
 	if CAT_UNLIKELY(!E || !block) {
@@ -148,6 +555,62 @@ int wirehair_read(wirehair_state E, unsigned int id, const void *block) {
 	return -1;
 }
 
+int wirehair_seed_known(wirehair_state E, const unsigned char *bitmap, const void *message) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !bitmap || !message) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->SeedKnown(bitmap, message)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_needed(wirehair_state E) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E) {
+		return 0;
+	}
+
+	const Codec *codec = reinterpret_cast<const Codec *>( E );
+
+	return codec->BlocksNeeded();
+}
+
+int wirehair_deposit(wirehair_state E, unsigned int id, const void *block) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !block) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->DepositBlock(id, block)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_decode_async(wirehair_state E, wirehair_callback callback, void *context) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !callback) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (R_WIN != codec->StartAsyncSolve(callback, context)) {
+		return 0;
+	}
+
+	return -1;
+}
+
 int wirehair_reconstruct(wirehair_state E, void *message) {
 	// If input is invalid,
 	if CAT_UNLIKELY(!E || !message) {
@@ -178,11 +641,439 @@ int wirehair_reconstruct_block(wirehair_state E, unsigned int id, void *block) {
 	return -1;
 }
 
-void wirehair_free(wirehair_state E) {
+int wirehair_reconstruct_range(wirehair_state E, unsigned int id, unsigned int offset, unsigned int bytes, void *out) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !out) {
+		return 0;
+	}
+
 	Codec *codec = reinterpret_cast<Codec *>( E );
 
-	if (codec) {
-		delete codec;
+	// Block ids past the message would wrap in the codec row index
+	if CAT_UNLIKELY(id >= codec->BlockCount()) {
+		return 0;
+	}
+
+	if (R_WIN != codec->ReconstructRange((uidx)id, offset, bytes, out)) {
+		return 0;
 	}
-}
 
+	return -1;
+}
+
+int wirehair_reconstruct_ranges(wirehair_state E, const size_t *offsets, const size_t *bytes, void * const *outs, int count) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!E || !offsets || !bytes || !outs || count < 0) {
+		return 0;
+	}
+
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	// For each range,
+	for (int ii = 0; ii < count; ++ii) {
+		if (R_WIN != codec->ReconstructMessageRange(offsets[ii], bytes[ii], outs[ii])) {
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+void wirehair_free(wirehair_state E) {
+	Codec *codec = reinterpret_cast<Codec *>( E );
+
+	if (codec) {
+		PoolRelease(codec);
+	}
+}
+
+
+//// Large objects
+
+wirehair_object wirehair_object_encode(const void *object, size_t bytes, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!m_init || !object || bytes < 1 ||
+					block_bytes < 1 || block_bytes % 2 != 0) {
+		return 0;
+	}
+
+	SegmentedCodec *codec = new SegmentedCodec;
+
+	codec->SetExecutor(m_has_executor ? &m_executor : 0);
+
+	// On failure,
+	if (R_WIN != codec->EncodeObject(object, bytes, block_bytes)) {
+		delete codec;
+		codec = 0;
+	}
+
+	return codec;
+}
+
+unsigned int wirehair_object_count(wirehair_object O) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!O) {
+		return 0;
+	}
+
+	const SegmentedCodec *codec = reinterpret_cast<const SegmentedCodec *>( O );
+
+	return codec->BlockCount();
+}
+
+int wirehair_object_write(wirehair_object O, unsigned int id, void *block) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!O || !block) {
+		return 0;
+	}
+
+	const SegmentedCodec *codec = reinterpret_cast<const SegmentedCodec *>( O );
+
+	codec->Encode(id, block); // Returns bytes written
+
+	return -1;
+}
+
+void wirehair_object_free(wirehair_object O) {
+	SegmentedCodec *codec = reinterpret_cast<SegmentedCodec *>( O );
+
+	delete codec;
+}
+
+int wirehair_object_decode(size_t bytes, int block_bytes, const unsigned int *ids, const void * const *blocks, unsigned int count, void *object) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!m_init || bytes < 1 || block_bytes < 1 || block_bytes % 2 != 0 ||
+					!ids || !blocks || !object) {
+		return 0;
+	}
+
+	SegmentedCodec codec;
+
+	codec.SetExecutor(m_has_executor ? &m_executor : 0);
+
+	if (R_WIN != codec.DecodeObject(bytes, block_bytes, reinterpret_cast<const u32 *>( ids ), blocks, count, object)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+
+//// Streams
+
+wirehair_stream wirehair_stream_encoder(int window, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!m_init || window < 1 || block_bytes < 1) {
+		return 0;
+	}
+
+	StreamCodec *codec = new StreamCodec;
+
+	// On failure,
+	if (R_WIN != codec->InitializeEncoder(window, block_bytes)) {
+		delete codec;
+		codec = 0;
+	}
+
+	return codec;
+}
+
+int wirehair_stream_start(wirehair_stream S, unsigned int seq) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!S) {
+		return 0;
+	}
+
+	StreamCodec *codec = reinterpret_cast<StreamCodec *>( S );
+
+	if (R_WIN != codec->Start(seq)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_stream_add(wirehair_stream S, const void *packet) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!S || !packet) {
+		return 0;
+	}
+
+	StreamCodec *codec = reinterpret_cast<StreamCodec *>( S );
+
+	if (R_WIN != codec->Add(packet)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_stream_repair(wirehair_stream S, unsigned int *last, unsigned int *index, void *block) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!S || !last || !index || !block) {
+		return 0;
+	}
+
+	StreamCodec *codec = reinterpret_cast<StreamCodec *>( S );
+
+	u32 repair_last, repair_index;
+	if (R_WIN != codec->Repair(repair_last, repair_index, block)) {
+		return 0;
+	}
+
+	*last = repair_last;
+	*index = repair_index;
+
+	return -1;
+}
+
+wirehair_stream wirehair_stream_decoder(int window, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!m_init || window < 1 || block_bytes < 1) {
+		return 0;
+	}
+
+	StreamCodec *codec = new StreamCodec;
+
+	// On failure,
+	if (R_WIN != codec->InitializeDecoder(window, block_bytes)) {
+		delete codec;
+		codec = 0;
+	}
+
+	return codec;
+}
+
+int wirehair_stream_read(wirehair_stream S, unsigned int seq, const void *packet) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!S || !packet) {
+		return 0;
+	}
+
+	StreamCodec *codec = reinterpret_cast<StreamCodec *>( S );
+
+	if (R_WIN != codec->ReadSource(seq, packet)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_stream_read_repair(wirehair_stream S, unsigned int last, unsigned int index, const void *block) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!S || !block) {
+		return 0;
+	}
+
+	StreamCodec *codec = reinterpret_cast<StreamCodec *>( S );
+
+	if (R_WIN != codec->ReadRepair(last, index, block)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_stream_pop(wirehair_stream S, unsigned int *seq, void *packet) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!S || !seq || !packet) {
+		return 0;
+	}
+
+	StreamCodec *codec = reinterpret_cast<StreamCodec *>( S );
+
+	u32 packet_seq;
+	if (!codec->Pop(packet_seq, packet)) {
+		return 0;
+	}
+
+	*seq = packet_seq;
+
+	return -1;
+}
+
+void wirehair_stream_free(wirehair_stream S) {
+	StreamCodec *codec = reinterpret_cast<StreamCodec *>( S );
+
+	delete codec;
+}
+
+
+//// Packets
+
+wirehair_packets wirehair_packets_encode(const void * const *packets, const unsigned int *bytes, unsigned int count, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!m_init || !packets || !bytes || count < 1 ||
+					block_bytes < 1 || block_bytes % 2 != 0) {
+		return 0;
+	}
+
+	PacketCodec *codec = new PacketCodec;
+
+	codec->SetExecutor(m_has_executor ? &m_executor : 0);
+
+	// On failure,
+	if (R_WIN != codec->EncodePackets(packets, reinterpret_cast<const u32 *>( bytes ), count, block_bytes)) {
+		delete codec;
+		codec = 0;
+	}
+
+	return codec;
+}
+
+size_t wirehair_packets_message_bytes(wirehair_packets P) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P) {
+		return 0;
+	}
+
+	const PacketCodec *codec = reinterpret_cast<const PacketCodec *>( P );
+
+	return codec->MessageBytes();
+}
+
+unsigned int wirehair_packets_offset(wirehair_packets P, unsigned int index) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P) {
+		return 0;
+	}
+
+	const PacketCodec *codec = reinterpret_cast<const PacketCodec *>( P );
+
+	if CAT_UNLIKELY(index >= codec->PacketCount()) {
+		return 0;
+	}
+
+	return codec->Offset(index);
+}
+
+unsigned int wirehair_packets_table_count(wirehair_packets P) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P) {
+		return 0;
+	}
+
+	const PacketCodec *codec = reinterpret_cast<const PacketCodec *>( P );
+
+	return codec->TableCount();
+}
+
+int wirehair_packets_table(wirehair_packets P, unsigned int index, void *packet, unsigned int *bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P || !packet || !bytes) {
+		return 0;
+	}
+
+	const PacketCodec *codec = reinterpret_cast<const PacketCodec *>( P );
+
+	u32 table_bytes = codec->WriteTable(index, packet);
+	if (!table_bytes) {
+		return 0;
+	}
+
+	*bytes = table_bytes;
+
+	return -1;
+}
+
+int wirehair_packets_repair(wirehair_packets P, unsigned int index, void *block) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P || !block) {
+		return 0;
+	}
+
+	const PacketCodec *codec = reinterpret_cast<const PacketCodec *>( P );
+
+	codec->Repair(index, block); // Returns bytes written
+
+	return -1;
+}
+
+wirehair_packets wirehair_packets_decoder(size_t message_bytes, unsigned int count, int block_bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!m_init || message_bytes != (u32)message_bytes || count < 1 ||
+					block_bytes < 1 || block_bytes % 2 != 0) {
+		return 0;
+	}
+
+	PacketCodec *codec = new PacketCodec;
+
+	codec->SetExecutor(m_has_executor ? &m_executor : 0);
+
+	// On failure,
+	if (R_WIN != codec->InitializeDecoder((u32)message_bytes, count, block_bytes)) {
+		delete codec;
+		codec = 0;
+	}
+
+	return codec;
+}
+
+int wirehair_packets_read(wirehair_packets P, unsigned int index, unsigned int offset, const void *packet, unsigned int bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P) {
+		return 0;
+	}
+
+	PacketCodec *codec = reinterpret_cast<PacketCodec *>( P );
+
+	if (R_WIN != codec->ReadPacket(index, offset, packet, bytes)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_packets_read_table(wirehair_packets P, unsigned int index, const void *packet, unsigned int bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P) {
+		return 0;
+	}
+
+	PacketCodec *codec = reinterpret_cast<PacketCodec *>( P );
+
+	if (R_WIN != codec->ReadTable(index, packet, bytes)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_packets_read_repair(wirehair_packets P, unsigned int index, const void *block) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P || !block) {
+		return 0;
+	}
+
+	PacketCodec *codec = reinterpret_cast<PacketCodec *>( P );
+
+	if (R_WIN != codec->ReadRepair(index, block)) {
+		return 0;
+	}
+
+	return -1;
+}
+
+int wirehair_packets_recover(wirehair_packets P, unsigned int index, void *packet, unsigned int *bytes) {
+	// If input is invalid,
+	if CAT_UNLIKELY(!P || !packet || !bytes) {
+		return 0;
+	}
+
+	PacketCodec *codec = reinterpret_cast<PacketCodec *>( P );
+
+	u32 packet_bytes;
+	if (R_WIN != codec->Recover(index, packet, packet_bytes)) {
+		return 0;
+	}
+
+	*bytes = packet_bytes;
+
+	return -1;
+}
+
+void wirehair_packets_free(wirehair_packets P) {
+	PacketCodec *codec = reinterpret_cast<PacketCodec *>( P );
+
+	delete codec;
+}
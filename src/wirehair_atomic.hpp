@@ -0,0 +1,124 @@
+/*
+	Copyright (c) 2012 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of WirehairFEC nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef CAT_WIREHAIR_ATOMIC_HPP
+#define CAT_WIREHAIR_ATOMIC_HPP
+
+#include "Platform.hpp"
+
+#if defined(CAT_COMPILER_COMPAT_MSVC)
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange, _InterlockedExchangeAdd, _ReadWriteBarrier)
+#endif
+
+/*
+	Minimal atomic operations for state that is shared between codec
+	objects on different threads.  All of these are full barriers so
+	that data written before a pointer is published is visible to any
+	thread that reads the pointer.
+*/
+
+namespace cat {
+
+namespace wirehair {
+
+
+//// Atomic operations
+
+// Add to a 32-bit value and return the new value
+CAT_INLINE u32 AtomicAdd(volatile u32 *x, u32 n)
+{
+#if defined(CAT_COMPILER_COMPAT_MSVC)
+	return (u32)_InterlockedExchangeAdd((volatile long *)x, (long)n) + n;
+#else
+	return __sync_add_and_fetch(x, n);
+#endif
+}
+
+// Read a 32-bit value written by another thread
+CAT_INLINE u32 AtomicLoad(volatile u32 *x)
+{
+#if defined(CAT_COMPILER_COMPAT_MSVC)
+	u32 v = *x;
+	_ReadWriteBarrier();
+	return v;
+#else
+	return __atomic_load_n(x, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Write a 32-bit value after all earlier writes are visible to other threads
+CAT_INLINE void AtomicStore(volatile u32 *x, u32 v)
+{
+#if defined(CAT_COMPILER_COMPAT_MSVC)
+	_ReadWriteBarrier();
+	*x = v;
+#else
+	__atomic_store_n(x, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Set a 32-bit value to desired if it equals expected, returning the previous value
+CAT_INLINE u32 AtomicCompareSwap(volatile u32 *x, u32 expected, u32 desired)
+{
+#if defined(CAT_COMPILER_COMPAT_MSVC)
+	return (u32)_InterlockedCompareExchange((volatile long *)x, (long)desired, (long)expected);
+#else
+	return __sync_val_compare_and_swap(x, expected, desired);
+#endif
+}
+
+// Set a pointer to desired if it equals expected, returning the previous value
+CAT_INLINE void *AtomicCompareSwapPointer(void * volatile *x, void *expected, void *desired)
+{
+#if defined(CAT_COMPILER_COMPAT_MSVC)
+	return _InterlockedCompareExchangePointer(x, desired, expected);
+#else
+	return __sync_val_compare_and_swap(x, expected, desired);
+#endif
+}
+
+// Read a pointer published by another thread
+CAT_INLINE void *AtomicLoadPointer(void * volatile *x)
+{
+#if defined(CAT_COMPILER_COMPAT_MSVC)
+	void *p = *x;
+	_ReadWriteBarrier();
+	return p;
+#else
+	return __atomic_load_n(x, __ATOMIC_SEQ_CST);
+#endif
+}
+
+
+} // namespace wirehair
+
+} // namespace cat
+
+#endif // CAT_WIREHAIR_ATOMIC_HPP
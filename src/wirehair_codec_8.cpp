@@ -201,6 +201,7 @@
 */
 
 #include "wirehair_codec_8.hpp"
+#include "wirehair_atomic.hpp"
 #include "MemXOR.hpp"
 #include "Galois256.hpp"
 #if defined(CAT_HEAVY_WIN_MULT)
@@ -235,6 +236,7 @@ using namespace wirehair;
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
 using namespace std;
 #endif
 
@@ -270,11 +272,16 @@ const char *cat::wirehair::GetResultString(Result r)
 // 16-bit Integer Square Root function
 static u16 SquareRoot16(u16 x);
 
-// 16-bit Truncated Sieve of Eratosthenes Next Prime function
-static u16 NextPrime16(u16 n);
+#if defined(WIREHAIR_LARGE_N)
+// 32-bit Integer Square Root function
+static u32 SquareRoot32(u32 x);
+#endif
+
+// Truncated Sieve of Eratosthenes Next Prime function
+static uidx NextPrime(uidx n);
 
 // Peeling Row Weight Generator function
-static u16 GeneratePeelRowWeight(u32 rv, u16 peel_column_count);
+static uidx GeneratePeelRowWeight(u32 rv, uidx peel_column_count);
 
 // GF(2) Invertible Matrix Generator function
 static bool AddInvertibleGF2Matrix(u64 * CAT_RESTRICT matrix, int offset, int pitch, int n);
@@ -283,9 +290,9 @@ static bool AddInvertibleGF2Matrix(u64 * CAT_RESTRICT matrix, int offset, int pi
 static void ShuffleDeck16(Abyssinian &prng, u16 * CAT_RESTRICT deck, u32 count);
 
 // Peel Matrix Row Generator function
-static void GeneratePeelRow(u32 id, u32 p_seed, u16 peel_column_count, u16 mix_column_count,
-	u16 & CAT_RESTRICT peel_weight, u16 & CAT_RESTRICT peel_a, u16 & CAT_RESTRICT peel_x0,
-	u16 & CAT_RESTRICT mix_a, u16 & CAT_RESTRICT mix_x0);
+static void GeneratePeelRow(u32 id, u32 p_seed, uidx peel_column_count, uidx mix_column_count,
+	uidx & CAT_RESTRICT peel_weight, uidx & CAT_RESTRICT peel_a, uidx & CAT_RESTRICT peel_x0,
+	uidx & CAT_RESTRICT mix_a, uidx & CAT_RESTRICT mix_x0);
 
 
 //// Utility: 16-bit Integer Square Root function
@@ -359,8 +366,33 @@ u16 SquareRoot16(u16 x)
 	return r;
 }
 
+#if defined(WIREHAIR_LARGE_N)
+
+/*
+	Newton's method from an estimate made with the high 16 bits, which is
+	always at or above the root so the iteration only walks downward.
+*/
+
+u32 SquareRoot32(u32 x)
+{
+	if (x <= 0xffff)
+		return SquareRoot16((u16)x);
+
+	u32 r = ((u32)SquareRoot16((u16)(x >> 16)) + 1) << 8;
+
+	for (;;)
+	{
+		u32 next = (r + x / r) >> 1;
+		if (next >= r)
+			return r;
+		r = next;
+	}
+}
+
+#endif // WIREHAIR_LARGE_N
 
-//// Utility: 16-bit Truncated Sieve of Eratosthenes Next Prime function
+
+//// Utility: Truncated Sieve of Eratosthenes Next Prime function
 
 /*
 	It uses trial division up to the square root of the number to test.
@@ -396,7 +428,23 @@ static const u16 PRIMES_UNDER_256[] = {
 	193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251, 0x7fff
 };
 
-static u16 NextPrime16(u16 n)
+#if defined(WIREHAIR_LARGE_N)
+
+// Trial division for the primes above the table
+static bool HasOddFactor(u32 n, int p_max)
+{
+	for (int p = 257; p <= p_max; p += 2)
+	{
+		if (n % p == 0)
+			return true;
+	}
+
+	return false;
+}
+
+#endif // WIREHAIR_LARGE_N
+
+static uidx NextPrime(uidx n)
 {
 	// Handle small n
 	switch (n)
@@ -418,7 +466,11 @@ static u16 NextPrime16(u16 n)
 	n += next;
 
 	// Initialize p_max to sqrt(n)
+#if defined(WIREHAIR_LARGE_N)
+	int p_max = SquareRoot32(n);
+#else
 	int p_max = SquareRoot16(n);
+#endif
 
 	// For each number to try,
 	for (;;)
@@ -430,7 +482,14 @@ static u16 NextPrime16(u16 n)
 			// If the next prime is above p_max we are done!
 			int p = *prime;
 			if (p > p_max)
+			{
+#if defined(WIREHAIR_LARGE_N)
+				// Past the end of the table, try the odd numbers up to p_max
+				if (p == 0x7fff && HasOddFactor(n, p_max))
+					break;
+#endif
 				return n;
+			}
 
 			// If composite, try next n
 			if (n % p == 0)
@@ -688,6 +747,65 @@ static void ShuffleDeck16(Abyssinian &prng, u16 * CAT_RESTRICT deck, u32 count)
 }
 
 
+//// Utility: Shared Shuffle-2 Deck Cache
+
+/*
+	Every matrix with the same N uses the same dense seed and dense row
+	count, so the decks shuffled for each window of dense columns are the
+	same on every encode and decode.  They are generated once per N and
+	published in a small table shared by all codec objects.
+
+	A deck table starts with DECK_HEADER_WORDS words that identify the
+	matrix, followed by 4 * dense_count words for each column window:
+	The row deck and then the bit deck after each of its three shuffles.
+	Deck entries are below the dense row count, so tables stay 16-bit
+	even when the codec is built with 32-bit indices.
+
+	Published tables are never modified or freed, so they can be read
+	without locks.  If the slot for N holds another matrix or the byte
+	budget is spent, the codec object builds a private table instead.
+*/
+
+static const int DECK_HEADER_WORDS = 5;
+static const int DECK_CACHE_SLOTS = 64;
+static u16 * volatile m_deck_cache[DECK_CACHE_SLOTS] = { 0 };	// Published deck tables
+static volatile u32 m_deck_cache_bytes = 0;						// Bytes reserved for published tables
+
+static u32 DeckTableWords(u32 block_count, u16 dense_count)
+{
+	const u32 window_count = (block_count + dense_count - 1) / dense_count;
+	return DECK_HEADER_WORDS + window_count * dense_count * 4;
+}
+
+static CAT_INLINE bool DeckTableMatches(const u16 *table, u32 block_count, u16 dense_count, u32 d_seed)
+{
+	return table[0] == (u16)block_count && table[1] == (u16)(block_count >> 16) &&
+		table[2] == dense_count &&
+		table[3] == (u16)d_seed && table[4] == (u16)(d_seed >> 16);
+}
+
+static void GenerateDeckTable(u16 * CAT_RESTRICT table, u32 block_count, u16 dense_count, u32 d_seed)
+{
+	table[0] = (u16)block_count;
+	table[1] = (u16)(block_count >> 16);
+	table[2] = dense_count;
+	table[3] = (u16)d_seed;
+	table[4] = (u16)(d_seed >> 16);
+
+	// Initialize PRNG
+	Abyssinian prng;
+	prng.Initialize(d_seed);
+
+	// Shuffle in the same order that the decks are consumed
+	u16 * CAT_RESTRICT deck = table + DECK_HEADER_WORDS;
+	for (u32 column_i = 0; column_i < block_count; column_i += dense_count)
+	{
+		for (int ii = 0; ii < 4; ++ii, deck += dense_count)
+			ShuffleDeck16(prng, deck, dense_count);
+	}
+}
+
+
 //// Utility: Column Iterator function
 
 /*
@@ -699,18 +817,18 @@ static void ShuffleDeck16(Abyssinian &prng, u16 * CAT_RESTRICT deck, u32 count)
 	makes it faster than the rare case that I designed.
 */
 
-static CAT_INLINE void IterateNextColumn(u16 &x, u16 b, u16 p, u16 a)
+static CAT_INLINE void IterateNextColumn(uidx &x, uidx b, uidx p, uidx a)
 {
 	x = (x + a) % p;
 
 	if (x >= b)
 	{
-		u16 distance = p - x;
+		uidx distance = p - x;
 
 		if (a >= distance)
 			x = a - distance;
 		else // the rare case:
-			x = (((u32)a << 16) - distance) % a;
+			x = (uidx)((((u64)a << 32) - distance) % a);
 	}
 }
 
@@ -760,29 +878,30 @@ static const u32 WEIGHT_DIST[] = {
 	0xfb823ee0, 0xfb9611a7, 0xfba93868, 0xfbbbbbbb, 0xfbcda3ac, 0xfbdef7bd, 0xfbefbefb, 0xffffffff
 };
 
-static u16 GeneratePeelRowWeight(u32 rv, u16 peel_column_count)
+static uidx GeneratePeelRowWeight(u32 rv, uidx peel_column_count)
 {
 	// Unroll first 3 for speed (common case):
+	// NOTE: Not static so that Encode() does not race on their initialization
 
 	// If peel column count is small,
 	if (peel_column_count <= MAX_WEIGHT_1)
 	{
 		// Select probability of weight-1 rows here:
-		static const u32 P1 = (u32)((1./128) * 0xffffffff);
+		const u32 P1 = (u32)((1./128) * 0xffffffff);
 		if (rv < P1) return 1;
 
 		// Rescale to match table values
 		rv -= P1;
 	}
 
-	static const u32 P2 = WEIGHT_DIST[1];
+	const u32 P2 = WEIGHT_DIST[1];
 	if (rv <= P2) return 2;
 
-	static const u32 P3 = WEIGHT_DIST[2];
+	const u32 P3 = WEIGHT_DIST[2];
 	if (rv <= P3) return 3;
 
 	// Find first table entry containing a number smaller than or equal to rv
-	u16 weight = 3;
+	uidx weight = 3;
 	while (rv > WEIGHT_DIST[weight++]);
 	return weight;
 }
@@ -790,23 +909,34 @@ static u16 GeneratePeelRowWeight(u32 rv, u16 peel_column_count)
 
 //// Utility: Peel Matrix Row Generator function
 
-static void GeneratePeelRow(u32 id, u32 p_seed, u16 peel_column_count, u16 mix_column_count,
-	u16 & CAT_RESTRICT peel_weight, u16 & CAT_RESTRICT peel_a, u16 & CAT_RESTRICT peel_x0,
-	u16 & CAT_RESTRICT mix_a, u16 & CAT_RESTRICT mix_x0)
+static void GeneratePeelRow(u32 id, u32 p_seed, uidx peel_column_count, uidx mix_column_count,
+	uidx & CAT_RESTRICT peel_weight, uidx & CAT_RESTRICT peel_a, uidx & CAT_RESTRICT peel_x0,
+	uidx & CAT_RESTRICT mix_a, uidx & CAT_RESTRICT mix_x0)
 {
 	// Initialize PRNG
 	Abyssinian prng;
 	prng.Initialize(id, p_seed);
 
 	// Generate peeling matrix row weight
-	u16 weight = GeneratePeelRowWeight(prng.Next(), peel_column_count);
-	u16 max_weight = peel_column_count / 2; // Do not set more than N/2 at a time
+	uidx weight = GeneratePeelRowWeight(prng.Next(), peel_column_count);
+	uidx max_weight = peel_column_count / 2; // Do not set more than N/2 at a time
 	peel_weight = (weight > max_weight) ? max_weight : weight;
 
 	// Generate peeling matrix column selection parameters for row
 	u32 rv = prng.Next();
-	peel_a = ((u16)rv % (peel_column_count - 1)) + 1;
-	peel_x0 = (u16)(rv >> 16) % peel_column_count;
+#if defined(WIREHAIR_LARGE_N)
+	// Above 16 bits, draw each parameter from its own 32-bit value
+	if (peel_column_count > 0xffff)
+	{
+		peel_a = (rv % (peel_column_count - 1)) + 1;
+		peel_x0 = prng.Next() % peel_column_count;
+	}
+	else
+#endif
+	{
+		peel_a = ((u16)rv % (peel_column_count - 1)) + 1;
+		peel_x0 = (u16)(rv >> 16) % peel_column_count;
+	}
 
 	// Generate mixing matrix column selection parameters
 	rv = prng.Next();
@@ -821,26 +951,26 @@ static void GeneratePeelRow(u32 id, u32 p_seed, u16 peel_column_count, u16 mix_c
 #pragma pack(1)
 struct Codec::PeelRow
 {
-	u16 next;					// Linkage in row list
+	uidx next;					// Linkage in row list
 	u32 id;						// Identifier for this row
 
 	// Peeling matrix: Column generator
-	u16 peel_weight, peel_a, peel_x0;
+	uidx peel_weight, peel_a, peel_x0;
 
 	// Mixing matrix: Column generator
-	u16 mix_a, mix_x0;
+	uidx mix_a, mix_x0;
 
 	// Peeling state
-	u16 unmarked_count;			// Count of columns that have not been marked yet
+	uidx unmarked_count;			// Count of columns that have not been marked yet
 	union
 	{
 		// During peeling:
-		u16 unmarked[2];		// Final two unmarked column indices
+		uidx unmarked[2];		// Final two unmarked column indices
 
 		// After peeling:
 		struct
 		{
-			u16 peel_column;	// Peeling column that is solved by this row
+			uidx peel_column;	// Peeling column that is solved by this row
 			u8 is_copied;		// Row value is copied yet?
 		};
 	};
@@ -859,16 +989,18 @@ enum MarkTypes
 #pragma pack(1)
 struct Codec::PeelColumn
 {
-	u16 next;			// Linkage in column list
+	uidx next;			// Linkage in column list
 
 	union
 	{
-		u16 w2_refs;	// Number of weight-2 rows containing this column
-		u16 peel_row;	// Row that solves the column
-		u16 ge_column;	// Column that a deferred column is mapped to
+		uidx w2_refs;	// Number of weight-2 rows containing this column
+		uidx peel_row;	// Row that solves the column
+		uidx ge_column;	// Column that a deferred column is mapped to
 	};
 
 	u8 mark;			// One of the MarkTypes enumeration
+	u8 generation;		// Column is cleared unless this matches the codec generation
+	uidx level;			// Substitution level of a peeled column
 };
 #pragma pack(pop)
 
@@ -876,11 +1008,50 @@ struct Codec::PeelColumn
 #pragma pack(1)
 struct Codec::PeelRefs
 {
-	u16 row_count;		// Number of rows containing this column
-	u16 rows[CAT_REF_LIST_MAX];
+	uidx row_count;		// Number of rows containing this column
+	uidx rows[CAT_REF_LIST_MAX];
+};
+#pragma pack(pop)
+
+#pragma pack(push)
+#pragma pack(1)
+struct Codec::CompressRow
+{
+	u32 offset;			// Offset of the first stored word in the Compression matrix
+	u16 first_word;		// First GE matrix word covered by this row
+	u16 word_count;		// Number of words stored for this row
 };
 #pragma pack(pop)
 
+struct Codec::RowJob
+{
+	Codec *codec;
+	const uidx *rows;		// Rows to process
+	u32 row_count;			// Number of rows to process
+	u32 rows_per_task;		// Number of rows for each task
+	u8 *output;				// Output blocks, if any
+};
+
+struct Codec::SliceJob
+{
+	Codec *codec;
+	u32 slice_bytes;		// Bytes of each block for each task
+};
+
+struct Codec::QueueSlot
+{
+	volatile u32 sequence;	// Queue position the slot is ready for
+	u32 id;					// Block id
+};
+
+struct Codec::ExpectSlot
+{
+	u32 id;					// Expected block id
+	uidx row_i;				// Row reserved for the block, or LIST_TERM for a spare
+	u8 used;				// Non-zero if the slot holds an id
+	u8 filled;				// Non-zero once the block data has arrived
+};
+
 
 //// (1) Peeling:
 
@@ -926,17 +1097,27 @@ bool Codec::OpportunisticPeeling(u32 row_i, u32 id)
 	CAT_IF_DUMP(cout << "Row " << id << " in slot " << row_i << " of weight " << row->peel_weight << " [a=" << row->peel_a << "] : ";)
 
 	// Iterate columns in peeling matrix
-	u16 weight = row->peel_weight;
-	u16 column_i = row->peel_x0;
-	u16 a = row->peel_a;
-	u16 unmarked_count = 0;
-	u16 unmarked[2];
+	uidx weight = row->peel_weight;
+	uidx column_i = row->peel_x0;
+	uidx a = row->peel_a;
+	uidx unmarked_count = 0;
+	uidx unmarked[2];
 	for (;;)
 	{
 		CAT_IF_DUMP(cout << column_i << " ";)
 
+		PeelColumn *column = &_peel_cols[column_i];
 		PeelRefs *refs = &_peel_col_refs[column_i];
 
+		// If column is left over from a previous message, clear it now
+		if (column->generation != _generation)
+		{
+			column->generation = _generation;
+			column->w2_refs = 0;
+			column->mark = MARK_TODO;
+			refs->row_count = 0;
+		}
+
 		// Add row reference to column
 		if (refs->row_count >= CAT_REF_LIST_MAX)
 		{
@@ -947,7 +1128,7 @@ bool Codec::OpportunisticPeeling(u32 row_i, u32 id)
 		refs->rows[refs->row_count++] = row_i;
 
 		// If column is unmarked,
-		if (_peel_cols[column_i].mark == MARK_TODO)
+		if (column->mark == MARK_TODO)
 			unmarked[unmarked_count++ & 1] = column_i;
 
 		if (--weight <= 0) break;
@@ -986,6 +1167,39 @@ bool Codec::OpportunisticPeeling(u32 row_i, u32 id)
 	return true;
 }
 
+/*
+	RebuildColumnRefs
+
+		This function lists the rows of each column again, in the same
+	order that OpportunisticPeeling() did for the encoder.  The lists are
+	re-purposed after solving, so they are rebuilt before the encoder runs
+	the substitution again for updated blocks.
+*/
+
+void Codec::RebuildColumnRefs()
+{
+	for (uidx column_i = 0; column_i < _block_count; ++column_i)
+		_peel_col_refs[column_i].row_count = 0;
+
+	// For each row,
+	const PeelRow * CAT_RESTRICT row = _peel_rows;
+	for (uidx row_i = 0; row_i < _block_count; ++row_i, ++row)
+	{
+		uidx weight = row->peel_weight;
+		uidx column_i = row->peel_x0;
+		uidx a = row->peel_a;
+		for (;;)
+		{
+			PeelRefs * CAT_RESTRICT refs = &_peel_col_refs[column_i];
+			refs->rows[refs->row_count++] = row_i;
+
+			if (--weight <= 0) break;
+
+			IterateNextColumn(column_i, _block_count, _block_next_prime, a);
+		}
+	}
+}
+
 /*
 	FixPeelFailure
 
@@ -995,14 +1209,14 @@ bool Codec::OpportunisticPeeling(u32 row_i, u32 id)
 	unusually distributed peeling matrices.
 */
 
-void Codec::FixPeelFailure(PeelRow * CAT_RESTRICT row, u16 fail_column_i)
+void Codec::FixPeelFailure(PeelRow * CAT_RESTRICT row, uidx fail_column_i)
 {
 	CAT_IF_DUMP(cout << "!!Fixing Peel Failure!! Unreferencing columns, ending at " << fail_column_i << " :";)
 
 	// Iterate columns in peeling matrix
-	//u16 weight = row->peel_weight;
-	u16 column_i = row->peel_x0;
-	u16 a = row->peel_a;
+	//uidx weight = row->peel_weight;
+	uidx column_i = row->peel_x0;
+	uidx a = row->peel_a;
 	while (column_i != fail_column_i)
 	{
 		CAT_IF_DUMP(cout << " " << column_i;)
@@ -1031,24 +1245,24 @@ void Codec::FixPeelFailure(PeelRow * CAT_RESTRICT row, u16 fail_column_i)
 	reused later during GreedyPeeling().
 */
 
-void Codec::PeelAvalanche(u16 column_i)
+void Codec::PeelAvalanche(uidx column_i)
 {
 	// Walk list of peeled rows referenced by this newly solved column
 	PeelRefs * CAT_RESTRICT refs = &_peel_col_refs[column_i];
-	u16 ref_row_count = refs->row_count;
-	u16 * CAT_RESTRICT ref_rows = refs->rows;
+	uidx ref_row_count = refs->row_count;
+	uidx * CAT_RESTRICT ref_rows = refs->rows;
 	while (ref_row_count--)
 	{
 		// Update unmarked row count for this referenced row
-		u16 ref_row_i = *ref_rows++;
+		uidx ref_row_i = *ref_rows++;
 		PeelRow * CAT_RESTRICT ref_row = &_peel_rows[ref_row_i];
-		u16 unmarked_count = --ref_row->unmarked_count;
+		uidx unmarked_count = --ref_row->unmarked_count;
 
 		// If row may be solving a column now,
 		if (unmarked_count == 1)
 		{
 			// Find other column
-			u16 new_column_i = ref_row->unmarked[0];
+			uidx new_column_i = ref_row->unmarked[0];
 			if (new_column_i == column_i)
 				new_column_i = ref_row->unmarked[1];
 
@@ -1073,10 +1287,10 @@ void Codec::PeelAvalanche(u16 column_i)
 		else if (unmarked_count == 2)
 		{
 			// Regenerate the row columns to discover which are unmarked
-			u16 ref_weight = ref_row->peel_weight;
-			u16 ref_column_i = ref_row->peel_x0;
-			u16 ref_a = ref_row->peel_a;
-			u16 unmarked_count = 0;
+			uidx ref_weight = ref_row->peel_weight;
+			uidx ref_column_i = ref_row->peel_x0;
+			uidx ref_a = ref_row->peel_a;
+			uidx unmarked_count = 0;
 			for (;;)
 			{
 				PeelColumn * CAT_RESTRICT ref_col = &_peel_cols[ref_column_i];
@@ -1128,9 +1342,14 @@ void Codec::PeelAvalanche(u16 column_i)
 		This function is called exclusively by OpportunisticPeeling()
 	to take care of marking columns solved when a row is able to solve
 	a column during the peeling process.
+
+		It also records the substitution level of the column, which is
+	one more than the highest level of the other peeled columns in the
+	row.  Deferred columns are solved before substitution, so they do
+	not add a level.  All other columns in the row are marked by now.
 */
 
-void Codec::Peel(u16 row_i, PeelRow * CAT_RESTRICT row, u16 column_i)
+void Codec::Peel(uidx row_i, PeelRow * CAT_RESTRICT row, uidx column_i)
 {
 	CAT_IF_DUMP(cout << "Peel: Solved column " << column_i << " with row " << row_i << endl;)
 
@@ -1153,6 +1372,23 @@ void Codec::Peel(u16 row_i, PeelRow * CAT_RESTRICT row, u16 column_i)
 	// Indicate that this row hasn't been copied yet
 	row->is_copied = 0;
 
+	// Solve the column one level after the latest peeled column in the row
+	uidx level = 0;
+	uidx weight = row->peel_weight;
+	uidx ref_column_i = row->peel_x0;
+	uidx a = row->peel_a;
+	for (;;)
+	{
+		PeelColumn * CAT_RESTRICT ref_col = &_peel_cols[ref_column_i];
+		if (ref_col->mark == MARK_PEEL && ref_column_i != column_i && ref_col->level >= level)
+			level = ref_col->level + 1;
+
+		if (--weight <= 0) break;
+
+		IterateNextColumn(ref_column_i, _block_count, _block_next_prime, a);
+	}
+	column->level = level;
+
 	// Attempt to avalanche and solve other columns
 	PeelAvalanche(column_i);
 
@@ -1186,25 +1422,38 @@ void Codec::GreedyPeeling()
 	_defer_head_columns = LIST_TERM;
 	_defer_count = 0;
 
+	// Clear any columns that no row has touched since ClearPeelColumns()
+	PeelColumn *column = _peel_cols;
+	for (uidx column_i = 0; column_i < _block_count; ++column_i, ++column)
+	{
+		if (column->generation != _generation)
+		{
+			column->generation = _generation;
+			column->w2_refs = 0;
+			column->mark = MARK_TODO;
+			_peel_col_refs[column_i].row_count = 0;
+		}
+	}
+
 	// Until all columns are marked,
 	for (;;)
 	{
-		u16 best_column_i = LIST_TERM;
-		u16 best_w2_refs = 0, best_row_count = 0;
+		uidx best_column_i = LIST_TERM;
+		uidx best_w2_refs = 0, best_row_count = 0;
 
 		// For each column,
-		PeelColumn *column = _peel_cols;
-		for (u16 column_i = 0; column_i < _block_count; ++column_i, ++column)
+		column = _peel_cols;
+		for (uidx column_i = 0; column_i < _block_count; ++column_i, ++column)
 		{
 			// If column is not marked yet,
 			if (column->mark == MARK_TODO)
 			{
 				// And if it may have the most weight-2 references
-				u16 w2_refs = column->w2_refs;
+				uidx w2_refs = column->w2_refs;
 				if (w2_refs >= best_w2_refs)
 				{
 					// Or if it has the largest row references overall,
-					u16 row_count = _peel_col_refs[column_i].row_count;
+					uidx row_count = _peel_col_refs[column_i].row_count;
 					if (w2_refs > best_w2_refs || row_count >= best_row_count)
 					{
 						// Use that one
@@ -1321,6 +1570,153 @@ void Codec::GreedyPeeling()
 	later after the destination columns are determined by Gaussian elimination.
 */
 
+/*
+	Important Optimization: Banded Compression Matrix
+
+		Storing the Compression matrix as N full-width rows costs N * GE pitch
+	words and they all have to be cleared up front, even though each row only
+	ever has bits in a limited range of words.  The mixing columns all live in
+	the last few words, and a row only picks up deferred column bits from the
+	rows that were peeled before it.
+
+		Since the peeling order is known before the matrix is allocated, the
+	range of words touched by each row can be measured exactly by following
+	the same row additions that PeelDiagonal() will perform, without moving
+	any data.  Each row then stores just its own band of words, packed one
+	after another, so the memory used and cleared scales with the actual
+	fill of the matrix.  Rows are expanded into full-width GE rows only when
+	they are added into the GE matrix.
+
+		A row added into another row always has a band that fits inside the
+	band of the destination row, because the destination band was measured
+	as the union of all the rows added to it.
+*/
+
+/*
+	SetCompressBands
+
+		This function measures the band of words spanned by each row of the
+	Compression matrix, and it returns the number of words needed to store
+	all of the rows.
+
+	For each deferred column,
+		Extend the band of each row that references it.
+	For each row,
+		Extend the band with its mixing columns.
+	For each peeled row in forward solution order,
+		Extend the bands of its referencing rows by its band.
+	Lay out the rows in order.
+*/
+
+u32 Codec::SetCompressBands()
+{
+	CAT_IF_DUMP(cout << endl << "---- SetCompressBands ----" << endl << endl;)
+
+	CompressRow * CAT_RESTRICT bands = _compress_rows;
+
+	// Start with empty bands, storing the last word in word_count for now
+	for (uidx row_i = 0; row_i < _block_count; ++row_i)
+	{
+		bands[row_i].first_word = 0xffff;
+		bands[row_i].word_count = 0;
+	}
+
+	// For each deferred column,
+	for (uidx ge_column_i = 0, defer_i = _defer_head_columns; defer_i != LIST_TERM; defer_i = _peel_cols[defer_i].next, ++ge_column_i)
+	{
+		const uidx word = ge_column_i >> 6;
+
+		// Extend band for each row affected by this deferred column
+		PeelRefs * CAT_RESTRICT refs = &_peel_col_refs[defer_i];
+		uidx count = refs->row_count;
+		uidx *ref_row = refs->rows;
+		while (count--)
+		{
+			CompressRow * CAT_RESTRICT band = &bands[*ref_row++];
+
+			if (band->first_word > word) band->first_word = word;
+			if (band->word_count < word) band->word_count = word;
+		}
+	}
+
+	// For each row,
+	for (uidx row_i = 0; row_i < _block_count; ++row_i)
+	{
+		PeelRow * CAT_RESTRICT row = &_peel_rows[row_i];
+		CompressRow * CAT_RESTRICT band = &bands[row_i];
+		uidx a = row->mix_a;
+		uidx x = row->mix_x0;
+
+		// Extend band for each of the three mixing columns
+		for (int ii = 0;;)
+		{
+			const uidx word = (_defer_count + x) >> 6;
+
+			if (band->first_word > word) band->first_word = word;
+			if (band->word_count < word) band->word_count = word;
+
+			if (++ii >= 3) break;
+
+			IterateNextColumn(x, _mix_count, _mix_next_prime, a);
+		}
+	}
+
+	// For each peeled row in forward solution order,
+	PeelRow * CAT_RESTRICT row;
+	for (uidx peel_row_i = _peel_head_rows; peel_row_i != LIST_TERM; peel_row_i = row->next)
+	{
+		row = &_peel_rows[peel_row_i];
+		const CompressRow * CAT_RESTRICT src = &bands[peel_row_i];
+
+		// For each row that references this one,
+		PeelRefs * CAT_RESTRICT refs = &_peel_col_refs[row->peel_column];
+		uidx count = refs->row_count;
+		uidx * CAT_RESTRICT ref_row = refs->rows;
+		while (count--)
+		{
+			uidx ref_row_i = *ref_row++;
+
+			// Skip this row
+			if (ref_row_i == peel_row_i) continue;
+
+			// Extend referencing row band to cover this row band
+			CompressRow * CAT_RESTRICT band = &bands[ref_row_i];
+			if (band->first_word > src->first_word) band->first_word = src->first_word;
+			if (band->word_count < src->word_count) band->word_count = src->word_count;
+		}
+	}
+
+	// Lay out rows one after another
+	u32 offset = 0;
+	for (uidx row_i = 0; row_i < _block_count; ++row_i)
+	{
+		CompressRow * CAT_RESTRICT band = &bands[row_i];
+
+		band->offset = offset;
+		band->word_count = band->word_count - band->first_word + 1;
+		offset += band->word_count;
+	}
+
+	CAT_IF_DUMP(cout << "Compression matrix bands use " << offset << " words instead of " << _block_count * ((_defer_count + _mix_count + 63) / 64) << endl;)
+
+	return offset;
+}
+
+/*
+	AddCompressRow
+
+		Add a Compression matrix row to a full-width GE matrix row.
+*/
+
+CAT_INLINE void Codec::AddCompressRow(u64 * CAT_RESTRICT ge_row, uidx row_i)
+{
+	const CompressRow * CAT_RESTRICT band = &_compress_rows[row_i];
+	const u64 * CAT_RESTRICT src = _compress_matrix + band->offset;
+	u64 * CAT_RESTRICT dest = ge_row + band->first_word;
+
+	for (int ii = 0; ii < band->word_count; ++ii) dest[ii] ^= src[ii];
+}
+
 /*
 	SetDeferredColumns
 
@@ -1344,25 +1740,26 @@ void Codec::SetDeferredColumns()
 
 	// For each deferred column,
 	PeelColumn * CAT_RESTRICT column;
-	for (u16 ge_column_i = 0, defer_i = _defer_head_columns; defer_i != LIST_TERM; defer_i = column->next, ++ge_column_i)
+	for (uidx ge_column_i = 0, defer_i = _defer_head_columns; defer_i != LIST_TERM; defer_i = column->next, ++ge_column_i)
 	{
 		column = &_peel_cols[defer_i];
 
 		CAT_IF_DUMP(cout << "GE column " << ge_column_i << " mapped to matrix column " << defer_i << " :";)
 
 		// Set bit for each row affected by this deferred column
-		u64 *matrix_row_offset = _compress_matrix + (ge_column_i >> 6);
+		const uidx ge_word = ge_column_i >> 6;
 		u64 ge_mask = (u64)1 << (ge_column_i & 63);
 		PeelRefs * CAT_RESTRICT refs = &_peel_col_refs[defer_i];
-		u16 count = refs->row_count;
-		u16 *ref_row = refs->rows;
+		uidx count = refs->row_count;
+		uidx *ref_row = refs->rows;
 		while (count--)
 		{
-			u16 row_i = *ref_row++;
+			uidx row_i = *ref_row++;
 
 			CAT_IF_DUMP(cout << " " << row_i;)
 
-			matrix_row_offset[_ge_pitch * row_i] |= ge_mask;
+			const CompressRow * CAT_RESTRICT band = &_compress_rows[row_i];
+			_compress_matrix[band->offset + ge_word - band->first_word] |= ge_mask;
 		}
 
 		CAT_IF_DUMP(cout << endl;)
@@ -1375,10 +1772,10 @@ void Codec::SetDeferredColumns()
 	}
 
 	// Set column map for each mix column
-	for (u16 added_i = 0; added_i < _mix_count; ++added_i)
+	for (uidx added_i = 0; added_i < _mix_count; ++added_i)
 	{
-		u16 ge_column_i = _defer_count + added_i;
-		u16 column_i = _block_count + added_i;
+		uidx ge_column_i = _defer_count + added_i;
+		uidx column_i = _block_count + added_i;
 
 		CAT_IF_DUMP(cout << "GE column(mix) " << ge_column_i << " mapped to matrix column " << column_i << endl;)
 
@@ -1401,7 +1798,7 @@ void Codec::SetMixingColumnsForDeferredRows()
 
 	// For each deferred row,
 	PeelRow * CAT_RESTRICT row;
-	for (u16 defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM; defer_row_i = row->next)
+	for (uidx defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM; defer_row_i = row->next)
 	{
 		row = &_peel_rows[defer_row_i];
 
@@ -1411,25 +1808,27 @@ void Codec::SetMixingColumnsForDeferredRows()
 		row->peel_column = LIST_TERM;
 
 		// Set up mixing column generator
-		u64 *ge_row = _compress_matrix + _ge_pitch * defer_row_i;
-		u16 a = row->mix_a;
-		u16 x = row->mix_x0;
+		const CompressRow * CAT_RESTRICT band = &_compress_rows[defer_row_i];
+		u64 *ge_row = _compress_matrix + band->offset;
+		const u16 first_word = band->first_word;
+		uidx a = row->mix_a;
+		uidx x = row->mix_x0;
 
 		// Generate mixing column 1
-		u16 ge_column_i = _defer_count + x;
-		ge_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
+		uidx ge_column_i = _defer_count + x;
+		ge_row[(ge_column_i >> 6) - first_word] ^= (u64)1 << (ge_column_i & 63);
 		CAT_IF_DUMP(cout << " " << ge_column_i;)
 		IterateNextColumn(x, _mix_count, _mix_next_prime, a);
 
 		// Generate mixing column 2
 		ge_column_i = _defer_count + x;
-		ge_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
+		ge_row[(ge_column_i >> 6) - first_word] ^= (u64)1 << (ge_column_i & 63);
 		CAT_IF_DUMP(cout << " " << ge_column_i;)
 		IterateNextColumn(x, _mix_count, _mix_next_prime, a);
 
 		// Generate mixing column 3
 		ge_column_i = _defer_count + x;
-		ge_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
+		ge_row[(ge_column_i >> 6) - first_word] ^= (u64)1 << (ge_column_i & 63);
 		CAT_IF_DUMP(cout << " " << ge_column_i;)
 
 		CAT_IF_DUMP(cout << endl;)
@@ -1442,67 +1841,123 @@ void Codec::SetMixingColumnsForDeferredRows()
 		This function diagonalizes the peeled rows and columns of the
 	check matrix.  The result is that the peeled submatrix is the
 	identity matrix, and that the other columns of the peeled rows are
-	very dense and have temporary block values assigned.  These dense
-	columns are used to efficiently zero out the peeled columns of the
-	other rows.
+	very dense.  These dense columns are used to efficiently zero out
+	the peeled columns of the other rows.
 
-		This function is one of the most expensive in the whole codec,
-	because its memory access patterns are not cache-friendly.
+		Only the matrix is changed here.  The matching block values are
+	generated later by PeelDiagonalValues(), so the matrix can be solved
+	before the block data arrives.
 
 	For each peeled row in forward solution order,
 		Set mixing column bits for the row in the Compression matrix.
-		Generate row block value.
 		For each row that references this row in the peeling matrix,
 			Add Compression matrix row to referencing row.
-			If row is peeled,
-				Add row block value.
 */
 
 void Codec::PeelDiagonal()
 {
 	CAT_IF_DUMP(cout << endl << "---- PeelDiagonal ----" << endl << endl;)
 
-	/*
-		This function optimizes the block value generation by combining the first
-		memcpy and memxor operations together into a three-way memxor if possible,
-		using the is_copied row member.
-	*/
-
-	CAT_IF_ROWOP(int rowops = 0;)
-
 	// For each peeled row in forward solution order,
 	PeelRow * CAT_RESTRICT row;
-	for (u16 peel_row_i = _peel_head_rows; peel_row_i != LIST_TERM; peel_row_i = row->next)
+	for (uidx peel_row_i = _peel_head_rows; peel_row_i != LIST_TERM; peel_row_i = row->next)
 	{
 		row = &_peel_rows[peel_row_i];
 
 		// Lookup peeling results
-		u16 peel_column_i = row->peel_column;
-		u64 *ge_row = _compress_matrix + _ge_pitch * peel_row_i;
+		uidx peel_column_i = row->peel_column;
+		const CompressRow * CAT_RESTRICT band = &_compress_rows[peel_row_i];
+		u64 *ge_row = _compress_matrix + band->offset;
+		const u16 first_word = band->first_word;
 
 		CAT_IF_DUMP(cout << "Peeled row " << peel_row_i << " for peeled column " << peel_column_i << " :";)
 
 		// Set up mixing column generator
-		u16 a = row->mix_a;
-		u16 x = row->mix_x0;
+		uidx a = row->mix_a;
+		uidx x = row->mix_x0;
 
 		// Generate mixing column 1
-		u16 ge_column_i = _defer_count + x;
-		ge_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
+		uidx ge_column_i = _defer_count + x;
+		ge_row[(ge_column_i >> 6) - first_word] ^= (u64)1 << (ge_column_i & 63);
 		CAT_IF_DUMP(cout << " " << ge_column_i;)
 		IterateNextColumn(x, _mix_count, _mix_next_prime, a);
 
 		// Generate mixing column 2
 		ge_column_i = _defer_count + x;
-		ge_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
+		ge_row[(ge_column_i >> 6) - first_word] ^= (u64)1 << (ge_column_i & 63);
 		CAT_IF_DUMP(cout << " " << ge_column_i;)
 		IterateNextColumn(x, _mix_count, _mix_next_prime, a);
 
 		// Generate mixing column 3
 		ge_column_i = _defer_count + x;
-		ge_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
+		ge_row[(ge_column_i >> 6) - first_word] ^= (u64)1 << (ge_column_i & 63);
 		CAT_IF_DUMP(cout << " " << ge_column_i << endl;)
 
+		CAT_IF_DUMP(cout << "++ Adding to referencing rows:";)
+
+		// For each row that references this one,
+		PeelRefs * CAT_RESTRICT refs = &_peel_col_refs[peel_column_i];
+		uidx count = refs->row_count;
+		uidx * CAT_RESTRICT ref_row = refs->rows;
+		while (count--)
+		{
+			uidx ref_row_i = *ref_row++;
+
+			// Skip this row
+			if (ref_row_i == peel_row_i) continue;
+
+			CAT_IF_DUMP(cout << " " << ref_row_i;)
+
+			// Add GE row to referencing GE row
+			const CompressRow * CAT_RESTRICT ref_band = &_compress_rows[ref_row_i];
+			u64 * CAT_RESTRICT ge_ref_row = _compress_matrix + ref_band->offset + (first_word - ref_band->first_word);
+			for (int ii = 0; ii < band->word_count; ++ii) ge_ref_row[ii] ^= ge_row[ii];
+		} // next referencing row
+
+		CAT_IF_DUMP(cout << endl;)
+	} // next peeled row
+}
+
+/*
+	PeelDiagonalValues
+
+		This function assigns the temporary block values that go with
+	the row additions made by PeelDiagonal().  It only depends on the
+	peeling results, so it runs as the first step of the substitution.
+
+		This function is one of the most expensive in the whole codec,
+	because its memory access patterns are not cache-friendly.
+
+	For each peeled row in forward solution order,
+		Generate row block value.
+		For each row that references this row in the peeling matrix,
+			If row is peeled,
+				Add row block value.
+*/
+
+void Codec::PeelDiagonalValues()
+{
+	CAT_IF_DUMP(cout << endl << "---- PeelDiagonalValues ----" << endl << endl;)
+
+	/*
+		This function optimizes the block value generation by combining the first
+		memcpy and memxor operations together into a three-way memxor if possible,
+		using the is_copied row member.
+	*/
+
+	CAT_IF_ROWOP(int rowops = 0;)
+
+	// For each peeled row in forward solution order,
+	PeelRow * CAT_RESTRICT row;
+	for (uidx peel_row_i = _peel_head_rows; peel_row_i != LIST_TERM; peel_row_i = row->next)
+	{
+		row = &_peel_rows[peel_row_i];
+
+		// Lookup peeling results
+		uidx peel_column_i = row->peel_column;
+
+		CAT_IF_DUMP(cout << "Peeled row " << peel_row_i << " for peeled column " << peel_column_i << " :";)
+
 		// Lookup output block
 		u8 * CAT_RESTRICT temp_block_src = _recovery_blocks + _block_bytes * peel_column_i;
 
@@ -1529,24 +1984,20 @@ void Codec::PeelDiagonal()
 
 		// For each row that references this one,
 		PeelRefs * CAT_RESTRICT refs = &_peel_col_refs[peel_column_i];
-		u16 count = refs->row_count;
-		u16 * CAT_RESTRICT ref_row = refs->rows;
+		uidx count = refs->row_count;
+		uidx * CAT_RESTRICT ref_row = refs->rows;
 		while (count--)
 		{
-			u16 ref_row_i = *ref_row++;
+			uidx ref_row_i = *ref_row++;
 
 			// Skip this row
 			if (ref_row_i == peel_row_i) continue;
 
 			CAT_IF_DUMP(cout << " " << ref_row_i;)
 
-			// Add GE row to referencing GE row
-			u64 * CAT_RESTRICT ge_ref_row = _compress_matrix + _ge_pitch * ref_row_i;
-			for (int ii = 0; ii < _ge_pitch; ++ii) ge_ref_row[ii] ^= ge_row[ii];
-
 			// If row is peeled,
 			PeelRow * CAT_RESTRICT ref_row = &_peel_rows[ref_row_i];
-			u16 ref_column_i = ref_row->peel_column;
+			uidx ref_column_i = ref_row->peel_column;
 			if (ref_column_i != LIST_TERM)
 			{
 				// Generate temporary row block value:
@@ -1579,7 +2030,7 @@ void Codec::PeelDiagonal()
 		CAT_IF_DUMP(cout << endl;)
 	} // next peeled row
 
-	CAT_IF_ROWOP(cout << "PeelDiagonal used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+	CAT_IF_ROWOP(cout << "PeelDiagonalValues used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
 }
 
 /*
@@ -1596,14 +2047,14 @@ void Codec::CopyDeferredRows()
 
 	// For each deferred row,
 	u64 * CAT_RESTRICT ge_row = _ge_matrix + _ge_pitch * _dense_count;
-	for (u16 ge_row_i = _dense_count, defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM;
+	for (uidx ge_row_i = _dense_count, defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM;
 		defer_row_i = _peel_rows[defer_row_i].next, ge_row += _ge_pitch, ++ge_row_i)
 	{
 		CAT_IF_DUMP(cout << "Peeled row " << defer_row_i << " for GE row " << ge_row_i << endl;)
 
-		// Copy compress row to GE row
-		u64 * CAT_RESTRICT compress_row = _compress_matrix + _ge_pitch * defer_row_i;
-		memcpy(ge_row, compress_row, _ge_pitch * sizeof(u64));
+		// Copy compress row band into GE row (rest of the row was cleared by AllocateMatrix)
+		const CompressRow * CAT_RESTRICT band = &_compress_rows[defer_row_i];
+		memcpy(ge_row + band->first_word, _compress_matrix + band->offset, band->word_count * sizeof(u64));
 
 		// Set row map for this deferred row
 		_ge_row_map[ge_row_i] = defer_row_i;
@@ -1718,31 +2169,101 @@ void Codec::CopyDeferredRows()
 	in the MultiplyDenseValues() function after Triangle() succeeds.
 */
 
-void Codec::MultiplyDenseRows()
-{
-	CAT_IF_DUMP(cout << endl << "---- MultiplyDenseRows ----" << endl << endl;)
+/*
+	SetDenseDecks
 
-	// Initialize PRNG
-	Abyssinian prng;
-	prng.Initialize(_d_seed);
+		Points _dense_decks at the decks for this matrix, publishing a
+	new shared table for N if there is room for it in the cache.
+*/
 
-	// For each block of columns,
-	PeelColumn * CAT_RESTRICT column = _peel_cols;
-	u64 * CAT_RESTRICT temp_row = _ge_matrix + _ge_pitch * (_dense_count + _defer_count);
-	const int dense_count = _dense_count;
-	u16 rows[CAT_MAX_DENSE_ROWS], bits[CAT_MAX_DENSE_ROWS];
-	for (u16 column_i = 0; column_i < _block_count; column_i += dense_count, column += dense_count)
+bool Codec::SetDenseDecks()
+{
+	const u32 slot = ((u32)_block_count * 0x9E3779B1) >> 26;
+	u16 * volatile *shared = &m_deck_cache[slot];
+
+	// If the shared table for this matrix is published, use it
+	u16 *table = (u16 *)AtomicLoadPointer((void * volatile *)shared);
+	if (table && DeckTableMatches(table, _block_count, _dense_count, _d_seed))
 	{
-		CAT_IF_DUMP(cout << "Shuffled dense matrix starting at column " << column_i << ":" << endl;)
+		_dense_decks = table + DECK_HEADER_WORDS;
+		return true;
+	}
+
+	const u32 bytes = DeckTableWords(_block_count, _dense_count) * sizeof(u16);
+
+	// If the slot is empty,
+	if (!table)
+	{
+		// If the budget allows, publish a new table
+		if (AtomicAdd(&m_deck_cache_bytes, bytes) <= CAT_DECK_CACHE_BYTES &&
+			(table = new u16[bytes / sizeof(u16)]) != 0)
+		{
+			GenerateDeckTable(table, _block_count, _dense_count, _d_seed);
+
+			u16 *prior = (u16 *)AtomicCompareSwapPointer((void * volatile *)shared, 0, table);
+			if (!prior)
+			{
+				_dense_decks = table + DECK_HEADER_WORDS;
+				return true;
+			}
+
+			// Another object filled the slot first
+			delete []table;
+			table = prior;
+		}
+
+		AtomicAdd(&m_deck_cache_bytes, (u32)0 - bytes);
+
+		// If the other object published the same decks, use them
+		if (table && DeckTableMatches(table, _block_count, _dense_count, _d_seed))
+		{
+			_dense_decks = table + DECK_HEADER_WORDS;
+			return true;
+		}
+	}
+
+	// If the private table does not already hold these decks,
+	if (!_decks_private || !DeckTableMatches(_decks_private, _block_count, _dense_count, _d_seed))
+	{
+		if (_decks_allocated < bytes)
+		{
+			FreeDecks();
+
+			// Allocate private table
+			_decks_private = new u16[bytes / sizeof(u16)];
+			if (!_decks_private) return false;
+			_decks_allocated = bytes;
+		}
+
+		GenerateDeckTable(_decks_private, _block_count, _dense_count, _d_seed);
+	}
+
+	_dense_decks = _decks_private + DECK_HEADER_WORDS;
+	return true;
+}
+
+void Codec::MultiplyDenseRows()
+{
+	CAT_IF_DUMP(cout << endl << "---- MultiplyDenseRows ----" << endl << endl;)
+
+	// For each block of columns,
+	PeelColumn * CAT_RESTRICT column = _peel_cols;
+	u64 * CAT_RESTRICT temp_row = _ge_matrix + _ge_pitch * (_dense_count + _defer_count);
+	const int dense_count = _dense_count;
+	const u16 * CAT_RESTRICT deck = _dense_decks;
+	for (uidx column_i = 0; column_i < _block_count; column_i += dense_count,
+		column += dense_count, deck += dense_count * 4)
+	{
+		CAT_IF_DUMP(cout << "Shuffled dense matrix starting at column " << column_i << ":" << endl;)
 
 		// Handle final columns
 		int max_x = dense_count;
 		if (column_i + dense_count > _block_count)
 			max_x = _block_count - column_i;
 
-		// Shuffle row and bit order
-		ShuffleDeck16(prng, rows, dense_count);
-		ShuffleDeck16(prng, bits, dense_count);
+		// Read shuffled row and bit order
+		const u16 * CAT_RESTRICT rows = deck;
+		const u16 * CAT_RESTRICT bits = deck + dense_count;
 
 		// Initialize counters
 		const u16 set_count = (dense_count + 1) >> 1;
@@ -1762,13 +2283,12 @@ void Codec::MultiplyDenseRows()
 				if (column[bit_i].mark == MARK_PEEL)
 				{
 					// Add temp row value
-					u64 * CAT_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit_i].peel_row;
-					for (int jj = 0; jj < _ge_pitch; ++jj) temp_row[jj] ^= ge_source_row[jj];
+					AddCompressRow(temp_row, column[bit_i].peel_row);
 				}
 				else
 				{
 					// Set GE bit for deferred column
-					u16 ge_column_i = column[bit_i].ge_column;
+					uidx ge_column_i = column[bit_i].ge_column;
 					temp_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
 				}
 			}
@@ -1784,7 +2304,8 @@ void Codec::MultiplyDenseRows()
 		for (int jj = 0; jj < _ge_pitch; ++jj) ge_dest_row[jj] ^= temp_row[jj];
 
 		// Reshuffle bit order: Shuffle-2 Code
-		ShuffleDeck16(prng, bits, dense_count);
+		set_bits += dense_count;
+		clr_bits += dense_count;
 
 		// Generate first half of rows
 		const int loop_count = (dense_count >> 1);
@@ -1798,13 +2319,12 @@ void Codec::MultiplyDenseRows()
 				if (column[bit0].mark == MARK_PEEL)
 				{
 					// Add temp row value
-					u64 * CAT_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit0].peel_row;
-					for (int jj = 0; jj < _ge_pitch; ++jj) temp_row[jj] ^= ge_source_row[jj];
+					AddCompressRow(temp_row, column[bit0].peel_row);
 				}
 				else
 				{
 					// Set GE bit for deferred column
-					u16 ge_column_i = column[bit0].ge_column;
+					uidx ge_column_i = column[bit0].ge_column;
 					temp_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
 				}
 			}
@@ -1816,13 +2336,12 @@ void Codec::MultiplyDenseRows()
 				if (column[bit1].mark == MARK_PEEL)
 				{
 					// Add temp row value
-					u64 * CAT_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit1].peel_row;
-					for (int jj = 0; jj < _ge_pitch; ++jj) temp_row[jj] ^= ge_source_row[jj];
+					AddCompressRow(temp_row, column[bit1].peel_row);
 				}
 				else
 				{
 					// Set GE bit for deferred column
-					u16 ge_column_i = column[bit1].ge_column;
+					uidx ge_column_i = column[bit1].ge_column;
 					temp_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
 				}
 			}
@@ -1835,7 +2354,8 @@ void Codec::MultiplyDenseRows()
 		} // next row
 
 		// Reshuffle bit order: Shuffle-2 Code
-		ShuffleDeck16(prng, bits, dense_count);
+		set_bits += dense_count;
+		clr_bits += dense_count;
 
 		// Generate second half of rows
 		const int second_loop_count = loop_count - 1 + (dense_count & 1);
@@ -1849,13 +2369,12 @@ void Codec::MultiplyDenseRows()
 				if (column[bit0].mark == MARK_PEEL)
 				{
 					// Add temp row value
-					u64 * CAT_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit0].peel_row;
-					for (int jj = 0; jj < _ge_pitch; ++jj) temp_row[jj] ^= ge_source_row[jj];
+					AddCompressRow(temp_row, column[bit0].peel_row);
 				}
 				else
 				{
 					// Set GE bit for deferred column
-					u16 ge_column_i = column[bit0].ge_column;
+					uidx ge_column_i = column[bit0].ge_column;
 					temp_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
 				}
 			}
@@ -1867,13 +2386,12 @@ void Codec::MultiplyDenseRows()
 				if (column[bit1].mark == MARK_PEEL)
 				{
 					// Add temp row value
-					u64 * CAT_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit1].peel_row;
-					for (int jj = 0; jj < _ge_pitch; ++jj) temp_row[jj] ^= ge_source_row[jj];
+					AddCompressRow(temp_row, column[bit1].peel_row);
 				}
 				else
 				{
 					// Set GE bit for deferred column
-					u16 ge_column_i = column[bit1].ge_column;
+					uidx ge_column_i = column[bit1].ge_column;
 					temp_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
 				}
 			}
@@ -1969,7 +2487,7 @@ void Codec::SetHeavyRows()
 	{
 		// NOTE: Each heavy row is a multiple of 4 bytes in size
 		u32 * CAT_RESTRICT words = reinterpret_cast<u32*>( heavy_row );
-		for (int col_i = 0; col_i < _heavy_columns; col_i += 4)
+		for (int col_i = 0; col_i < (int)_heavy_columns; col_i += 4)
 			*words++ = prng.Next();
 	}
 
@@ -2034,8 +2552,8 @@ void Codec::SetupTriangle()
 	CAT_IF_DUMP(cout << endl << "---- SetupTriangle ----" << endl << endl;)
 
 	// Initialize pivot array to just non-heavy rows
-	const u16 pivot_count = _defer_count + _dense_count;
-	for (u16 pivot_i = 0; pivot_i < pivot_count; ++pivot_i)
+	const uidx pivot_count = _defer_count + _dense_count;
+	for (uidx pivot_i = 0; pivot_i < pivot_count; ++pivot_i)
 		_pivots[pivot_i] = pivot_i;
 
 	// Set resume point to the first column
@@ -2060,20 +2578,20 @@ void Codec::InsertHeavyRows()
 	CAT_IF_DUMP(cout << "Converting remaining extra rows to heavy...";)
 
 	// Initialize index of first heavy pivot
-	u16 first_heavy_pivot = _pivot_count;
+	uidx first_heavy_pivot = _pivot_count;
 
 	// For each remaining pivot in the list,
-	const u16 column_count = _defer_count + _mix_count;
-	const u16 first_heavy_row = _defer_count + _dense_count;
+	const uidx column_count = _defer_count + _mix_count;
+	const uidx first_heavy_row = _defer_count + _dense_count;
 	for (int pivot_j = _pivot_count - 1; pivot_j >= 0; --pivot_j)
 	{
 		// If row is extra,
-		u16 ge_row_j = _pivots[pivot_j];
+		uidx ge_row_j = _pivots[pivot_j];
 		if (ge_row_j < first_heavy_row)
 			continue;
 
 		// If pivot is still unused,
-		if (pivot_j >= _next_pivot)
+		if (pivot_j >= (int)_next_pivot)
 		{
 			// Swap pivot j into last heavy pivot position
 			--first_heavy_pivot;
@@ -2086,7 +2604,7 @@ void Codec::InsertHeavyRows()
 		// Copy heavy columns to heavy matrix row
 		u8 * CAT_RESTRICT extra_row = _heavy_matrix + _heavy_pitch * (ge_row_j - first_heavy_row);
 		u64 * CAT_RESTRICT ge_extra_row = _ge_matrix + _ge_pitch * ge_row_j;
-		for (u16 ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
+		for (uidx ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
 		{
 			extra_row[ge_column_j - _first_heavy_column] = (ge_extra_row[ge_column_j >> 6] >> (ge_column_j & 63)) & 1;
 		}
@@ -2098,7 +2616,7 @@ void Codec::InsertHeavyRows()
 	_first_heavy_pivot = first_heavy_pivot;
 
 	// Add heavy rows at the end to cause them to be selected last if given a choice
-	for (u16 heavy_i = 0; heavy_i < CAT_HEAVY_ROWS; ++heavy_i)
+	for (uidx heavy_i = 0; heavy_i < CAT_HEAVY_ROWS; ++heavy_i)
 	{
 		// Use GE row index after extra count even if not all are used yet
 		_pivots[_pivot_count + heavy_i] = first_heavy_row + _extra_count + heavy_i;
@@ -2121,11 +2639,11 @@ bool Codec::TriangleNonHeavy()
 {
 	CAT_IF_DUMP(cout << endl << "---- TriangleNonHeavy ----" << endl << endl;)
 
-	const u16 pivot_count = _pivot_count;
-	const u16 first_heavy_column = _first_heavy_column;
+	const uidx pivot_count = _pivot_count;
+	const uidx first_heavy_column = _first_heavy_column;
 
 	// For the columns that are not protected by heavy rows,
-	u16 pivot_i = _next_pivot;
+	uidx pivot_i = _next_pivot;
 	u64 ge_mask = (u64)1 << (pivot_i & 63);
 	for (; pivot_i < first_heavy_column; ++pivot_i)
 	{
@@ -2135,10 +2653,10 @@ bool Codec::TriangleNonHeavy()
 
 		// For each remaining GE row that might be the pivot,
 		u64 * CAT_RESTRICT ge_matrix_offset = _ge_matrix + word_offset;
-		for (u16 pivot_j = pivot_i; pivot_j < pivot_count; ++pivot_j)
+		for (uidx pivot_j = pivot_i; pivot_j < pivot_count; ++pivot_j)
 		{
 			// Determine if the row contains the bit we want
-			u16 ge_row_j = _pivots[pivot_j];
+			uidx ge_row_j = _pivots[pivot_j];
 
 			// If the bit was not found,
 			u64 * CAT_RESTRICT ge_row = &ge_matrix_offset[_ge_pitch * ge_row_j];
@@ -2156,10 +2674,10 @@ bool Codec::TriangleNonHeavy()
 			u64 row0 = (*ge_row & ~(ge_mask - 1)) ^ ge_mask;
 
 			// For each remaining unused row,
-			for (u16 pivot_k = pivot_j + 1; pivot_k < pivot_count; ++pivot_k)
+			for (uidx pivot_k = pivot_j + 1; pivot_k < pivot_count; ++pivot_k)
 			{
 				// Determine if the row contains the bit we want
-				u16 ge_row_k = _pivots[pivot_k];
+				uidx ge_row_k = _pivots[pivot_k];
 				u64 * CAT_RESTRICT rem_row = &ge_matrix_offset[_ge_pitch * ge_row_k];
 
 				// If the bit was found,
@@ -2239,33 +2757,33 @@ bool Codec::Triangle()
 {
 	CAT_IF_DUMP(cout << endl << "---- Triangle ----" << endl << endl;)
 
-	const u16 first_heavy_column = _first_heavy_column;
+	const uidx first_heavy_column = _first_heavy_column;
 
 	// If next pivot is not heavy,
 	if (_next_pivot < first_heavy_column && !TriangleNonHeavy())
 		return false;
 
-	const u16 pivot_count = _pivot_count;
-	const u16 column_count = _defer_count + _mix_count;
-	const u16 first_heavy_row = _defer_count + _dense_count;
-	u16 first_heavy_pivot = _first_heavy_pivot;
+	const uidx pivot_count = _pivot_count;
+	const uidx column_count = _defer_count + _mix_count;
+	const uidx first_heavy_row = _defer_count + _dense_count;
+	uidx first_heavy_pivot = _first_heavy_pivot;
 
 	// For each heavy pivot to determine,
 	u64 ge_mask = (u64)1 << (_next_pivot & 63);
-	for (u16 pivot_i = _next_pivot; pivot_i < column_count;
+	for (uidx pivot_i = _next_pivot; pivot_i < column_count;
 		++pivot_i, ge_mask = CAT_ROL64(ge_mask, 1))
 	{
-		const u16 heavy_col_i = pivot_i - first_heavy_column;
+		const uidx heavy_col_i = pivot_i - first_heavy_column;
 
 		// For each remaining GE row that might be the pivot,
 		int word_offset = pivot_i >> 6;
 		u64 * CAT_RESTRICT ge_matrix_offset = _ge_matrix + word_offset;
 		bool found = false;
-		u16 pivot_j;
+		uidx pivot_j;
 		for (pivot_j = pivot_i; pivot_j < first_heavy_pivot; ++pivot_j)
 		{
 			// If the bit was not found,
-			u16 ge_row_j = _pivots[pivot_j];
+			uidx ge_row_j = _pivots[pivot_j];
 			u64 * CAT_RESTRICT ge_row = &ge_matrix_offset[_ge_pitch * ge_row_j];
 			if (!(*ge_row & ge_mask)) continue; // Skip to next
 
@@ -2281,11 +2799,11 @@ bool Codec::Triangle()
 			u64 row0 = (*ge_row & ~(ge_mask - 1)) ^ ge_mask;
 
 			// For each remaining light row,
-			u16 pivot_k = pivot_j + 1;
+			uidx pivot_k = pivot_j + 1;
 			for (; pivot_k < first_heavy_pivot; ++pivot_k)
 			{
 				// Determine if the row contains the bit we want
-				u16 ge_row_k = _pivots[pivot_k];
+				uidx ge_row_k = _pivots[pivot_k];
 				u64 * CAT_RESTRICT rem_row = &ge_matrix_offset[_ge_pitch * ge_row_k];
 
 				// If the bit was found,
@@ -2304,7 +2822,7 @@ bool Codec::Triangle()
 			for (; pivot_k < pivot_count; ++pivot_k)
 			{
 				// If the column is non-zero,
-				u16 heavy_row_k = _pivots[pivot_k] - first_heavy_row;
+				uidx heavy_row_k = _pivots[pivot_k] - first_heavy_row;
 				u8 * CAT_RESTRICT rem_row = &_heavy_matrix[_heavy_pitch * heavy_row_k];
 				u8 code_value = rem_row[heavy_col_i];
 				if (!code_value) continue;
@@ -2324,7 +2842,7 @@ bool Codec::Triangle()
 				}
 #else // CAT_HEAVY_WIN_MULT
 				// Unroll odd columns:
-				u16 odd_count = pivot_i & 3, ge_column_i = pivot_i + 1;
+				uidx odd_count = pivot_i & 3, ge_column_i = pivot_i + 1;
 				u64 temp_mask = ge_mask;
 				switch (odd_count)
 				{
@@ -2383,8 +2901,8 @@ bool Codec::Triangle()
 		if (!found) for (; pivot_j < _pivot_count; ++pivot_j)
 		{
 			// If heavy row doesn't have the pivot,
-			u16 ge_row_j = _pivots[pivot_j];
-			u16 heavy_row_j = ge_row_j - first_heavy_row;
+			uidx ge_row_j = _pivots[pivot_j];
+			uidx heavy_row_j = ge_row_j - first_heavy_row;
 			u8 * CAT_RESTRICT pivot_row = &_heavy_matrix[_heavy_pitch * heavy_row_j];
 			u8 code_value = pivot_row[heavy_col_i];
 			if (!code_value) continue; // Skip to next
@@ -2401,7 +2919,7 @@ bool Codec::Triangle()
 			if (pivot_i < first_heavy_pivot)
 			{
 				// Swap pivot j with first heavy pivot
-				u16 temp = _pivots[first_heavy_pivot];
+				uidx temp = _pivots[first_heavy_pivot];
 				_pivots[first_heavy_pivot] = _pivots[pivot_j];
 				_pivots[pivot_j] = temp;
 
@@ -2410,7 +2928,7 @@ bool Codec::Triangle()
 			}
 
 			// If there are any remaining rows,
-			u16 pivot_k = pivot_j + 1;
+			uidx pivot_k = pivot_j + 1;
 			if (pivot_k < pivot_count)
 			{
 				// For each remaining unused row,
@@ -2418,8 +2936,8 @@ bool Codec::Triangle()
 				for (; pivot_k < pivot_count; ++pivot_k)
 				{
 					// If the column is zero,
-					u16 ge_row_k = _pivots[pivot_k];
-					u16 heavy_row_k = ge_row_k - first_heavy_row;
+					uidx ge_row_k = _pivots[pivot_k];
+					uidx heavy_row_k = ge_row_k - first_heavy_row;
 					u8 * CAT_RESTRICT rem_row = &_heavy_matrix[_heavy_pitch * heavy_row_k];
 					u8 rem_value = rem_row[heavy_col_i];
 					if (!rem_value) continue; // Skip it
@@ -2464,7 +2982,7 @@ bool Codec::Triangle()
 
 		This function initializes the output block value for each column
 	that was solved by Gaussian elimination.  For deferred rows it follows
-	the same steps performed earlier in PeelDiagonal() just for those rows.
+	the same steps performed earlier in PeelDiagonalValues() just for those rows.
 	The row values were not formed at that point because the destination
 	was uncertain.
 
@@ -2486,16 +3004,16 @@ void Codec::InitializeColumnValues()
 
 	CAT_IF_ROWOP(u32 rowops = 0;)
 
-	const u16 first_heavy_row = _defer_count + _dense_count;
-	const u16 column_count = _defer_count + _mix_count;
+	const uidx first_heavy_row = _defer_count + _dense_count;
+	const uidx column_count = _defer_count + _mix_count;
 
 	// For each pivot,
-	u16 pivot_i;
+	uidx pivot_i;
 	for (pivot_i = 0; pivot_i < column_count; ++pivot_i)
 	{
 		// Lookup pivot column, GE row, and destination buffer
-		u16 dest_column_i = _ge_col_map[pivot_i];
-		u16 ge_row_i = _pivots[pivot_i];
+		uidx dest_column_i = _ge_col_map[pivot_i];
+		uidx ge_row_i = _pivots[pivot_i];
 		u8 * CAT_RESTRICT buffer_dest = _recovery_blocks + _block_bytes * dest_column_i;
 
 		CAT_IF_DUMP(cout << "Pivot " << pivot_i << " solving column " << dest_column_i << " with GE row " << ge_row_i << " : ";)
@@ -2517,7 +3035,7 @@ void Codec::InitializeColumnValues()
 		}
 
 		// Look up row and input value for GE row
-		u16 row_i = _ge_row_map[ge_row_i];
+		uidx row_i = _ge_row_map[ge_row_i];
 		const u8 * CAT_RESTRICT combo = _input_blocks + _block_bytes * row_i;
 		PeelRow * CAT_RESTRICT row = &_peel_rows[row_i];
 
@@ -2533,9 +3051,9 @@ void Codec::InitializeColumnValues()
 		}
 
 		// Eliminate peeled columns:
-		u16 column_i = row->peel_x0;
-		u16 a = row->peel_a;
-		u16 weight = row->peel_weight;
+		uidx column_i = row->peel_x0;
+		uidx a = row->peel_a;
+		uidx weight = row->peel_weight;
 		for (;;)
 		{
 			// If column is peeled,
@@ -2567,7 +3085,7 @@ void Codec::InitializeColumnValues()
 	// For each remaining pivot,
 	for (; pivot_i < _pivot_count; ++pivot_i)
 	{
-		u16 ge_row_i = _pivots[pivot_i];
+		uidx ge_row_i = _pivots[pivot_i];
 
 		// If row is a dense row,
 		if (ge_row_i < _dense_count ||
@@ -2605,19 +3123,15 @@ void Codec::MultiplyDenseValues()
 
 	CAT_IF_ROWOP(u32 rowops = 0;)
 
-	// Initialize PRNG
-	Abyssinian prng;
-	prng.Initialize(_d_seed);
-
 	// For each block of columns,
 	const int dense_count = _dense_count;
 	u8 * CAT_RESTRICT temp_block = _recovery_blocks + _block_bytes * (_block_count + _mix_count);
 	const u8 * CAT_RESTRICT source_block = _recovery_blocks;
 	PeelColumn * CAT_RESTRICT column = _peel_cols;
-	u16 rows[CAT_MAX_DENSE_ROWS], bits[CAT_MAX_DENSE_ROWS];
-	const u16 block_count = _block_count;
-	for (u16 column_i = 0; column_i < block_count; column_i += dense_count,
-		column += dense_count, source_block += _block_bytes * dense_count)
+	const u16 * CAT_RESTRICT deck = _dense_decks;
+	const uidx block_count = _block_count;
+	for (uidx column_i = 0; column_i < block_count; column_i += dense_count,
+		column += dense_count, source_block += _block_bytes * dense_count, deck += dense_count * 4)
 	{
 		// Handle final columns
 		int max_x = dense_count;
@@ -2626,14 +3140,14 @@ void Codec::MultiplyDenseValues()
 
 		CAT_IF_DUMP(cout << endl << "For window of columns between " << column_i << " and " << column_i + dense_count - 1 << " (inclusive):" << endl;)
 
-		// Shuffle row and bit order
-		ShuffleDeck16(prng, rows, dense_count);
-		ShuffleDeck16(prng, bits, dense_count);
+		// Read shuffled row and bit order
+		const u16 * CAT_RESTRICT rows = deck;
+		const u16 * CAT_RESTRICT bits = deck + dense_count;
 
 		// Initialize counters
 		u16 set_count = (dense_count + 1) >> 1;
-		u16 * CAT_RESTRICT set_bits = bits;
-		u16 * CAT_RESTRICT clr_bits = set_bits + set_count;
+		const u16 * CAT_RESTRICT set_bits = bits;
+		const u16 * CAT_RESTRICT clr_bits = set_bits + set_count;
 		const u16 * CAT_RESTRICT row = rows;
 
 		CAT_IF_DUMP(cout << "Generating first row " << _ge_row_map[*row] << ":";)
@@ -2684,7 +3198,7 @@ void Codec::MultiplyDenseValues()
 			}
 
 			// Store in destination column in recovery blocks
-			u16 dest_column_i = _ge_row_map[*row];
+			uidx dest_column_i = _ge_row_map[*row];
 			if (dest_column_i != LIST_TERM)
 			{
 				memxor(_recovery_blocks + _block_bytes * dest_column_i, temp_block, _block_bytes);
@@ -2694,7 +3208,8 @@ void Codec::MultiplyDenseValues()
 		++row;
 
 		// Reshuffle bit order: Shuffle-2 Code
-		ShuffleDeck16(prng, bits, dense_count);
+		set_bits += dense_count;
+		clr_bits += dense_count;
 
 		// Generate first half of rows
 		const int loop_count = (dense_count >> 1);
@@ -2728,7 +3243,7 @@ void Codec::MultiplyDenseValues()
 			CAT_IF_DUMP(cout << endl;)
 
 			// Store in destination column in recovery blocks
-			u16 dest_column_i = _ge_row_map[*row++];
+			uidx dest_column_i = _ge_row_map[*row++];
 			if (dest_column_i != LIST_TERM)
 			{
 				memxor(_recovery_blocks + _block_bytes * dest_column_i, temp_block, _block_bytes);
@@ -2737,7 +3252,8 @@ void Codec::MultiplyDenseValues()
 		}
 
 		// Reshuffle bit order: Shuffle-2 Code
-		ShuffleDeck16(prng, bits, dense_count);
+		set_bits += dense_count;
+		clr_bits += dense_count;
 
 		// Generate second half of rows
 		const int second_loop_count = loop_count - 1 + (dense_count & 1);
@@ -2771,7 +3287,7 @@ void Codec::MultiplyDenseValues()
 			CAT_IF_DUMP(cout << endl;)
 
 			// Store in destination column in recovery blocks
-			u16 dest_column_i = _ge_row_map[*row++];
+			uidx dest_column_i = _ge_row_map[*row++];
 			if (dest_column_i != LIST_TERM)
 			{
 				memxor(_recovery_blocks + _block_bytes * dest_column_i, temp_block, _block_bytes);
@@ -2791,6 +3307,10 @@ void Codec::MultiplyDenseValues()
 	to generate the row values for both deferred and dense rows.
 	It is aided by the already roughly upper-triangular form
 	of the GE matrix, making this function very cheap to execute.
+
+		Every block operation here works on each byte independently,
+	so it only touches bytes [offset, offset + bytes) of each block
+	and can run on separate byte ranges in parallel.
 */
 
 // These are heuristic values.  Choosing better values has little effect on performance.
@@ -2799,18 +3319,21 @@ void Codec::MultiplyDenseValues()
 #define CAT_UNDER_WIN_THRESH_6 (85 + 6)
 #define CAT_UNDER_WIN_THRESH_7 (138 + 7)
 
-void Codec::AddSubdiagonalValues()
+void Codec::AddSubdiagonalValues(u32 offset, u32 bytes)
 {
 	CAT_IF_DUMP(cout << endl << "---- AddSubdiagonalValues ----" << endl << endl;)
 
+	// Only this byte range of each block is processed
+	u8 * CAT_RESTRICT recovery_blocks = _recovery_blocks + offset;
+
 	CAT_IF_ROWOP(u32 rowops = 0; int heavyops = 0;)
 
 	const int column_count = _defer_count + _mix_count;
 	int pivot_i = 0;
-	const u16 first_heavy_row = _defer_count + _dense_count;
+	const uidx first_heavy_row = _defer_count + _dense_count;
 
 #if defined(CAT_WINDOWED_LOWERTRI)
-	const u16 first_non_binary_row = first_heavy_row + _extra_count;
+	const uidx first_non_binary_row = first_heavy_row + _extra_count;
 
 	// Build temporary storage space if windowing is to be used
 	if (column_count >= CAT_UNDER_WIN_THRESH_5)
@@ -2846,7 +3369,7 @@ void Codec::AddSubdiagonalValues()
 		// but now they are unused, and so they can be reused for temporary space.
 		u8 * CAT_RESTRICT win_table[128];
 		PeelColumn * CAT_RESTRICT column = _peel_cols;
-		u8 * CAT_RESTRICT column_src = _recovery_blocks;
+		u8 * CAT_RESTRICT column_src = recovery_blocks;
 		u32 jj = 1;
 		for (u32 count = _block_count; count > 0; --count, ++column, column_src += _block_bytes)
 		{
@@ -2869,7 +3392,7 @@ void Codec::AddSubdiagonalValues()
 		if (jj >= win_lim) for (;;)
 		{
 			// Calculate first column in window
-			u16 final_i = pivot_i + w - 1;
+			uidx final_i = pivot_i + w - 1;
 
 			CAT_IF_DUMP(cout << "-- Windowing from " << pivot_i << " to " << final_i << " (inclusive)" << endl;)
 
@@ -2877,26 +3400,26 @@ void Codec::AddSubdiagonalValues()
 
 			// For each column,
 			u64 ge_mask = (u64)1 << (pivot_i & 63);
-			for (int src_pivot_i = pivot_i; src_pivot_i < final_i;
+			for (int src_pivot_i = pivot_i; src_pivot_i < (int)final_i;
 				++src_pivot_i, ge_mask = CAT_ROL64(ge_mask, 1))
 			{
-				u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
+				u8 * CAT_RESTRICT src = recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
 
 				CAT_IF_DUMP(cout << "Back-substituting small triangle from pivot " << src_pivot_i << "[" << (int)src[0] << "] :";)
 
 				// For each row above the diagonal,
 				u64 * CAT_RESTRICT ge_row = _ge_matrix + (src_pivot_i >> 6);
-				for (int dest_pivot_i = src_pivot_i + 1; dest_pivot_i <= final_i; ++dest_pivot_i)
+				for (int dest_pivot_i = src_pivot_i + 1; dest_pivot_i <= (int)final_i; ++dest_pivot_i)
 				{
 					// If row is heavy,
-					u16 dest_row_i = _pivots[dest_pivot_i];
+					uidx dest_row_i = _pivots[dest_pivot_i];
 
 					// If bit is set in that row,
 					if (ge_row[_ge_pitch * dest_row_i] & ge_mask)
 					{
 						// Back-substitute
-						u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
-						memxor(dest, src, _block_bytes);
+						u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+						memxor(dest, src, bytes);
 						CAT_IF_ROWOP(++rowops;)
 
 						CAT_IF_DUMP(cout << " " << dest_pivot_i;)
@@ -2909,44 +3432,44 @@ void Codec::AddSubdiagonalValues()
 			CAT_IF_DUMP(cout << "-- Generating window table with " << w << " bits" << endl;)
 
 			// Generate window table: 2 bits
-			win_table[1] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
-			win_table[2] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 1];
-			memxor_set(win_table[3], win_table[1], win_table[2], _block_bytes);
+			win_table[1] = recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
+			win_table[2] = recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 1];
+			memxor_set(win_table[3], win_table[1], win_table[2], bytes);
 			CAT_IF_ROWOP(++rowops;)
 
 			// Generate window table: 3 bits
-			win_table[4] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 2];
-			memxor_set(win_table[5], win_table[1], win_table[4], _block_bytes);
-			memxor_set(win_table[6], win_table[2], win_table[4], _block_bytes);
-			memxor_set(win_table[7], win_table[1], win_table[6], _block_bytes);
+			win_table[4] = recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 2];
+			memxor_set(win_table[5], win_table[1], win_table[4], bytes);
+			memxor_set(win_table[6], win_table[2], win_table[4], bytes);
+			memxor_set(win_table[7], win_table[1], win_table[6], bytes);
 			CAT_IF_ROWOP(rowops += 3;)
 
 			// Generate window table: 4 bits
-			win_table[8] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 3];
+			win_table[8] = recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 3];
 			for (int ii = 1; ii < 8; ++ii)
-				memxor_set(win_table[8 + ii], win_table[ii], win_table[8], _block_bytes);
+				memxor_set(win_table[8 + ii], win_table[ii], win_table[8], bytes);
 			CAT_IF_ROWOP(rowops += 7;)
 
 			// Generate window table: 5+ bits
 			if (w >= 5)
 			{
-				win_table[16] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 4];
+				win_table[16] = recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 4];
 				for (int ii = 1; ii < 16; ++ii)
-					memxor_set(win_table[16 + ii], win_table[ii], win_table[16], _block_bytes);
+					memxor_set(win_table[16 + ii], win_table[ii], win_table[16], bytes);
 				CAT_IF_ROWOP(rowops += 15;)
 
 				if (w >= 6)
 				{
-					win_table[32] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 5];
+					win_table[32] = recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 5];
 					for (int ii = 1; ii < 32; ++ii)
-						memxor_set(win_table[32 + ii], win_table[ii], win_table[32], _block_bytes);
+						memxor_set(win_table[32 + ii], win_table[ii], win_table[32], bytes);
 					CAT_IF_ROWOP(rowops += 31;)
 
 					if (w >= 7)
 					{
-						win_table[64] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 6];
+						win_table[64] = recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 6];
 						for (int ii = 1; ii < 64; ++ii)
-							memxor_set(win_table[64 + ii], win_table[ii], win_table[64], _block_bytes);
+							memxor_set(win_table[64 + ii], win_table[ii], win_table[64], bytes);
 						CAT_IF_ROWOP(rowops += 63;)
 					}
 				}
@@ -2956,14 +3479,14 @@ void Codec::AddSubdiagonalValues()
 			u32 first_word = pivot_i >> 6;
 			u32 shift0 = pivot_i & 63;
 			u32 last_word = final_i >> 6;
-			u16 * CAT_RESTRICT pivot_row = _pivots + final_i + 1;
+			uidx * CAT_RESTRICT pivot_row = _pivots + final_i + 1;
 			if (first_word == last_word)
 			{
 				// For each pivot row,
-				for (u16 ge_below_i = final_i + 1; ge_below_i < column_count; ++ge_below_i)
+				for (uidx ge_below_i = final_i + 1; (int)ge_below_i < column_count; ++ge_below_i)
 				{
 					// If pivot row is heavy,
-					u16 ge_row_i = *pivot_row++;
+					uidx ge_row_i = *pivot_row++;
 					if (ge_row_i >= first_non_binary_row) continue;
 
 					// Calculate window bits
@@ -2976,8 +3499,8 @@ void Codec::AddSubdiagonalValues()
 						CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << ge_below_i << endl;)
 
 						// Back-substitute
-						u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
-						memxor(dest, win_table[win_bits], _block_bytes);
+						u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
+						memxor(dest, win_table[win_bits], bytes);
 						CAT_IF_ROWOP(++rowops;)
 					}
 				}
@@ -2987,10 +3510,10 @@ void Codec::AddSubdiagonalValues()
 				u32 shift1 = 64 - shift0;
 
 				// For each pivot row,
-				for (u16 ge_below_i = final_i + 1; ge_below_i < column_count; ++ge_below_i)
+				for (uidx ge_below_i = final_i + 1; (int)ge_below_i < column_count; ++ge_below_i)
 				{
 					// If pivot row is heavy,
-					u16 ge_row_i = *pivot_row++;
+					uidx ge_row_i = *pivot_row++;
 					if (ge_row_i >= first_non_binary_row) continue;
 
 					// Calculate window bits
@@ -3003,8 +3526,8 @@ void Codec::AddSubdiagonalValues()
 						CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << ge_below_i << endl;)
 
 						// Back-substitute
-						u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
-						memxor(dest, win_table[win_bits], _block_bytes);
+						u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
+						memxor(dest, win_table[win_bits], bytes);
 						CAT_IF_ROWOP(++rowops;)
 					}
 				}
@@ -3041,34 +3564,34 @@ void Codec::AddSubdiagonalValues()
 #endif // CAT_WINDOWED_LOWERTRI
 
 	// For each row to eliminate,
-	for (u16 ge_column_i = pivot_i + 1; ge_column_i < column_count; ++ge_column_i)
+	for (uidx ge_column_i = pivot_i + 1; (int)ge_column_i < column_count; ++ge_column_i)
 	{
 		// Lookup pivot column, GE row, and destination buffer
-		u16 column_i = _ge_col_map[ge_column_i];
-		u16 ge_row_i = _pivots[ge_column_i];
-		u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * column_i;
+		uidx column_i = _ge_col_map[ge_column_i];
+		uidx ge_row_i = _pivots[ge_column_i];
+		u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * column_i;
 
 		CAT_IF_DUMP(cout << "Pivot " << ge_column_i << " solving column " << column_i << "[" << (int)dest[0] << "] with GE row " << ge_row_i << " :";)
 
-		u16 ge_limit = ge_column_i;
+		uidx ge_limit = ge_column_i;
 
 		// If row is heavy or extra,
 		if (ge_row_i >= first_heavy_row)
 		{
-			u16 heavy_row_i = ge_row_i - first_heavy_row;
+			uidx heavy_row_i = ge_row_i - first_heavy_row;
 
 			// For each column up to the diagonal,
 			u8 * CAT_RESTRICT heavy_row = _heavy_matrix + _heavy_pitch * heavy_row_i;
-			for (u16 sub_i = _first_heavy_column; sub_i < ge_limit; ++sub_i)
+			for (uidx sub_i = _first_heavy_column; sub_i < ge_limit; ++sub_i)
 			{
 				// If column is zero,
 				u8 code_value = heavy_row[sub_i - _first_heavy_column];
 				if (!code_value) continue; // Skip it
 
 				// Look up data source
-				const u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[sub_i];
+				const u8 * CAT_RESTRICT src = recovery_blocks + _block_bytes * _ge_col_map[sub_i];
 
-				GF256MemMulAdd(dest, code_value, src, _block_bytes);
+				GF256MemMulAdd(dest, code_value, src, bytes);
 				CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
 				CAT_IF_DUMP(cout << " h" << ge_column_i << "=[" << (int)src[0] << "*" << (int)code_value << "]";)
 			}
@@ -3090,15 +3613,15 @@ void Codec::AddSubdiagonalValues()
 		// For each GE matrix bit in the row,
 		u64 * CAT_RESTRICT ge_row = _ge_matrix + _ge_pitch * ge_row_i;
 		u64 ge_mask = (u64)1 << (pivot_i & 63);
-		for (u16 ge_sub_i = pivot_i; ge_sub_i < ge_limit; ++ge_sub_i, ge_mask = CAT_ROL64(ge_mask, 1))
+		for (uidx ge_sub_i = pivot_i; ge_sub_i < ge_limit; ++ge_sub_i, ge_mask = CAT_ROL64(ge_mask, 1))
 		{
 			// If bit is non-zero,
 			if (ge_row[ge_sub_i >> 6] & ge_mask)
 			{
 				// Add pivot for non-zero bit to destination row value
-				u16 column_i = _ge_col_map[ge_sub_i];
-				const u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * column_i;
-				memxor(dest, src, _block_bytes);
+				uidx column_i = _ge_col_map[ge_sub_i];
+				const u8 * CAT_RESTRICT src = recovery_blocks + _block_bytes * column_i;
+				memxor(dest, src, bytes);
 				CAT_IF_ROWOP(++rowops;)
 
 				CAT_IF_DUMP(cout << " " << ge_sub_i << "=[" << (int)src[0] << "]";)
@@ -3187,19 +3710,23 @@ void Codec::AddSubdiagonalValues()
 
 		This function uses the windowed approach outlined above
 	to eliminate all of the bits in the upper triangular half,
-	completing solving for these columns.
+	completing solving for these columns.  Like AddSubdiagonalValues()
+	it only works on one byte range of each block.
 */
 
-void Codec::BackSubstituteAboveDiagonal()
+void Codec::BackSubstituteAboveDiagonal(u32 offset, u32 bytes)
 {
 	CAT_IF_DUMP(cout << endl << "---- BackSubstituteAboveDiagonal ----" << endl << endl;)
 
+	// Only this byte range of each block is processed
+	u8 * CAT_RESTRICT recovery_blocks = _recovery_blocks + offset;
+
 	CAT_IF_ROWOP(u32 rowops = 0; int heavyops = 0;)
 
 	const int pivot_count = _defer_count + _mix_count;
 	int pivot_i = pivot_count - 1;
-	const u16 first_heavy_row = _defer_count + _dense_count;
-	const u16 first_heavy_column = _first_heavy_column;
+	const uidx first_heavy_row = _defer_count + _dense_count;
+	const uidx first_heavy_column = _first_heavy_column;
 
 #if defined(CAT_WINDOWED_BACKSUB)
 	// Build temporary storage space if windowing is to be used
@@ -3236,7 +3763,7 @@ void Codec::BackSubstituteAboveDiagonal()
 		// but now they are unused, and so they can be reused for temporary space.
 		u8 * CAT_RESTRICT win_table[128];
 		PeelColumn * CAT_RESTRICT column = _peel_cols;
-		u8 * CAT_RESTRICT column_src = _recovery_blocks;
+		u8 * CAT_RESTRICT column_src = recovery_blocks;
 		u32 jj = 1;
 		for (u32 count = _block_count; count > 0; --count, ++column, column_src += _block_bytes)
 		{
@@ -3259,7 +3786,7 @@ void Codec::BackSubstituteAboveDiagonal()
 		if (jj >= win_lim) for (;;)
 		{
 			// Calculate first column in window
-			u16 backsub_i = pivot_i - w + 1;
+			uidx backsub_i = pivot_i - w + 1;
 
 			CAT_IF_DUMP(cout << "-- Windowing from " << backsub_i << " to " << pivot_i << " (inclusive)" << endl;)
 
@@ -3267,24 +3794,24 @@ void Codec::BackSubstituteAboveDiagonal()
 
 			// For each column,
 			u64 ge_mask = (u64)1 << (pivot_i & 63);
-			for (int src_pivot_i = pivot_i; src_pivot_i > backsub_i;
+			for (int src_pivot_i = pivot_i; src_pivot_i > (int)backsub_i;
 				--src_pivot_i, ge_mask = CAT_ROR64(ge_mask, 1))
 			{
-				u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
+				u8 * CAT_RESTRICT src = recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
 
 				// If diagonal element is heavy,
-				u16 ge_row_i = _pivots[src_pivot_i];
-				if (ge_row_i >= first_heavy_row && src_pivot_i >= first_heavy_column)
+				uidx ge_row_i = _pivots[src_pivot_i];
+				if (ge_row_i >= first_heavy_row && src_pivot_i >= (int)first_heavy_column)
 				{
 					// Look up row value
-					u16 heavy_row_i = ge_row_i - first_heavy_row;
-					u16 heavy_col_i = src_pivot_i - first_heavy_column;
+					uidx heavy_row_i = ge_row_i - first_heavy_row;
+					uidx heavy_col_i = src_pivot_i - first_heavy_column;
 					u8 code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 
 					// Normalize code value, setting it to 1 (implicitly nonzero)
 					if (code_value != 1)
 					{
-						GF256MemDivide(src, code_value, _block_bytes);
+						GF256MemDivide(src, code_value, bytes);
 						CAT_IF_ROWOP(++heavyops;)
 					}
 
@@ -3298,18 +3825,18 @@ void Codec::BackSubstituteAboveDiagonal()
 				for (int dest_pivot_i = backsub_i; dest_pivot_i < src_pivot_i; ++dest_pivot_i)
 				{
 					// If row is heavy,
-					u16 dest_row_i = _pivots[dest_pivot_i];
-					if (dest_row_i >= first_heavy_row && src_pivot_i >= first_heavy_column)
+					uidx dest_row_i = _pivots[dest_pivot_i];
+					if (dest_row_i >= first_heavy_row && src_pivot_i >= (int)first_heavy_column)
 					{
 						// If column is zero,
-						u16 heavy_row_i = dest_row_i - first_heavy_row;
-						u16 heavy_col_i = src_pivot_i - first_heavy_column;
+						uidx heavy_row_i = dest_row_i - first_heavy_row;
+						uidx heavy_col_i = src_pivot_i - first_heavy_column;
 						u8 code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 						if (!code_value) continue; // Skip it
 
 						// Back-substitute
-						u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
-						GF256MemMulAdd(dest, code_value, src, _block_bytes);
+						u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+						GF256MemMulAdd(dest, code_value, src, bytes);
 						CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
 						CAT_IF_DUMP(cout << " h" << dest_pivot_i;)
 					}
@@ -3319,8 +3846,8 @@ void Codec::BackSubstituteAboveDiagonal()
 						if (ge_row[_ge_pitch * dest_row_i] & ge_mask)
 						{
 							// Back-substitute
-							u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
-							memxor(dest, src, _block_bytes);
+							u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+							memxor(dest, src, bytes);
 							CAT_IF_ROWOP(++rowops;)
 
 							CAT_IF_DUMP(cout << " " << dest_pivot_i;)
@@ -3332,19 +3859,19 @@ void Codec::BackSubstituteAboveDiagonal()
 			} // next pivot
 
 			// Normalize the final diagonal element
-			u16 ge_row_i = _pivots[backsub_i];
+			uidx ge_row_i = _pivots[backsub_i];
 			if (ge_row_i >= first_heavy_row && backsub_i >= first_heavy_column)
 			{
 				// Look up row value
-				u16 heavy_row_i = ge_row_i - first_heavy_row;
-				u16 heavy_col_i = backsub_i - first_heavy_column;
+				uidx heavy_row_i = ge_row_i - first_heavy_row;
+				uidx heavy_col_i = backsub_i - first_heavy_column;
 				u8 code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 
 				// Divide by this code value (implicitly nonzero)
 				if (code_value != 1)
 				{
-					u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
-					GF256MemDivide(src, code_value, _block_bytes);
+					u8 * CAT_RESTRICT src = recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
+					GF256MemDivide(src, code_value, bytes);
 					CAT_IF_ROWOP(++heavyops;)
 				}
 			}
@@ -3352,115 +3879,115 @@ void Codec::BackSubstituteAboveDiagonal()
 			CAT_IF_DUMP(cout << "-- Generating window table with " << w << " bits" << endl;)
 
 			// Generate window table: 2 bits
-			win_table[1] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
-			win_table[2] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 1];
-			memxor_set(win_table[3], win_table[1], win_table[2], _block_bytes);
+			win_table[1] = recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
+			win_table[2] = recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 1];
+			memxor_set(win_table[3], win_table[1], win_table[2], bytes);
 			CAT_IF_ROWOP(++rowops;)
 
 			// Generate window table: 3 bits
-			win_table[4] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 2];
-			memxor_set(win_table[5], win_table[1], win_table[4], _block_bytes);
-			memxor_set(win_table[6], win_table[2], win_table[4], _block_bytes);
-			memxor_set(win_table[7], win_table[1], win_table[6], _block_bytes);
+			win_table[4] = recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 2];
+			memxor_set(win_table[5], win_table[1], win_table[4], bytes);
+			memxor_set(win_table[6], win_table[2], win_table[4], bytes);
+			memxor_set(win_table[7], win_table[1], win_table[6], bytes);
 			CAT_IF_ROWOP(rowops += 3;)
 
 			// Generate window table: 4 bits
-			win_table[8] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 3];
+			win_table[8] = recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 3];
 			for (int ii = 1; ii < 8; ++ii)
-				memxor_set(win_table[8 + ii], win_table[ii], win_table[8], _block_bytes);
+				memxor_set(win_table[8 + ii], win_table[ii], win_table[8], bytes);
 			CAT_IF_ROWOP(rowops += 7;)
 
 			// Generate window table: 5+ bits
 			if (w >= 5)
 			{
-				win_table[16] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 4];
+				win_table[16] = recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 4];
 				for (int ii = 1; ii < 16; ++ii)
-					memxor_set(win_table[16 + ii], win_table[ii], win_table[16], _block_bytes);
+					memxor_set(win_table[16 + ii], win_table[ii], win_table[16], bytes);
 				CAT_IF_ROWOP(rowops += 15;)
 
 				if (w >= 6)
 				{
-					win_table[32] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 5];
+					win_table[32] = recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 5];
 					for (int ii = 1; ii < 32; ++ii)
-						memxor_set(win_table[32 + ii], win_table[ii], win_table[32], _block_bytes);
+						memxor_set(win_table[32 + ii], win_table[ii], win_table[32], bytes);
 					CAT_IF_ROWOP(rowops += 31;)
 
 					if (w >= 7)
 					{
-						win_table[64] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 6];
+						win_table[64] = recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 6];
 						for (int ii = 1; ii < 64; ++ii)
-							memxor_set(win_table[64 + ii], win_table[ii], win_table[64], _block_bytes);
+							memxor_set(win_table[64 + ii], win_table[ii], win_table[64], bytes);
 						CAT_IF_ROWOP(rowops += 63;)
 					}
 				}
 			}
 
 			// If a row above the window may be heavy,
-			if (pivot_i >= first_heavy_column)
+			if (pivot_i >= (int)first_heavy_column)
 			{
 				// For each pivot in the window,
-				u16 * CAT_RESTRICT pivot_row = _pivots;
-				for (u16 ge_above_i = 0; ge_above_i < backsub_i; ++ge_above_i)
+				uidx * CAT_RESTRICT pivot_row = _pivots;
+				for (uidx ge_above_i = 0; ge_above_i < backsub_i; ++ge_above_i)
 				{
 					// If row is not heavy,
-					u16 ge_row_i = *pivot_row++;
+					uidx ge_row_i = *pivot_row++;
 					if (ge_row_i < first_heavy_row)
 						continue; // Skip it
 
-					u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_above_i];
+					u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[ge_above_i];
 
 					// If the first column of window is not heavy,
-					u16 ge_column_j = backsub_i;
+					uidx ge_column_j = backsub_i;
 					if (ge_column_j < first_heavy_column)
 					{
 						// For each non-heavy column in the extra row,
 						u64 ge_mask = (u64)1 << (ge_column_j & 63);
 						u64 * CAT_RESTRICT ge_row = _ge_matrix + _ge_pitch * ge_row_i;
-						for (; ge_column_j < first_heavy_column && ge_column_j <= pivot_i; ++ge_column_j, ge_mask = CAT_ROL64(ge_mask, 1))
+						for (; ge_column_j < first_heavy_column && (int)ge_column_j <= pivot_i; ++ge_column_j, ge_mask = CAT_ROL64(ge_mask, 1))
 						{
 							// If column is non-zero,
 							if (ge_row[ge_column_j >> 6] & ge_mask)
 							{
-								const u8 *src = _recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
-								memxor(dest, src, _block_bytes);
+								const u8 *src = recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
+								memxor(dest, src, bytes);
 								CAT_IF_ROWOP(++rowops;)
 							}
 						}
 					}
 
 					// For each heavy column,
-					u16 heavy_row_i = ge_row_i - first_heavy_row;
-					u16 heavy_col_j = ge_column_j - first_heavy_column;
+					uidx heavy_row_i = ge_row_i - first_heavy_row;
+					uidx heavy_col_j = ge_column_j - first_heavy_column;
 					u8 * CAT_RESTRICT heavy_row = &_heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_j];
-					for (; ge_column_j <= pivot_i; ++ge_column_j)
+					for (; (int)ge_column_j <= pivot_i; ++ge_column_j)
 					{
 						// If zero,
 						u8 code_value = *heavy_row++;
 						if (!code_value) continue; // Skip it
 
 						// Back-substitute
-						const u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
-						GF256MemMulAdd(dest, code_value, src, _block_bytes);
+						const u8 * CAT_RESTRICT src = recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
+						GF256MemMulAdd(dest, code_value, src, bytes);
 						CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
 					} // next column in row
 				} // next pivot in window
 			} // end if contains heavy
 
 			// Only add window table entries for rows under this limit
-			u16 window_row_limit = (pivot_i >= first_heavy_column) ? first_heavy_row : 0x7fff;
+			uidx window_row_limit = (pivot_i >= (int)first_heavy_column) ? first_heavy_row : LIST_TERM;
 
 			// If not straddling words,
 			u32 first_word = backsub_i >> 6;
 			u32 shift0 = backsub_i & 63;
 			u32 last_word = pivot_i >> 6;
-			u16 * CAT_RESTRICT pivot_row = _pivots;
+			uidx * CAT_RESTRICT pivot_row = _pivots;
 			if (first_word == last_word)
 			{
 				// For each pivot row,
-				for (u16 above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
+				for (uidx above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
 				{
 					// If pivot row is heavy,
-					u16 ge_row_i = *pivot_row++;
+					uidx ge_row_i = *pivot_row++;
 					if (ge_row_i >= window_row_limit)
 						continue; // Skip it
 
@@ -3474,8 +4001,8 @@ void Codec::BackSubstituteAboveDiagonal()
 						CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << above_pivot_i << endl;)
 
 						// Back-substitute
-						u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
-						memxor(dest, win_table[win_bits], _block_bytes);
+						u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
+						memxor(dest, win_table[win_bits], bytes);
 						CAT_IF_ROWOP(++rowops;)
 					}
 				}
@@ -3485,10 +4012,10 @@ void Codec::BackSubstituteAboveDiagonal()
 				u32 shift1 = 64 - shift0;
 
 				// For each pivot row,
-				for (u16 above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
+				for (uidx above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
 				{
 					// If pivot row is heavy,
-					u16 ge_row_i = *pivot_row++;
+					uidx ge_row_i = *pivot_row++;
 					if (ge_row_i >= window_row_limit)
 						continue; // Skip it
 
@@ -3502,8 +4029,8 @@ void Codec::BackSubstituteAboveDiagonal()
 						CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << above_pivot_i << endl;)
 
 						// Back-substitute
-						u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
-						memxor(dest, win_table[win_bits], _block_bytes);
+						u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
+						memxor(dest, win_table[win_bits], bytes);
 						CAT_IF_ROWOP(++rowops;)
 					}
 				}
@@ -3542,21 +4069,21 @@ void Codec::BackSubstituteAboveDiagonal()
 	for (; pivot_i >= 0; --pivot_i, ge_mask = CAT_ROR64(ge_mask, 1))
 	{
 		// Calculate source
-		u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
+		u8 * CAT_RESTRICT src = recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
 
 		// If diagonal element is heavy,
-		u16 ge_row_i = _pivots[pivot_i];
-		if (ge_row_i >= first_heavy_row && pivot_i >= first_heavy_column)
+		uidx ge_row_i = _pivots[pivot_i];
+		if (ge_row_i >= first_heavy_row && pivot_i >= (int)first_heavy_column)
 		{
 			// Look up row value
-			u16 heavy_row_i = ge_row_i - first_heavy_row;
-			u16 heavy_col_i = pivot_i - first_heavy_column;
+			uidx heavy_row_i = ge_row_i - first_heavy_row;
+			uidx heavy_col_i = pivot_i - first_heavy_column;
 			u8 code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 
 			// Normalize code value, setting it to 1 (implicitly nonzero)
 			if (code_value != 1)
 			{
-				GF256MemDivide(src, code_value, _block_bytes);
+				GF256MemDivide(src, code_value, bytes);
 				CAT_IF_ROWOP(++heavyops;)
 			}
 
@@ -3570,18 +4097,18 @@ void Codec::BackSubstituteAboveDiagonal()
 		for (int ge_up_i = 0; ge_up_i < pivot_i; ++ge_up_i)
 		{
 			// If element is heavy,
-			u16 up_row_i = _pivots[ge_up_i];
-			if (up_row_i >= first_heavy_row && ge_up_i >= first_heavy_column)
+			uidx up_row_i = _pivots[ge_up_i];
+			if (up_row_i >= first_heavy_row && ge_up_i >= (int)first_heavy_column)
 			{
 				// If column is zero,
-				u16 heavy_row_i = up_row_i - first_heavy_row;
-				u16 heavy_col_i = pivot_i - first_heavy_column;
+				uidx heavy_row_i = up_row_i - first_heavy_row;
+				uidx heavy_col_i = pivot_i - first_heavy_column;
 				u8 code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 				if (!code_value) continue; // Skip it
 
 				// Back-substitute
-				u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
-				GF256MemMulAdd(dest, code_value, src, _block_bytes);
+				u8 * CAT_RESTRICT dest = recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
+				GF256MemMulAdd(dest, code_value, src, bytes);
 				CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
 				CAT_IF_DUMP(cout << " h" << up_row_i;)
 			}
@@ -3591,8 +4118,8 @@ void Codec::BackSubstituteAboveDiagonal()
 				if (ge_row[_ge_pitch * up_row_i] & ge_mask)
 				{
 					// Back-substitute
-					u8 *dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
-					memxor(dest, src, _block_bytes);
+					u8 *dest = recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
+					memxor(dest, src, bytes);
 					CAT_IF_ROWOP(++rowops;)
 
 					CAT_IF_DUMP(cout << " " << up_row_i;)
@@ -3606,6 +4133,28 @@ void Codec::BackSubstituteAboveDiagonal()
 	CAT_IF_ROWOP(cout << "BackSubstituteAboveDiagonal used " << rowops << " row ops = " << rowops / (double)_block_count << "*N and " << heavyops << " heavy ops" << endl;)
 }
 
+void Codec::AddSubdiagonalTask(void *job, int index)
+{
+	SliceJob *sj = reinterpret_cast<SliceJob *>( job );
+	Codec *codec = sj->codec;
+
+	const u32 offset = sj->slice_bytes * index;
+	const u32 bytes = codec->_block_bytes - offset;
+
+	codec->AddSubdiagonalValues(offset, bytes < sj->slice_bytes ? bytes : sj->slice_bytes);
+}
+
+void Codec::BackSubstituteTask(void *job, int index)
+{
+	SliceJob *sj = reinterpret_cast<SliceJob *>( job );
+	Codec *codec = sj->codec;
+
+	const u32 offset = sj->slice_bytes * index;
+	const u32 bytes = codec->_block_bytes - offset;
+
+	codec->BackSubstituteAboveDiagonal(offset, bytes < sj->slice_bytes ? bytes : sj->slice_bytes);
+}
+
 /*
 	Substitute
 
@@ -3622,102 +4171,194 @@ void Codec::BackSubstituteAboveDiagonal()
 	and substitute into that matrix.  However, because the mixing columns
 	are so dense, it is actually faster in every case to just regenerate
 	the rows from scratch and throw away those results.
+
+		Substituting only the columns that lost rows read, by following
+	each one back through the peeled rows it depends on, does not pay off
+	either.  Each peeled row reads several columns peeled before it, so the
+	columns behind a single lost row already cover about half of them, and
+	the columns behind four lost rows about 90%, for N = 10000.  Visited in
+	that order they cost more than this forward pass, even at 0.1% loss.
 */
 
-void Codec::Substitute()
+void Codec::SubstituteRow(uidx row_i)
 {
-	CAT_IF_DUMP(cout << endl << "---- Substitute ----" << endl << endl;)
+	const PeelRow * CAT_RESTRICT row = &_peel_rows[row_i];
+	uidx dest_column_i = row->peel_column;
+	u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * dest_column_i;
 
-	CAT_IF_ROWOP(u32 rowops = 0;)
+	CAT_IF_DUMP(cout << "Generating column " << dest_column_i << ":";)
 
-	// For each column that has been peeled,
-	PeelRow * CAT_RESTRICT row;
-	for (u16 row_i = _peel_head_rows; row_i != LIST_TERM; row_i = row->next)
+	const u8 * CAT_RESTRICT input_src = _input_blocks + _block_bytes * row_i;
+	CAT_IF_DUMP(cout << " " << row_i << ":[" << (int)input_src[0] << "]";)
+
+	// Set up mixing column generator
+	uidx mix_a = row->mix_a;
+	uidx mix_x = row->mix_x0;
+	const u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+
+	// If copying from final block,
+	if (row_i != _block_count - 1)
+		memxor_set(dest, src, input_src, _block_bytes);
+	else
 	{
-		row = &_peel_rows[row_i];
-		u16 dest_column_i = row->peel_column;
-		u8 * CAT_RESTRICT dest = _recovery_blocks + _block_bytes * dest_column_i;
+		memxor_set(dest, src, input_src, _input_final_bytes);
+		memcpy(dest + _input_final_bytes, src + _input_final_bytes, _block_bytes - _input_final_bytes);
+	}
 
-		CAT_IF_DUMP(cout << "Generating column " << dest_column_i << ":";)
+	// Add next two mixing columns in
+	IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
+	const u8 * CAT_RESTRICT src0 = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+	IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
+	const u8 * CAT_RESTRICT src1 = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+	memxor_add(dest, src0, src1, _block_bytes);
 
-		const u8 * CAT_RESTRICT input_src = _input_blocks + _block_bytes * row_i;
-		CAT_IF_DUMP(cout << " " << row_i << ":[" << (int)input_src[0] << "]";)
+	// If at least two peeling columns are set,
+	uidx weight = row->peel_weight;
+	if (weight >= 2) // common case:
+	{
+		uidx a = row->peel_a;
+		uidx column0 = row->peel_x0;
+		--weight;
 
-		// Set up mixing column generator
-		u16 mix_a = row->mix_a;
-		u16 mix_x = row->mix_x0;
-		const u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+		uidx column_i = column0;
+		IterateNextColumn(column_i, _block_count, _block_next_prime, a);
 
-		// If copying from final block,
-		if (row_i != _block_count - 1)
-			memxor_set(dest, src, input_src, _block_bytes);
-		else
+		// Common case:
+		if (column0 != dest_column_i)
 		{
-			memxor_set(dest, src, input_src, _input_final_bytes);
-			memcpy(dest + _input_final_bytes, src + _input_final_bytes, _block_bytes - _input_final_bytes);
-		}
-		CAT_IF_ROWOP(++rowops;)
+			const u8 * CAT_RESTRICT peel0 = _recovery_blocks + _block_bytes * column0;
 
-		// Add next two mixing columns in
-		IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-		const u8 * CAT_RESTRICT src0 = _recovery_blocks + _block_bytes * (_block_count + mix_x);
-		IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-		const u8 * CAT_RESTRICT src1 = _recovery_blocks + _block_bytes * (_block_count + mix_x);
-		memxor_add(dest, src0, src1, _block_bytes);
-		CAT_IF_ROWOP(++rowops;)
+			// Common case:
+			if (column_i != dest_column_i)
+				memxor_add(dest, peel0, _recovery_blocks + _block_bytes * column_i, _block_bytes);
+			else // rare:
+				memxor(dest, peel0, _block_bytes);
+		}
+		else // rare:
+			memxor(dest, _recovery_blocks + _block_bytes * column_i, _block_bytes);
 
-		// If at least two peeling columns are set,
-		u16 weight = row->peel_weight;
-		if (weight >= 2) // common case:
+		// For each remaining column,
+		while (--weight > 0)
 		{
-			u16 a = row->peel_a;
-			u16 column0 = row->peel_x0;
-			--weight;
-
-			u16 column_i = column0;
 			IterateNextColumn(column_i, _block_count, _block_next_prime, a);
+			const u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * column_i;
 
-			// Common case:
-			if (column0 != dest_column_i)
-			{
-				const u8 * CAT_RESTRICT peel0 = _recovery_blocks + _block_bytes * column0;
+			CAT_IF_DUMP(cout << " " << column_i;)
 
-				// Common case:
-				if (column_i != dest_column_i)
-					memxor_add(dest, peel0, _recovery_blocks + _block_bytes * column_i, _block_bytes);
-				else // rare:
-					memxor(dest, peel0, _block_bytes);
+			// If column is not the solved one,
+			if (column_i != dest_column_i)
+			{
+				memxor(dest, src, _block_bytes);
+				CAT_IF_DUMP(cout << "[" << (int)src[0] << "]";)
 			}
-			else // rare:
-				memxor(dest, _recovery_blocks + _block_bytes * column_i, _block_bytes);
-			CAT_IF_ROWOP(++rowops;)
-
-			// For each remaining column,
-			while (--weight > 0)
+			else
 			{
-				IterateNextColumn(column_i, _block_count, _block_next_prime, a);
-				const u8 * CAT_RESTRICT src = _recovery_blocks + _block_bytes * column_i;
+				CAT_IF_DUMP(cout << "*";)
+			}
+		}
+	} // end if weight 2
 
-				CAT_IF_DUMP(cout << " " << column_i;)
+	CAT_IF_DUMP(cout << endl;)
+}
 
-				// If column is not the solved one,
-				if (column_i != dest_column_i)
-				{
-					memxor(dest, src, _block_bytes);
-					CAT_IF_ROWOP(++rowops;)
-					CAT_IF_DUMP(cout << "[" << (int)src[0] << "]";)
-				}
-				else
-				{
-					CAT_IF_DUMP(cout << "*";)
-				}
-			}
-		} // end if weight 2
+/*
+	Important Optimization: Level-Parallel Substitution
+
+		The forward order of peeling is stricter than it needs to be.  A
+	peeled row only reads the mixing columns, the deferred columns and the
+	peeled columns that it references, so it can be regenerated as soon as
+	those peeled columns are.  Peel() records a level for each peeled
+	column that is one more than the highest level it depends on.
+
+		All of the rows within a level write to different columns and only
+	read columns from earlier levels, so each level is split into ranges of
+	rows that run in parallel on the executor.  This works for small blocks
+	too, where splitting each block operation between threads would not
+	pay off.
+
+		Avalanches make the peeling order deep, with roughly N/16 levels
+	for large N, so many levels only hold a few rows.  A level that fits
+	in one task runs on the calling thread without involving the executor.
+
+		The column reference lists are not used after solving, so they hold
+	the rows sorted by level.
+*/
 
-		CAT_IF_DUMP(cout << endl;)
+void Codec::SubstituteTask(void *job, int index)
+{
+	RowJob *rj = reinterpret_cast<RowJob *>( job );
+
+	u32 row_i = rj->rows_per_task * index;
+	u32 row_end = row_i + rj->rows_per_task;
+	if (row_end > rj->row_count)
+		row_end = rj->row_count;
+
+	for (; row_i < row_end; ++row_i)
+		rj->codec->SubstituteRow(rj->rows[row_i]);
+}
+
+void Codec::Substitute()
+{
+	CAT_IF_DUMP(cout << endl << "---- Substitute ----" << endl << endl;)
+
+	// If there is no executor or not enough work to split up,
+	if (!_executor.run || _executor.worker_count <= 1 || RowsPerTask(_block_count) >= _block_count)
+	{
+		CAT_IF_ROWOP(u32 rowops = 0;)
+
+		// For each column that has been peeled,
+		for (uidx row_i = _peel_head_rows; row_i != LIST_TERM; row_i = _peel_rows[row_i].next)
+		{
+			SubstituteRow(row_i);
+			CAT_IF_ROWOP(rowops += 2 + (_peel_rows[row_i].peel_weight >= 2 ? _peel_rows[row_i].peel_weight - 1 : 0);)
+		}
+
+		CAT_IF_ROWOP(cout << "Substitute used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+		return;
 	}
 
-	CAT_IF_ROWOP(cout << "Substitute used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+	// Find the number of levels
+	uidx level_count = 0;
+	for (uidx row_i = _peel_head_rows; row_i != LIST_TERM; row_i = _peel_rows[row_i].next)
+	{
+		uidx level = _peel_cols[_peel_rows[row_i].peel_column].level;
+		if (level >= level_count)
+			level_count = level + 1;
+	}
+
+	// Re-purpose the column reference lists to hold rows sorted by level
+	uidx * CAT_RESTRICT level_rows = reinterpret_cast<uidx *>( _peel_col_refs );
+	uidx * CAT_RESTRICT level_offsets = level_rows + _block_count;
+	memset(level_offsets, 0, (level_count + 1) * sizeof(uidx));
+
+	// Count rows in each level
+	for (uidx row_i = _peel_head_rows; row_i != LIST_TERM; row_i = _peel_rows[row_i].next)
+		level_offsets[_peel_cols[_peel_rows[row_i].peel_column].level + 1]++;
+
+	for (uidx level = 1; level < level_count; ++level)
+		level_offsets[level + 1] += level_offsets[level];
+
+	// Sort rows by level, using the offsets as insertion points
+	for (uidx row_i = _peel_head_rows; row_i != LIST_TERM; row_i = _peel_rows[row_i].next)
+		level_rows[level_offsets[_peel_cols[_peel_rows[row_i].peel_column].level]++] = row_i;
+
+	// For each level,
+	RowJob job;
+	job.codec = this;
+	uidx level_start = 0;
+	for (uidx level = 0; level < level_count; ++level)
+	{
+		// Insertion advanced each offset to the start of the next level
+		const uidx level_end = level_offsets[level];
+
+		CAT_IF_DUMP(cout << "Level " << level << " has " << level_end - level_start << " rows" << endl;)
+
+		job.rows = level_rows + level_start;
+		job.row_count = level_end - level_start;
+		RunRowTasks(&Codec::SubstituteTask, &job);
+
+		level_start = level_end;
+	}
 }
 
 
@@ -3842,6 +4483,12 @@ void Codec::Substitute()
 	+ The seeds are not necessarily the best that could be found,
 	since for each D, a range of N use that value of D, and this
 	is much less than D*D -- it is up to 64,000 tops.
+
+	+ With WIREHAIR_LARGE_N, N above 64,000 needs D past the end
+	of the table.  There the seed is just D, since a searched seed
+	is not much better than a random one at that size.  The peel
+	seed tables below do not reach these N either, so the backup peel
+	seed is found at run time by FindPeelSeed().
 */
 
 static const u16 DENSE_SEEDS[119] = {
@@ -4035,6 +4682,41 @@ void GenTable()
 }
 */
 
+/*
+	Backup peel seeds past the tables
+
+		The tables above stop at N = 64000, and searching for the seeds
+	of every N up to CAT_WIREHAIR_MAX_N would take months, so for larger
+	N the peel seed is found at run time.  The default seed fails for
+	about 1 in 40 of them, just like for smaller N.
+
+		The matrix only depends on N, so the encoder and the decoder can
+	both solve it for the N original rows without any block values, and
+	settle on the first seed in LargePeelSeed() order that works.  The
+	encoder gets this for free from its own solve.  The decoder cannot
+	tell which seed the encoder used, so it does the extra solve before
+	reading any blocks, which costs about as much as encoding.
+
+		Seeds that were found are published in a small cache shared by
+	all codec objects, indexed by N like the deck cache, so only the first
+	decoder for each N pays for the extra solve.
+*/
+
+static const u32 LARGE_SEED_TRIES = 16;
+static const int SEED_CACHE_SLOTS = 64;
+static volatile u32 m_seed_cache[SEED_CACHE_SLOTS] = { 0 };	// N << 4 | seed index, or 0 for none
+
+// Peel seed to try for N past the tables: The default seed, and then the backup seeds the tables use
+static CAT_INLINE u32 LargePeelSeed(u32 block_count, u32 index)
+{
+	return index == 0 ? block_count : index - 1;
+}
+
+static CAT_INLINE volatile u32 *SeedCacheSlot(u32 block_count)
+{
+	return &m_seed_cache[(block_count * 0x9E3779B1) >> 26];
+}
+
 /*
 	ChooseMatrix
 
@@ -4042,7 +4724,7 @@ void GenTable()
 	given message bytes and bytes per block.
 */
 
-Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
+Result Codec::ChooseMatrix(u64 message_bytes, int block_bytes)
 {
 	CAT_IF_DUMP(cout << endl << "---- ChooseMatrix ----" << endl << endl;)
 
@@ -4052,17 +4734,19 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 	if CAT_UNLIKELY(message_bytes < 1 || block_bytes < 1)
 		return R_BAD_INPUT;
 
-	// Calculate message block count
-	_block_bytes = block_bytes;
-	_block_count = (message_bytes + _block_bytes - 1) / _block_bytes;
-	_block_next_prime = NextPrime16(_block_count);
+	// Calculate message block count in 64 bits, so a huge message cannot wrap it
+	const u64 block_count = message_bytes / (u32)block_bytes + (message_bytes % (u32)block_bytes != 0);
 
-	// Validate block count
-	if CAT_UNLIKELY(_block_count < CAT_WIREHAIR_MIN_N)
+	// Validate block count before narrowing it, and the message against the address space
+	if CAT_UNLIKELY(block_count < CAT_WIREHAIR_MIN_N)
 		return R_TOO_SMALL;
-	if CAT_UNLIKELY(_block_count > CAT_WIREHAIR_MAX_N)
+	if CAT_UNLIKELY(block_count > CAT_WIREHAIR_MAX_N || message_bytes != (size_t)message_bytes)
 		return R_TOO_LARGE;
 
+	_block_bytes = block_bytes;
+	_block_count = (uidx)block_count;
+	_block_next_prime = NextPrime(_block_count);
+
 	CAT_IF_DUMP(cout << "Total message = " << message_bytes << " bytes.  Block bytes = " << _block_bytes << endl;)
 	CAT_IF_DUMP(cout << "Block count = " << _block_count << " +Prime=" << _block_next_prime << endl;)
 
@@ -4084,7 +4768,7 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 	*/
 
 	// If N is small,
-	u16 dense_count;
+	uidx dense_count;
 	if (_block_count < 256)
 	{
 		// Calculate dense count from math expression
@@ -4095,7 +4779,7 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 	else if (_block_count <= 4096) // Medium N:
 	{
 		// Square root-dominant region
-		dense_count = 11 + SquareRoot16(_block_count) + (u16)(_block_count / 300);
+		dense_count = 11 + SquareRoot16(_block_count) + (uidx)(_block_count / 300);
 	}
 	else if (_block_count <= 32768)
 	{
@@ -4112,11 +4796,16 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 		// Linear-dominant region
 		dense_count = 74 + (_block_count / 128);
 	}
-	else
+	else if (_block_count <= 64000)
 	{
 		// Avalanche-dominant region
 		dense_count = 880 - (_block_count / 128);
 	}
+	else
+	{
+		// Deferred columns grow linearly, near N / 190, so stay ahead of them
+		dense_count = 20 + (_block_count / 150);
+	}
 
 	// Round up to the next D s.t. D Mod 4 = 2 (see above)
 	switch (dense_count & 3)
@@ -4138,11 +4827,17 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 	}
 	else
 	{
+		// If D is past the end of the table,
 		if (dense_count > 486)
-			return R_BAD_DENSE_SEED;
-
-		// Lookup dense seed given D
-		_d_seed = DENSE_SEEDS[(dense_count - 14) / 4];
+		{
+			// Any seed does about as well as a random matrix at this size
+			_d_seed = dense_count;
+		}
+		else
+		{
+			// Lookup dense seed given D
+			_d_seed = DENSE_SEEDS[(dense_count - 14) / 4];
+		}
 	}
 
 	_dense_count = dense_count;
@@ -4159,16 +4854,33 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 		since tuning is more important for these cases.
 	*/
 
+	_seed_checked = true;
+
 	// If N is small,
 	if (_block_count <= SMALL_SEED_MAX)
 	{
 		// Lookup seeds from table
 		_p_seed = SMALL_PEEL_SEEDS[_block_count];
 	}
+	else if (_block_count > 64000)
+	{
+		// If a seed was found for this N before, use it
+		const u32 cached = AtomicLoad(SeedCacheSlot(_block_count));
+		if ((cached >> 4) == _block_count)
+		{
+			_p_seed = LargePeelSeed(_block_count, cached & 15);
+		}
+		else
+		{
+			// Use default seed until it is checked
+			_p_seed = _block_count;
+			_seed_checked = false;
+		}
+	}
 	else
 	{
-		// If default seed doesn't work,
-		if (EXCEPT_SEEDS[_block_count >> 6] & ((u64)1 << (_block_count & 63)))
+		// If default seed doesn't work (the table covers N < 64000),
+		if (_block_count < 64000 && (EXCEPT_SEEDS[_block_count >> 6] & ((u64)1 << (_block_count & 63))))
 		{
 			switch (_block_count)
 			{
@@ -4211,7 +4923,7 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 	CAT_IF_DUMP(cout << "Peel seed = " << _p_seed << "  Dense seed = " << _d_seed << endl;)
 
 	_mix_count = _dense_count + CAT_HEAVY_ROWS;
-	_mix_next_prime = NextPrime16(_mix_count);
+	_mix_next_prime = NextPrime(_mix_count);
 
 	CAT_IF_DUMP(cout << "Mix count = " << _mix_count << " +Prime=" << _mix_next_prime << endl;)
 
@@ -4240,6 +4952,7 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 		Allocate GE and Compression matrix now that the size is known:
 
 			AllocateMatrix()
+				SetCompressBands()
 
 		Produce the Compression matrix:
 
@@ -4250,6 +4963,7 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
 		Produce the GE matrix:
 
 			CopyDeferredRows()
+			SetDenseDecks()
 			MultiplyDenseRows()
 			AddInvertibleGF2Matrix()
 
@@ -4276,6 +4990,8 @@ Result Codec::SolveMatrix()
 	SetMixingColumnsForDeferredRows();
 	PeelDiagonal();
 	CopyDeferredRows();
+	if (!SetDenseDecks())
+		return R_OUT_OF_MEMORY;
 	MultiplyDenseRows();
 	SetHeavyRows();
 
@@ -4292,7 +5008,8 @@ Result Codec::SolveMatrix()
 	// (3) Gaussian Elimination
 
 	SetupTriangle();
-	if (!Triangle())
+	_solve_failed = !Triangle();
+	if (_solve_failed)
 	{
 		CAT_IF_DUMP( cout << "After Triangle FAILED:" << endl; )
 		CAT_IF_DUMP( PrintGEMatrix(); )
@@ -4320,6 +5037,10 @@ Result Codec::SolveMatrix()
 
 	(4) Substitution:
 
+		Generates the peeled row values:
+
+			PeelDiagonalValues()
+
 		Solves across GE matrix rows:
 
 			InitializeColumnValues()
@@ -4339,10 +5060,17 @@ void Codec::GenerateRecoveryBlocks()
 {
 	// (4) Substitution
 
+	PeelDiagonalValues();
 	InitializeColumnValues();
 	MultiplyDenseValues();
-	AddSubdiagonalValues();
-	BackSubstituteAboveDiagonal();
+
+	// Split the GE matrix passes by byte range, since each pivot depends on the ones before it
+	const u32 column_count = _defer_count + _mix_count;
+	SliceJob job;
+	job.codec = this;
+	RunSliceTasks(&Codec::AddSubdiagonalTask, &job, column_count * column_count / 16);
+	RunSliceTasks(&Codec::BackSubstituteTask, &job, column_count * column_count / 16);
+
 	Substitute();
 }
 
@@ -4367,18 +5095,18 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 	if (!block) return R_BAD_INPUT;
 
 	// If there is no room for it,
-	u16 row_i, ge_row_i, new_pivot_i;
+	uidx row_i, ge_row_i, new_pivot_i;
 	if (_row_count >= _block_count + _extra_count)
 	{
-		const u16 first_heavy_row = _defer_count + _dense_count;
+		const uidx first_heavy_row = _defer_count + _dense_count;
 
 		new_pivot_i = 0;
 
 		// For each pivot in the list,
-		for (u16 pivot_i = _next_pivot; pivot_i < _pivot_count; ++pivot_i)
+		for (uidx pivot_i = _next_pivot; pivot_i < _pivot_count; ++pivot_i)
 		{
 			// If unused row is extra,
-			u16 ge_row_i = _pivots[pivot_i];
+			uidx ge_row_i = _pivots[pivot_i];
 			if (ge_row_i >= first_heavy_row && ge_row_i < (first_heavy_row + _extra_count))
 			{
 				// Re-use it
@@ -4434,7 +5162,7 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 	u64 * CAT_RESTRICT ge_new_row = _ge_matrix + _ge_pitch * ge_row_i;
 	memset(ge_new_row, 0, _ge_pitch * sizeof(u64));
 
-	u16 peel_weight, peel_a, peel_x, mix_a, mix_x;
+	uidx peel_weight, peel_a, peel_x, mix_a, mix_x;
 	GeneratePeelRow(id, _p_seed, _block_count, _mix_count,
 		peel_weight, peel_a, peel_x, mix_a, mix_x);
 
@@ -4446,7 +5174,7 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 	row->mix_x0 = mix_x;
 
 	// Generate mixing bits in GE row
-	u16 ge_column_i = mix_x + _defer_count;
+	uidx ge_column_i = mix_x + _defer_count;
 	ge_new_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
 	IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
 	ge_column_i = mix_x + _defer_count;
@@ -4463,14 +5191,12 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 		if (ref_col->mark == MARK_PEEL)
 		{
 			// Add compress row to the new GE row
-			u16 row_i = ref_col->peel_row;
-			const u64 * CAT_RESTRICT ge_src_row = _compress_matrix + _ge_pitch * row_i;
-			for (int ii = 0; ii < _ge_pitch; ++ii) ge_new_row[ii] ^= ge_src_row[ii];
+			AddCompressRow(ge_new_row, ref_col->peel_row);
 		}
 		else
 		{
 			// Set bit for this deferred column
-			u16 ge_column_i = ref_col->ge_column;
+			uidx ge_column_i = ref_col->ge_column;
 			ge_new_row[ge_column_i >> 6] ^= (u64)1 << (ge_column_i & 63);
 		}
 
@@ -4481,7 +5207,7 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 
 	// For each pivot-found column up to the start of the heavy columns,
 	u64 ge_mask = 1;
-	for (u16 pivot_j = 0; pivot_j < _next_pivot && pivot_j < _first_heavy_column;
+	for (uidx pivot_j = 0; pivot_j < _next_pivot && pivot_j < _first_heavy_column;
 		++pivot_j, ge_mask = CAT_ROL64(ge_mask, 1))
 	{
 		// If bit is set,
@@ -4489,7 +5215,7 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 		u64 * CAT_RESTRICT rem_row = &ge_new_row[word_offset];
 		if (*rem_row & ge_mask)
 		{
-			u16 ge_row_j = _pivots[pivot_j];
+			uidx ge_row_j = _pivots[pivot_j];
 			u64 * CAT_RESTRICT ge_pivot_row = _ge_matrix + word_offset + _ge_pitch * ge_row_j;
 			u64 row0 = (*ge_pivot_row & ~(ge_mask - 1)) ^ ge_mask;
 
@@ -4514,13 +5240,13 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 	else
 	{
 		// For each heavy column,
-		const u16 column_count = _defer_count + _mix_count;
-		const u16 first_heavy_row = _dense_count + _defer_count;
-		u16 heavy_row_i = ge_row_i - first_heavy_row;
+		const uidx column_count = _defer_count + _mix_count;
+		const uidx first_heavy_row = _dense_count + _defer_count;
+		uidx heavy_row_i = ge_row_i - first_heavy_row;
 		u8 * CAT_RESTRICT heavy_row = _heavy_matrix + _heavy_pitch * heavy_row_i;
-		for (u16 ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
+		for (uidx ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
 		{
-			u16 heavy_col_j = ge_column_j - _first_heavy_column;
+			uidx heavy_col_j = ge_column_j - _first_heavy_column;
 			u8 bit_j = (u8)(ge_new_row[ge_column_j >> 6] >> (ge_column_j & 63)) & 1;
 
 			// Copy bit into column byte
@@ -4528,22 +5254,22 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 		}
 
 		// For each pivot-found column in the heavy columns,
-		for (u16 pivot_j = _first_heavy_column; pivot_j < _next_pivot; ++pivot_j)
+		for (uidx pivot_j = _first_heavy_column; pivot_j < _next_pivot; ++pivot_j)
 		{
 			// If column is zero,
-			u16 heavy_col_j = pivot_j - _first_heavy_column;
+			uidx heavy_col_j = pivot_j - _first_heavy_column;
 			u8 code_value = heavy_row[heavy_col_j];
 			if (!code_value) continue; // Skip it
 
 			// If previous row is heavy,
-			u16 ge_row_j = _pivots[pivot_j];
+			uidx ge_row_j = _pivots[pivot_j];
 			if (ge_row_j >= first_heavy_row)
 			{
 				// Calculate coefficient of elimination
-				u16 heavy_row_j = ge_row_j - first_heavy_row;
+				uidx heavy_row_j = ge_row_j - first_heavy_row;
 				u8 * CAT_RESTRICT pivot_row = _heavy_matrix + _heavy_pitch * heavy_row_j;
 				u8 pivot_code = pivot_row[heavy_col_j];
-				const u16 start_column = heavy_col_j + 1;
+				const uidx start_column = heavy_col_j + 1;
 				if (pivot_code == 1)
 				{
 					// heavy[m+] += exist[m+] * code_value
@@ -4564,7 +5290,7 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 			{
 				// For each remaining column,
 				u64 * CAT_RESTRICT other_row = _ge_matrix + _ge_pitch * ge_row_j;
-				u16 ge_column_k = pivot_j + 1;
+				uidx ge_column_k = pivot_j + 1;
 				u64 ge_mask = (u64)1 << (ge_column_k & 63);
 				for (; ge_column_k < column_count; ++ge_column_k, ge_mask = CAT_ROL64(ge_mask, 1))
 				{
@@ -4579,7 +5305,7 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 		} // next column
 
 		// If the next pivot was not found on this heavy row,
-		u16 next_heavy_col = _next_pivot - _first_heavy_column;
+		uidx next_heavy_col = _next_pivot - _first_heavy_column;
 		if (!heavy_row[next_heavy_col])
 			return R_MORE_BLOCKS; // Maybe next time...
 
@@ -4610,7 +5336,8 @@ Result Codec::ResumeSolveMatrix(u32 id, const void *block)
 		InsertHeavyRows();
 
 	// Resume Triangle() at next pivot to determine
-	return Triangle() ? R_WIN : R_MORE_BLOCKS;
+	_solve_failed = !Triangle();
+	return _solve_failed ? R_MORE_BLOCKS : R_WIN;
 }
 
 #if defined(CAT_ALL_ORIGINAL)
@@ -4632,7 +5359,7 @@ bool Codec::IsAllOriginalData()
 	// For each row,
 	PeelRow * CAT_RESTRICT row = _peel_rows;
 	u32 seen_rows = 0;
-	for (u16 row_i = 0; row_i < _row_count; ++row_i, ++row)
+	for (uidx row_i = 0; row_i < _row_count; ++row_i, ++row)
 	{
 		u32 id = row->id;
 
@@ -4652,40 +5379,65 @@ bool Codec::IsAllOriginalData()
 	return seen_rows >= _block_count;
 }
 
-#endif // CAT_ALL_ORIGINAL
-
 /*
-	ReconstructBlock
-
-		This function reconstructs an original block from the recovery
-	blocks, which is much slower than copying from the input data, so
-	should be done selectively.  This is only done during decoding.
+	CopyOriginalRange
 
-	Precondition: DecodeFeed() has returned success
+		When all N original blocks were received, DecodeFeed() returns
+	without generating recovery blocks, so there is nothing to regenerate
+	from.  In that case this function copies the overlap of each received
+	block with the range instead, and returns true.
 */
 
-Result Codec::ReconstructBlock(u16 row_i, void * CAT_RESTRICT dest) {
-	CAT_IF_DUMP(cout << endl << "---- ReconstructBlock ----" << endl << endl;)
+bool Codec::CopyOriginalRange(u64 offset, u64 bytes, u8 * CAT_RESTRICT dest) const
+{
+	// If recovery blocks were generated,
+	if (!_all_original || _row_count != _block_count)
+		return false;
 
-	// Validate input
-	if CAT_UNLIKELY(!dest) return R_BAD_INPUT;
+	const u64 end = offset + bytes;
+
+	// For each received row,
+	const PeelRow * CAT_RESTRICT row = _peel_rows;
+	const u8 * CAT_RESTRICT src = _input_blocks;
+	for (uidx row_i = 0; row_i < _row_count; ++row_i, ++row, src += _block_bytes)
+	{
+		const u64 row_start = (u64)row->id * _block_bytes;
+		const u64 row_end = row_start + (row->id != (u32)_block_count - 1 ? _block_bytes : _output_final_bytes);
+
+		// Copy the overlap with the range
+		const u64 copy_start = offset > row_start ? offset : row_start;
+		const u64 copy_end = end < row_end ? end : row_end;
+		if (copy_start < copy_end)
+			memcpy(dest + (copy_start - offset), src + (copy_start - row_start), (size_t)(copy_end - copy_start));
+	}
 
-	// Regenerate any single row that got lost:
+	return true;
+}
 
-	u32 block_bytes = _block_bytes;
+#endif // CAT_ALL_ORIGINAL
 
-	// For last row, use final byte count
-	if (row_i == _block_count - 1)
-		block_bytes = _output_final_bytes;
+/*
+	RegenerateRange
+
+		This function regenerates bytes [offset, offset + bytes) of an
+	original block from the same bytes of the recovery blocks.  It only
+	reads the recovery blocks, so any number of rows can be regenerated at
+	once into different outputs, and the cost is in proportion to bytes.
+*/
+
+void Codec::RegenerateRange(uidx row_i, u32 offset, u32 bytes, u8 * CAT_RESTRICT dest)
+{
+	// Recovery blocks are read from the same offset
+	const u8 * CAT_RESTRICT recovery = _recovery_blocks + offset;
 
 	CAT_IF_DUMP(cout << "Regenerating row " << row_i << ":";)
 
-	u16 peel_weight, peel_a, peel_x, mix_a, mix_x;
+	uidx peel_weight, peel_a, peel_x, mix_a, mix_x;
 	GeneratePeelRow(row_i, _p_seed, _block_count, _mix_count,
 		peel_weight, peel_a, peel_x, mix_a, mix_x);
 
 	// Remember first column (there is always at least one)
-	u8 * CAT_RESTRICT first = _recovery_blocks + _block_bytes * peel_x;
+	const u8 * CAT_RESTRICT first = recovery + _block_bytes * peel_x;
 
 	CAT_IF_DUMP(cout << " " << peel_x;)
 
@@ -4699,7 +5451,7 @@ Result Codec::ReconstructBlock(u16 row_i, void * CAT_RESTRICT dest) {
 		CAT_IF_DUMP(cout << " " << peel_x;)
 
 		// Combine first two columns into output buffer (faster than memcpy + memxor)
-		memxor_set(dest, first, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+		memxor_set(dest, first, recovery + _block_bytes * peel_x, bytes);
 
 		// For each remaining peeler column,
 		while (--peel_weight > 0)
@@ -4709,162 +5461,952 @@ Result Codec::ReconstructBlock(u16 row_i, void * CAT_RESTRICT dest) {
 			CAT_IF_DUMP(cout << " " << peel_x;)
 
 			// Mix in each column
-			memxor(dest, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+			memxor(dest, recovery + _block_bytes * peel_x, bytes);
 		}
 
 		// Mix first mixer block in directly
-		memxor(dest, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+		memxor(dest, recovery + _block_bytes * (_block_count + mix_x), bytes);
 	}
 	else
 	{
 		// Mix first with first mixer block (faster than memcpy + memxor)
-		memxor_set(dest, first, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+		memxor_set(dest, first, recovery + _block_bytes * (_block_count + mix_x), bytes);
 	}
 
 	CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
 	// Combine remaining two mixer columns together:
 	IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-	const u8 *mix0_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+	const u8 *mix0_src = recovery + _block_bytes * (_block_count + mix_x);
 	CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
 	IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-	const u8 *mix1_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+	const u8 *mix1_src = recovery + _block_bytes * (_block_count + mix_x);
 	CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
-	memxor_add(dest, mix0_src, mix1_src, block_bytes);
+	memxor_add(dest, mix0_src, mix1_src, bytes);
 
 	CAT_IF_DUMP(cout << endl;)
-
-	return R_WIN;
 }
 
-
 /*
-	ReconstructOutput
-
-		This function reconstructs the output by copying inputs
-	that were from the first N blocks, and regenerating the rest.
-	This is only done during decoding.
+	RegenerateRow
 
-	Precondition: DecodeFeed() has returned success
+		This function regenerates a whole original block.
 */
 
-Result Codec::ReconstructOutput(void * CAT_RESTRICT message_out)
+void Codec::RegenerateRow(uidx row_i, u8 * CAT_RESTRICT dest)
 {
-	CAT_IF_DUMP(cout << endl << "---- ReconstructOutput ----" << endl << endl;)
-
-	// Validate input
-	if CAT_UNLIKELY(!message_out) return R_BAD_INPUT;
-	u8 * CAT_RESTRICT output_blocks = reinterpret_cast<u8 *>( message_out );
+	u32 block_bytes = (u32)_block_bytes;
 
-#if defined(CAT_COPY_FIRST_N)
-	// Re-purpose and initialize an array to store whether or not each row id needs to be regenerated
-	u8 * CAT_RESTRICT copied_rows = reinterpret_cast<u8*>( _peel_cols );
-	memset(copied_rows, 0, _block_count);
+	// For last row, use final byte count
+	if (row_i == _block_count - 1)
+		block_bytes = _output_final_bytes;
 
-	// Copy any original message rows that were received:
-	// For each row,
-	PeelRow * CAT_RESTRICT row = _peel_rows;
-	const u8 * CAT_RESTRICT src = _input_blocks;
-	for (u16 row_i = 0; row_i < _row_count; ++row_i, ++row, src += _block_bytes)
-	{
-		u32 id = row->id;
+	RegenerateRange(row_i, 0, block_bytes, dest);
+}
 
-		// If the row identifier indicates it is part of the original message data,
-		if (id < _block_count)
-		{
-			CAT_IF_DUMP(cout << "Copying received row " << id << endl;)
+void Codec::RegenerateTask(void *job, int index)
+{
+	RowJob *rj = reinterpret_cast<RowJob *>( job );
 
-			u8 * CAT_RESTRICT dest = output_blocks + _block_bytes * id;
-			int bytes = (id != _block_count - 1) ? _block_bytes : _output_final_bytes;
-			memcpy(dest, src, bytes);
+	u32 row_i = rj->rows_per_task * index;
+	u32 row_end = row_i + rj->rows_per_task;
+	if (row_end > rj->row_count)
+		row_end = rj->row_count;
 
-			copied_rows[id] = 1;
-		}
+	for (; row_i < row_end; ++row_i)
+	{
+		const uidx lost_i = rj->rows[row_i];
+		rj->codec->RegenerateRow(lost_i, rj->output + rj->codec->_block_bytes * lost_i);
 	}
-#endif // CAT_COPY_FIRST_N
+}
 
-	// Regenerate any rows that got lost:
+/*
+	ReconstructBlock
 
-	// For each row,
-	u8 * CAT_RESTRICT dest = output_blocks;
-	u32 block_bytes = _block_bytes;
-#if defined(CAT_COPY_FIRST_N)
-	u8 * CAT_RESTRICT copied_row = copied_rows;
-	for (u16 row_i = 0; row_i < _block_count; ++row_i, dest += _block_bytes, ++copied_row)
-	{
-		// If already copied, skip it
-		if (*copied_row)
-			continue;
-#else
-	for (u16 row_i = 0; row_i < _block_count; ++row_i, dest += _block_bytes)
-	{
-#endif
-		// For last row, use final byte count
-		if (row_i == _block_count - 1)
-			block_bytes = _output_final_bytes;
+		This function reconstructs an original block from the recovery
+	blocks, which is much slower than copying from the input data, so
+	should be done selectively.  This is only done during decoding.
 
-		CAT_IF_DUMP(cout << "Regenerating row " << row_i << ":";)
+	Precondition: DecodeFeed() has returned success
+*/
 
-		u16 peel_weight, peel_a, peel_x, mix_a, mix_x;
-		GeneratePeelRow(row_i, _p_seed, _block_count, _mix_count,
-			peel_weight, peel_a, peel_x, mix_a, mix_x);
+Result Codec::ReconstructBlock(uidx row_i, void * CAT_RESTRICT dest) {
+	CAT_IF_DUMP(cout << endl << "---- ReconstructBlock ----" << endl << endl;)
 
-		// Remember first column (there is always at least one)
-		u8 * CAT_RESTRICT first = _recovery_blocks + _block_bytes * peel_x;
+	// Validate input
+	if CAT_UNLIKELY(!dest) return R_BAD_INPUT;
 
-		CAT_IF_DUMP(cout << " " << peel_x;)
+#if defined(CAT_ALL_ORIGINAL)
+	// If no recovery blocks were generated, copy the received block
+	if (CopyOriginalRange((u64)row_i * _block_bytes, row_i != _block_count - 1 ? _block_bytes : _output_final_bytes, reinterpret_cast<u8 *>( dest )))
+		return R_WIN;
+#endif
 
-		// If peeler has multiple columns,
-		if (peel_weight > 1)
-		{
-			--peel_weight;
+	// Regenerate any single row that got lost
+	RegenerateRow(row_i, reinterpret_cast<u8 *>( dest ));
 
-			IterateNextColumn(peel_x, _block_count, _block_next_prime, peel_a);
+	return R_WIN;
+}
+
+/*
+	ReconstructRange
+
+		This function reconstructs only bytes [offset, offset + bytes) of
+	an original block, so reading a small part of a lost block costs in
+	proportion to the part that is read.  This is only done during decoding.
+
+	Precondition: DecodeFeed() has returned success
+*/
+
+Result Codec::ReconstructRange(uidx row_i, u32 offset, u32 bytes, void * CAT_RESTRICT dest)
+{
+	CAT_IF_DUMP(cout << endl << "---- ReconstructRange ----" << endl << endl;)
+
+	// Validate input
+	if CAT_UNLIKELY(!dest || row_i >= _block_count) return R_BAD_INPUT;
+
+	// Last row is shorter
+	const u32 block_bytes = row_i == _block_count - 1 ? _output_final_bytes : (u32)_block_bytes;
+	if CAT_UNLIKELY(offset > block_bytes || bytes > block_bytes - offset) return R_BAD_INPUT;
+
+#if defined(CAT_ALL_ORIGINAL)
+	// If no recovery blocks were generated, copy from the received block
+	if (CopyOriginalRange((u64)row_i * _block_bytes + offset, bytes, reinterpret_cast<u8 *>( dest )))
+		return R_WIN;
+#endif
+
+	RegenerateRange(row_i, offset, bytes, reinterpret_cast<u8 *>( dest ));
+
+	return R_WIN;
+}
+
+/*
+	ReconstructMessageRange
+
+		This function reconstructs bytes [offset, offset + bytes) of the
+	message, regenerating only the part of each block that overlaps them.
+
+	Precondition: DecodeFeed() has returned success
+*/
+
+Result Codec::ReconstructMessageRange(u64 offset, u64 bytes, void * CAT_RESTRICT dest)
+{
+	CAT_IF_DUMP(cout << endl << "---- ReconstructMessageRange ----" << endl << endl;)
+
+	// Validate input
+	const u64 message_bytes = (u64)(_block_count - 1) * _block_bytes + _output_final_bytes;
+	if CAT_UNLIKELY(!dest || offset > message_bytes || bytes > message_bytes - offset) return R_BAD_INPUT;
+
+	u8 * CAT_RESTRICT output = reinterpret_cast<u8 *>( dest );
+
+#if defined(CAT_ALL_ORIGINAL)
+	// If no recovery blocks were generated, copy from the received blocks
+	if (CopyOriginalRange(offset, bytes, output))
+		return R_WIN;
+#endif
+
+	uidx row_i = (uidx)(offset / _block_bytes);
+	u32 block_offset = (u32)(offset % _block_bytes);
+
+	// For each block overlapping the range,
+	while (bytes > 0)
+	{
+		u32 copy = (u32)_block_bytes - block_offset;
+		if (copy > bytes) copy = (u32)bytes;
+
+		RegenerateRange(row_i, block_offset, copy, output);
+
+		output += copy;
+		bytes -= copy;
+		block_offset = 0;
+		++row_i;
+	}
+
+	return R_WIN;
+}
+
+
+/*
+	ReconstructOutput
+
+		This function reconstructs the output by copying inputs
+	that were from the first N blocks, and regenerating the rest.
+	This is only done during decoding.
+
+		Each lost row is regenerated from the read-only recovery blocks
+	into its own part of the output, so ranges of lost rows are split
+	between tasks on the executor.
+
+	Precondition: DecodeFeed() has returned success
+*/
+
+Result Codec::ReconstructOutput(void * CAT_RESTRICT message_out)
+{
+	CAT_IF_DUMP(cout << endl << "---- ReconstructOutput ----" << endl << endl;)
+
+	// Validate input
+	if CAT_UNLIKELY(!message_out) return R_BAD_INPUT;
+	u8 * CAT_RESTRICT output_blocks = reinterpret_cast<u8 *>( message_out );
+
+#if defined(CAT_COPY_FIRST_N)
+	// Re-purpose and initialize an array to store whether or not each row id needs to be regenerated
+	// NOTE: Column reference lists are not used after solving, and the columns hold generation stamps
+	u8 * CAT_RESTRICT copied_rows = reinterpret_cast<u8*>( _peel_col_refs );
+	memset(copied_rows, 0, _block_count);
+
+	// Copy any original message rows that were received:
+	// For each row,
+	PeelRow * CAT_RESTRICT row = _peel_rows;
+	const u8 * CAT_RESTRICT src = _input_blocks;
+	for (uidx row_i = 0; row_i < _row_count; ++row_i, ++row, src += _block_bytes)
+	{
+		u32 id = row->id;
+
+		// If the row identifier indicates it is part of the original message data,
+		if (id < _block_count)
+		{
+			CAT_IF_DUMP(cout << "Copying received row " << id << endl;)
+
+			u8 * CAT_RESTRICT dest = output_blocks + _block_bytes * id;
+			int bytes = (id != _block_count - 1) ? _block_bytes : _output_final_bytes;
+			memcpy(dest, src, bytes);
+
+			copied_rows[id] = 1;
+		}
+	}
+#endif // CAT_COPY_FIRST_N
+
+	// Regenerate any rows that got lost:
+
+	// List lost rows after the copied row flags
+	uidx * CAT_RESTRICT lost_rows = reinterpret_cast<uidx *>(
+		reinterpret_cast<u8 *>( _peel_col_refs ) + ((_block_count + 1) & ~1) );
+	uidx lost_count = 0;
+	for (uidx row_i = 0; row_i < _block_count; ++row_i)
+	{
+#if defined(CAT_COPY_FIRST_N)
+		// If already copied, skip it
+		if (copied_rows[row_i])
+			continue;
+#endif
+		lost_rows[lost_count++] = row_i;
+	}
+
+	// Split the lost rows between tasks
+	RowJob job;
+	job.codec = this;
+	job.rows = lost_rows;
+	job.row_count = lost_count;
+	job.output = output_blocks;
+	RunRowTasks(&Codec::RegenerateTask, &job);
+
+	return R_WIN;
+}
+
+
+//// Speculative Solve
+
+/*
+	ExpectBlocks
+
+		Rows of the check matrix depend only on the block ids, and the
+	block data is not touched until GenerateRecoveryBlocks().  So when
+	the ids of upcoming blocks are known, such as for a scheduled
+	retransmission, their rows can be peeled right away and the matrix
+	solved before the data arrives.  Each expected id gets its own row
+	slot, and DecodeFeed() copies the data into that slot later.  When
+	the last expected block lands only the substitution is left to do.
+
+		Ids past the first N rows are spares in case some of the others
+	are lost.  Their blocks are held aside as they arrive, and are only
+	fed to the decoder if the expected rows cannot be completed.
+*/
+
+Result Codec::ExpectBlocks(const u32 * CAT_RESTRICT ids, u32 count)
+{
+	// Validate that the decoder has been initialized and is still collecting rows
+	if CAT_UNLIKELY(_input_allocated == 0 || _workspace == 0 || _extra_count != CAT_MAX_EXTRA_ROWS)
+		return R_BAD_INPUT;
+	if CAT_UNLIKELY(!ids || _row_count >= _block_count || _deposit_next != 0 || _solved_callback)
+		return R_BAD_INPUT;
+
+	CAT_IF_DUMP(cout << endl << "---- ExpectBlocks ----" << endl << endl;)
+
+	// Size the hash table to at most half full
+	u32 table_size = 1;
+	while (table_size < ((u32)_block_count + CAT_MAX_EXPECT_SPARES) * 2)
+		table_size <<= 1;
+
+	// If the table is too small, allocate a new one
+	if (_expect_mask + 1 < table_size)
+	{
+		FreeExpected();
+
+		_expect_slots = new ExpectSlot[table_size];
+		if (!_expect_slots) return R_OUT_OF_MEMORY;
+		_expect_mask = table_size - 1;
+	}
+
+	// If nothing is expected yet, clear the table
+	if (_expect_missing == 0)
+	{
+		for (u32 ii = 0; ii <= _expect_mask; ++ii)
+			_expect_slots[ii].used = 0;
+	}
+
+	// For each expected id,
+	for (u32 ii = 0; ii < count; ++ii)
+	{
+		u32 id = ids[ii];
+		uidx row_i = _row_count;
+
+		// If already expected, skip it
+		if (FindExpected(id))
+			continue;
+
+		// If N rows are stored, remember it as a spare
+		if (row_i >= _block_count)
+		{
+			if (_expect_spare_count >= CAT_MAX_EXPECT_SPARES)
+				break;
+
+			InsertExpected(id, LIST_TERM);
+			++_expect_spare_count;
+			continue;
+		}
+
+#if defined(CAT_ALL_ORIGINAL)
+		// If original data,
+		if (id >= _block_count)
+			_all_original = false;
+#endif
+
+		// If opportunistic peeling did not fail,
+		if (OpportunisticPeeling(row_i, id))
+		{
+			InsertExpected(id, row_i);
+
+			++_expect_missing;
+
+			// If just reached N rows, solve the matrix without the data
+			if (++_row_count == _block_count)
+			{
+				Result r = SolveExpected();
+				if (r) return r;
+			}
+		}
+	}
+
+	// If there are spares, make room to hold their blocks
+	if (_expect_spare_count > 0 && !_expect_spare_blocks)
+	{
+		_expect_spare_blocks = new u8[CAT_MAX_EXPECT_SPARES * _block_bytes];
+		if (!_expect_spare_blocks) return R_OUT_OF_MEMORY;
+	}
+
+	return R_WIN;
+}
+
+/*
+	InsertExpected
+
+		This function adds an expected block id to the hash table, with
+	the row reserved for it or LIST_TERM for a spare.
+*/
+
+void Codec::InsertExpected(u32 id, uidx row_i)
+{
+	// Use the first empty slot after the hash position
+	u32 jj = (id * 0x9E3779B1) & _expect_mask;
+	while (_expect_slots[jj].used)
+		jj = (jj + 1) & _expect_mask;
+
+	ExpectSlot *slot = &_expect_slots[jj];
+	slot->id = id;
+	slot->row_i = row_i;
+	slot->used = 1;
+	slot->filled = 0;
+}
+
+/*
+	FindExpected
+
+		This function looks up an expected block id, returning 0 if it
+	was not expected.
+*/
+
+Codec::ExpectSlot *Codec::FindExpected(u32 id)
+{
+	if (!_expect_slots)
+		return 0;
+
+	for (u32 jj = (id * 0x9E3779B1) & _expect_mask;; jj = (jj + 1) & _expect_mask)
+	{
+		ExpectSlot *slot = &_expect_slots[jj];
+
+		if (!slot->used)
+			return 0;
+		if (slot->id == id)
+			return slot;
+	}
+}
+
+/*
+	SolveExpected
+
+		This function solves the matrix once N rows are stored while some
+	of their blocks are still expected.  If the matrix needs more rows,
+	the decoder waits for the expected blocks and then uses the spares.
+*/
+
+Result Codec::SolveExpected()
+{
+#if defined(CAT_ALL_ORIGINAL)
+	// If all original data, there is nothing to solve
+	if (_all_original && IsAllOriginalData())
+	{
+		_expect_solved = true;
+		return R_WIN;
+	}
+#endif
+
+	Result r = SolveMatrix();
+	if (r > R_MORE_BLOCKS)
+		return r;
+
+	_expect_solved = (r == R_WIN);
+	return R_WIN;
+}
+
+/*
+	FillExpected
+
+		This function stores the data for an expected block in the row
+	reserved for it, or sets it aside if it is a spare.
+
+		When the last expected block arrives after the matrix was solved,
+	only the block values are left to generate.  If the matrix needs more
+	rows, the spares that arrived are fed to the decoder.  And if all of
+	the spares arrive while expected blocks are still missing, those are
+	assumed to be lost and decoding goes on without them.
+*/
+
+Result Codec::FillExpected(ExpectSlot *slot, const void * CAT_RESTRICT block_in)
+{
+	// If the block already arrived, ignore it
+	if (slot->filled)
+		return R_MORE_BLOCKS;
+	slot->filled = 1;
+
+	// If the block is a spare,
+	if (slot->row_i == LIST_TERM)
+	{
+		// Set it aside
+		uidx spare_i = _expect_spares_arrived++;
+		_expect_spare_ids[spare_i] = slot->id;
+		memcpy(_expect_spare_blocks + _block_bytes * spare_i, block_in, _block_bytes);
+
+		// If expected blocks are still missing after every spare arrived,
+		if (_expect_spares_arrived >= _expect_spare_count)
+			return AbandonExpected();
+
+		return R_MORE_BLOCKS;
+	}
+
+	u8 *block_store = _input_blocks + _block_bytes * slot->row_i;
+
+	// If this is the last block id,
+	if (slot->id == (u32)_block_count - 1)
+	{
+		u32 final_bytes = _output_final_bytes;
+
+		// Copy the new row data into the reserved row
+		memcpy(block_store, block_in, final_bytes);
+
+		// Pad with zeroes
+		memset(block_store + final_bytes, 0, _block_bytes - final_bytes);
+	}
+	else
+	{
+		// Copy the new row data into the reserved row
+		memcpy(block_store, block_in, _block_bytes);
+	}
+
+	// If more expected blocks are on the way, or there are not N rows yet,
+	if (--_expect_missing > 0 || _row_count < _block_count)
+		return R_MORE_BLOCKS;
+
+	// If the matrix needs more rows, continue with the spares
+	if (!_expect_solved)
+		return FeedSpares();
+
+#if defined(CAT_ALL_ORIGINAL)
+	// If all original data,
+	if (_all_original && IsAllOriginalData())
+		return R_WIN;
+#endif
+
+	GenerateRecoveryBlocks();
+	return R_WIN;
+}
+
+/*
+	AbandonExpected
+
+		This function gives up on the expected blocks that have not
+	arrived.  The rows that did receive data are peeled again in order
+	and moved down to close the gaps, like PeelDeposits(), leaving fewer
+	than N rows.  Then the spares are fed to the decoder, which goes on
+	collecting blocks as usual.
+*/
+
+Result Codec::AbandonExpected()
+{
+	CAT_IF_DUMP(cout << endl << "---- AbandonExpected ----" << endl << endl;)
+
+	// Initialize lists
+	_peel_head_rows = LIST_TERM;
+	_peel_tail_rows = 0;
+	_defer_head_rows = LIST_TERM;
+#if defined(CAT_ALL_ORIGINAL)
+	_all_original = true;
+#endif
+
+	ClearPeelColumns();
+
+	uidx stored_count = _row_count;
+	_row_count = 0;
+
+	// For each stored row,
+	for (uidx slot = 0; slot < stored_count; ++slot)
+	{
+		uidx row_i = _row_count;
+		u32 id = _peel_rows[slot].id;
+
+		// If its block has not arrived, drop it
+		ExpectSlot *expected = FindExpected(id);
+		if (expected && !expected->filled)
+			continue;
+
+#if defined(CAT_ALL_ORIGINAL)
+		// If original data,
+		if (id >= _block_count)
+			_all_original = false;
+#endif
+
+		// If opportunistic peeling did not fail,
+		if (OpportunisticPeeling(row_i, id))
+		{
+			// If an earlier row was dropped, move the block data down
+			if (row_i != slot)
+				memcpy(_input_blocks + _block_bytes * row_i, _input_blocks + _block_bytes * slot, _block_bytes);
+
+			++_row_count;
+		}
+	}
+
+	_expect_missing = 0;
+	_expect_solved = false;
+
+	return FeedSpares();
+}
+
+/*
+	FeedSpares
+
+		This function passes the spare blocks that were set aside to
+	DecodeFeed(), once nothing is expected anymore.
+*/
+
+Result Codec::FeedSpares()
+{
+	uidx arrived = _expect_spares_arrived;
+
+	// No more spares are held from here on
+	_expect_spare_count = 0;
+	_expect_spares_arrived = 0;
+
+	// For each spare block that arrived,
+	for (uidx spare_i = 0; spare_i < arrived; ++spare_i)
+	{
+		Result r = DecodeFeed(_expect_spare_ids[spare_i], _expect_spare_blocks + _block_bytes * spare_i);
+		if (r != R_MORE_BLOCKS)
+			return r;
+	}
+
+	return R_MORE_BLOCKS;
+}
+
+void Codec::ResetExpected()
+{
+	_expect_missing = 0;
+	_expect_solved = false;
+	_expect_spare_count = 0;
+	_expect_spares_arrived = 0;
+}
+
+void Codec::FreeExpected()
+{
+	delete []_expect_slots;
+	_expect_slots = 0;
+	_expect_mask = 0;
+
+	delete []_expect_spare_blocks;
+	_expect_spare_blocks = 0;
+}
+
+
+//// Concurrent Deposits
+
+void Codec::ResetDeposits()
+{
+	_deposit_next = 0;
+	_deposit_count = 0;
+
+	// The solver lock is held until the thread that fills the last slot releases it
+	_deposit_lock = 1;
+	_deposit_result = R_MORE_BLOCKS;
+}
+
+/*
+	PeelDeposits
+
+		This function runs the opportunistic peeling that DecodeFeed()
+	would have done as each block arrived, in slot order.  A row that
+	fails to peel is skipped and the rows after it are moved down to
+	close the gap, so the stored rows stay contiguous for the solver.
+*/
+
+Result Codec::PeelDeposits()
+{
+	CAT_IF_DUMP(cout << endl << "---- PeelDeposits ----" << endl << endl;)
+
+	// For each filled slot,
+	for (uidx slot = 0; slot < _block_count; ++slot)
+	{
+		uidx row_i = _row_count;
+		u32 id = _peel_rows[slot].id;
 
-			CAT_IF_DUMP(cout << " " << peel_x;)
+#if defined(CAT_ALL_ORIGINAL)
+		// If original data,
+		if (id >= _block_count)
+			_all_original = false;
+#endif
 
-			// Combine first two columns into output buffer (faster than memcpy + memxor)
-			memxor_set(dest, first, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+		// If opportunistic peeling did not fail,
+		if (OpportunisticPeeling(row_i, id))
+		{
+			// If an earlier row was skipped, move the block data down
+			if (row_i != slot)
+				memcpy(_input_blocks + _block_bytes * row_i, _input_blocks + _block_bytes * slot, _block_bytes);
 
-			// For each remaining peeler column,
-			while (--peel_weight > 0)
-			{
-				IterateNextColumn(peel_x, _block_count, _block_next_prime, peel_a);
+			++_row_count;
+		}
+	}
 
-				CAT_IF_DUMP(cout << " " << peel_x;)
+	// If some rows were skipped, DecodeFeed() will collect the rest
+	if (_row_count < _block_count)
+		return R_MORE_BLOCKS;
 
-				// Mix in each column
-				memxor(dest, _recovery_blocks + _block_bytes * peel_x, block_bytes);
-			}
+#if defined(CAT_ALL_ORIGINAL)
+	// If all original data,
+	if (_all_original && IsAllOriginalData())
+		return R_WIN;
+#endif
+
+	// Attempt to solve the matrix and generate recovery blocks
+	Result r = SolveMatrix();
+	if (!r) Codec::GenerateRecoveryBlocks();
+	return r;
+}
+
+
+//// Asynchronous Solve
+
+/*
+	StartAsyncSolve
+
+		This function moves the solver off the threads that feed the
+	decoder.  Blocks are deposited as usual, but the thread that fills
+	the N-th slot starts a task on the executor to peel and solve, and
+	returns right away.  Blocks that arrive after that are copied into
+	a small queue.  If the solve needs more rows, the worker feeds them
+	from the queue to DecodeFeed(), so no thread that deposits a block
+	ever waits for the solver.  The callback runs on the worker when
+	the message is decoded or the decoder fails.
+
+		The worker is already running as a task, so it solves without
+	handing row operations back to the executor, like the encoders in
+	wirehair_encode_many().  A task never waits on tasks of its own.
+*/
+
+Result Codec::StartAsyncSolve(SolvedCallback callback, void *context)
+{
+	// Only a decoder that has not received any blocks can switch modes,
+	// and it needs an executor that can run tasks in the background
+	if CAT_UNLIKELY(!callback || _extra_count != CAT_MAX_EXTRA_ROWS || _deposit_next != 0 ||
+		!_executor.start)
+		return R_BAD_INPUT;
+
+	// If the queue is not allocated for this block size,
+	if (_queue_block_bytes != _block_bytes)
+	{
+		FreeSolveQueue();
+
+		_queue_slots = new QueueSlot[CAT_SOLVE_QUEUE_SIZE];
+		_queue_blocks = new u8[CAT_SOLVE_QUEUE_SIZE * _block_bytes];
+		if (!_queue_slots || !_queue_blocks)
+		{
+			FreeSolveQueue();
+			return R_OUT_OF_MEMORY;
+		}
+
+		_queue_block_bytes = _block_bytes;
+	}
+
+	// Each slot is ready to be written for its own position first
+	for (u32 ii = 0; ii < CAT_SOLVE_QUEUE_SIZE; ++ii)
+		_queue_slots[ii].sequence = ii;
+
+	_queue_head = 0;
+	_queue_tail = 0;
+
+	_solved_callback = callback;
+	_solved_context = context;
+
+	return R_WIN;
+}
+
+void Codec::StopAsyncSolve()
+{
+	if (!_solved_callback)
+		return;
+
+	// Wait for the worker that is solving, if any
+	_executor.finish(_executor.context, this);
+
+	_solved_callback = 0;
+}
 
-			// Mix first mixer block in directly
-			memxor(dest, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+/*
+	EnqueueBlock
+
+		The queue is a bounded ring where each slot carries a sequence
+	number.  A producer claims the next position with compare-and-swap
+	only when the slot sequence matches it, copies the block in, and
+	then advances the sequence so that the worker can read it.  The
+	worker advances it again by the ring size once the block is used.
+*/
+
+bool Codec::EnqueueBlock(u32 id, const void * CAT_RESTRICT block_in)
+{
+	u32 position = AtomicLoad(&_queue_head);
+	QueueSlot *slot;
+
+	for (;;)
+	{
+		slot = &_queue_slots[position % CAT_SOLVE_QUEUE_SIZE];
+		s32 diff = (s32)(AtomicLoad(&slot->sequence) - position);
+
+		// If the slot is free for this position, try to claim it
+		if (diff == 0)
+		{
+			u32 seen = AtomicCompareSwap(&_queue_head, position, position + 1);
+			if (seen == position)
+				break;
+			position = seen;
 		}
+		else if (diff < 0)
+			return false; // Queue is full
 		else
+			position = AtomicLoad(&_queue_head);
+	}
+
+	memcpy(_queue_blocks + _block_bytes * (position % CAT_SOLVE_QUEUE_SIZE), block_in, _block_bytes);
+	slot->id = id;
+
+	// Hand the block to the worker
+	AtomicStore(&slot->sequence, position + 1);
+
+	return true;
+}
+
+void Codec::FinishAsyncSolve(bool peel)
+{
+	// This runs as a task already and batches are never nested, so solve serially
+	void (*run)(void *context, TaskFunction task, void *job, int count, u32 task_bytes) = _executor.run;
+	_executor.run = 0;
+
+	Result r = peel ? PeelDeposits() : R_MORE_BLOCKS;
+
+	for (;;)
+	{
+		// While more blocks are needed and some are queued,
+		while (r == R_MORE_BLOCKS)
 		{
-			// Mix first with first mixer block (faster than memcpy + memxor)
-			memxor_set(dest, first, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+			QueueSlot *slot = &_queue_slots[_queue_tail % CAT_SOLVE_QUEUE_SIZE];
+			if (AtomicLoad(&slot->sequence) != _queue_tail + 1)
+				break;
+
+			r = DecodeFeed(slot->id, _queue_blocks + _block_bytes * (_queue_tail % CAT_SOLVE_QUEUE_SIZE));
+
+			// Free the slot for the next lap around the ring
+			AtomicStore(&slot->sequence, _queue_tail + CAT_SOLVE_QUEUE_SIZE);
+			++_queue_tail;
 		}
 
-		CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
+		// If done, keep the solver lock so that no other worker starts
+		if (r != R_MORE_BLOCKS)
+		{
+			_executor.run = run;
+			AtomicStore(&_deposit_result, r);
+			_solved_callback(_solved_context, r == R_WIN);
+			return;
+		}
 
-		// Combine remaining two mixer columns together:
-		IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-		const u8 *mix0_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
-		CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
+		_executor.run = run;
+		AtomicStore(&_deposit_lock, 0);
 
-		IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-		const u8 *mix1_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
-		CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
+		// If a block was queued after the last check, take the lock back so it is not missed
+		QueueSlot *slot = &_queue_slots[_queue_tail % CAT_SOLVE_QUEUE_SIZE];
+		if (AtomicLoad(&slot->sequence) != _queue_tail + 1 ||
+			AtomicCompareSwap(&_deposit_lock, 0, 1) != 0)
+			return;
 
-		memxor_add(dest, mix0_src, mix1_src, block_bytes);
+		_executor.run = 0;
+	}
+}
 
-		CAT_IF_DUMP(cout << endl;)
-	} // next row
+void Codec::PeelDepositsTask(void *job, int /*index*/)
+{
+	Codec *codec = reinterpret_cast<Codec *>( job );
 
-	return R_WIN;
+	codec->FinishAsyncSolve(true);
+}
+
+void Codec::ResumeDepositsTask(void *job, int /*index*/)
+{
+	Codec *codec = reinterpret_cast<Codec *>( job );
+
+	codec->FinishAsyncSolve(false);
+}
+
+void Codec::FreeSolveQueue()
+{
+	delete []_queue_slots;
+	_queue_slots = 0;
+	delete []_queue_blocks;
+	_queue_blocks = 0;
+	_queue_block_bytes = 0;
+}
+
+
+//// Parallelism
+
+void Codec::SetExecutor(const Executor *executor)
+{
+	// Background tasks must finish on the executor that started them
+	StopRepairRing();
+	StopAsyncSolve();
+
+	if (executor)
+	{
+		_executor = *executor;
+		if (_executor.worker_count < 1)
+			_executor.worker_count = 1;
+	}
+	else
+	{
+		_executor.context = 0;
+		_executor.worker_count = 1;
+		_executor.run = 0;
+		_executor.start = 0;
+		_executor.finish = 0;
+	}
+}
+
+/*
+	RowsPerTask
+
+		Tasks are sized from the block size so that each one does about
+	CAT_TASK_BYTES of block operations, which keeps the cost of handing
+	a task to the executor small.  With large N there would be far more
+	tasks than workers, so tasks are also made large enough that there
+	are only a few per worker.
+*/
+
+u32 Codec::RowsPerTask(u32 row_count)
+{
+	// Each row costs a few block operations
+	u32 rows = CAT_TASK_BYTES / (_block_bytes * 4);
+	if (rows < 1)
+		rows = 1;
+
+	// Limit the number of tasks per worker
+	const u32 max_tasks = _executor.worker_count * 4;
+	const u32 spread_rows = (row_count + max_tasks - 1) / max_tasks;
+	if (rows < spread_rows)
+		rows = spread_rows;
+
+	return rows;
+}
+
+void Codec::RunTasks(TaskFunction task, void *job, int count, u32 task_bytes)
+{
+	// If the tasks can be split between workers,
+	if (count > 1 && _executor.run && _executor.worker_count > 1)
+		_executor.run(_executor.context, task, job, count, task_bytes);
+	else
+	{
+		for (int ii = 0; ii < count; ++ii)
+			task(job, ii);
+	}
+}
+
+void Codec::RunRowTasks(TaskFunction task, RowJob *job)
+{
+	job->rows_per_task = RowsPerTask(job->row_count);
+
+	const int count = (job->row_count + job->rows_per_task - 1) / job->rows_per_task;
+
+	RunTasks(task, job, count, job->rows_per_task * _block_bytes * 4);
+}
+
+/*
+	RunSliceTasks
+
+		Passes that must visit the GE matrix pivots in order are split
+	into byte ranges of the blocks instead of rows.  row_ops is roughly
+	how many block operations the pass performs.  Each range is kept to
+	at least CAT_MIN_SLICE_BYTES so that the block operations stay long,
+	and aligned to 64 bytes.
+*/
+
+void Codec::RunSliceTasks(TaskFunction task, SliceJob *job, u32 row_ops)
+{
+	u32 count = 1;
+
+	// If the tasks can be split between workers,
+	if (_executor.run && _executor.worker_count > 1)
+	{
+		count = (u32)((u64)row_ops * _block_bytes / CAT_TASK_BYTES);
+
+		if (count > (u32)_executor.worker_count)
+			count = _executor.worker_count;
+		if (count > _block_bytes / CAT_MIN_SLICE_BYTES)
+			count = _block_bytes / CAT_MIN_SLICE_BYTES;
+		if (count < 1)
+			count = 1;
+	}
+
+	job->slice_bytes = (_block_bytes + count - 1) / count;
+	job->slice_bytes = (job->slice_bytes + 63) & ~(u32)63;
+
+	count = (_block_bytes + job->slice_bytes - 1) / job->slice_bytes;
+
+	RunTasks(task, job, count, row_ops * job->slice_bytes);
 }
 
 
@@ -4874,7 +6416,41 @@ Codec::Codec()
 {
 	// Workspace
 	_recovery_blocks = 0;
+	_recovery_allocated = 0;
+	_workspace = 0;
 	_workspace_allocated = 0;
+	_generation = 0;
+	_stamped_columns = 0;
+
+	// Decks
+	_decks_private = 0;
+	_decks_allocated = 0;
+
+	// Repair ring
+	_ring_blocks = 0;
+	_ring_size = 0;
+
+	// Asynchronous solve
+	_solved_callback = 0;
+	_queue_slots = 0;
+	_queue_blocks = 0;
+	_queue_block_bytes = 0;
+
+	// Speculative solve
+	_expect_slots = 0;
+	_expect_mask = 0;
+	_expect_spare_blocks = 0;
+	ResetExpected();
+
+	// Run tasks serially
+	SetExecutor(0);
+
+	// Nothing solved to update yet
+	_solved_encoder = false;
+	_solve_failed = false;
+
+	// No deposits yet
+	ResetDeposits();
 
 	// Matrix
 	_compress_matrix = 0;
@@ -4887,9 +6463,14 @@ Codec::Codec()
 
 Codec::~Codec()
 {
+	StopRepairRing();
+	StopAsyncSolve();
+	FreeSolveQueue();
+	FreeExpected();
 	FreeWorkspace();
 	FreeMatrix();
 	FreeInput();
+	FreeDecks();
 }
 
 void Codec::SetInput(const void * CAT_RESTRICT message_in)
@@ -4906,7 +6487,7 @@ bool Codec::AllocateInput()
 	CAT_IF_DUMP(cout << endl << "---- AllocateInput ----" << endl << endl;)
 
 	// If need to allocate more,
-	u32 size = (_block_count + _extra_count) * _block_bytes;
+	size_t size = (_block_count + _extra_count) * _block_bytes;
 	if (_input_allocated < size)
 	{
 		FreeInput();
@@ -4941,9 +6522,8 @@ bool Codec::AllocateMatrix()
 	const int ge_pitch = (ge_cols + 63) / 64;
 	const u32 ge_matrix_words = ge_rows * ge_pitch;
 
-	// Compression matrix
-	const int compress_rows = _block_count;
-	const u32 compress_matrix_words = compress_rows * ge_pitch;
+	// Compression matrix: Rows are stored as bands of words
+	const u32 compress_matrix_words = SetCompressBands();
 
 	// Pivots
 	const int pivot_count = ge_cols + _extra_count;
@@ -4956,7 +6536,7 @@ bool Codec::AllocateMatrix()
 	const int heavy_bytes = heavy_pitch * heavy_rows;
 
 	// Calculate buffer size
-	u32 size = ge_matrix_words * sizeof(u64) + compress_matrix_words * sizeof(u64) + pivot_words * sizeof(u16) + heavy_bytes;
+	size_t size = ge_matrix_words * sizeof(u64) + compress_matrix_words * sizeof(u64) + pivot_words * sizeof(uidx) + heavy_bytes;
 
 	// If need to allocate more,
 	if (_ge_allocated < size)
@@ -4976,16 +6556,16 @@ bool Codec::AllocateMatrix()
 	_heavy_columns = heavy_cols;
 	_first_heavy_column = _defer_count + _mix_count - heavy_cols;
 	_heavy_matrix = reinterpret_cast<u8 *>( _ge_matrix + ge_matrix_words );
-	_pivots = reinterpret_cast<u16 *>( _heavy_matrix + heavy_bytes );
+	_pivots = reinterpret_cast<uidx *>( _heavy_matrix + heavy_bytes );
 	_ge_row_map = _pivots + pivot_count;
 	_ge_col_map = _ge_row_map + pivot_count;
 
 	CAT_IF_DUMP(cout << "GE matrix is " << ge_rows << " x " << ge_cols << " with pitch " << ge_pitch << " consuming " << ge_matrix_words * sizeof(u64) << " bytes" << endl;)
-	CAT_IF_DUMP(cout << "Compress matrix is " << compress_rows << " x " << ge_cols << " with pitch " << ge_pitch << " consuming " << compress_matrix_words * sizeof(u64) << " bytes" << endl;)
+	CAT_IF_DUMP(cout << "Compress matrix is " << _block_count << " x " << ge_cols << " in bands consuming " << compress_matrix_words * sizeof(u64) << " bytes" << endl;)
 	CAT_IF_DUMP(cout << "Allocated " << pivot_count << " pivots, consuming " << pivot_words*2 << " bytes" << endl;)
 	CAT_IF_DUMP(cout << "Allocated " << CAT_HEAVY_ROWS << " heavy rows, consuming " << heavy_bytes << " bytes" << endl;)
 
-	// Clear entire Compression matrix
+	// Clear all Compression matrix bands
 	memset(_compress_matrix, 0, compress_matrix_words * sizeof(u64));
 
 	// Clear entire GE matrix
@@ -5013,42 +6593,81 @@ bool Codec::AllocateWorkspace()
 	CAT_IF_DUMP(cout << endl << "---- AllocateWorkspace ----" << endl << endl;)
 
 	// Count needed rows and columns
-	const u32 recovery_size = (_block_count + _mix_count + 1) * _block_bytes; // +1 for temporary space
+	const size_t recovery_size = (_block_count + _mix_count + 1) * _block_bytes; // +1 for temporary space
 	const u32 row_count = _block_count + _extra_count;
 	const u32 column_count = _block_count;
 
+	// If need to allocate more recovery blocks,
+	if (_recovery_allocated < recovery_size)
+	{
+		FreeRecoveryBlocks();
+
+		// Allocate recovery blocks
+		_recovery_blocks = new u8[recovery_size];
+		if (!_recovery_blocks) return false;
+		_recovery_allocated = recovery_size;
+	}
+
 	// Calculate size
-	u32 size = recovery_size + sizeof(PeelRow) * row_count
-		+ sizeof(PeelColumn) * column_count + sizeof(PeelRefs) * column_count;
+	size_t size = sizeof(PeelRow) * row_count
+		+ sizeof(PeelColumn) * column_count + sizeof(PeelRefs) * column_count
+		+ sizeof(CompressRow) * column_count;
 	if (_workspace_allocated < size)
 	{
-		FreeWorkspace();
+		FreePeelWorkspace();
 
 		// Allocate workspace
-		_recovery_blocks = new u8[size];
-		if (!_recovery_blocks) return false;
+		_workspace = new u8[size];
+		if (!_workspace) return false;
 		_workspace_allocated = size;
 	}
 
-	// Set pointers
-	_peel_rows = reinterpret_cast<PeelRow *>( _recovery_blocks + recovery_size );
-	_peel_cols = reinterpret_cast<PeelColumn *>( _peel_rows + row_count );
+	// Set pointers: Columns first so that their generation stamps do not move
+	_peel_cols = reinterpret_cast<PeelColumn *>( _workspace );
 	_peel_col_refs = reinterpret_cast<PeelRefs *>( _peel_cols + column_count );
+	_peel_rows = reinterpret_cast<PeelRow *>( _peel_col_refs + column_count );
+	_compress_rows = reinterpret_cast<CompressRow *>( _peel_rows + row_count );
+
+	CAT_IF_DUMP(cout << "Memory overhead for workspace = " << size << " bytes, plus " << recovery_size << " bytes of recovery blocks" << endl;)
 
-	CAT_IF_DUMP(cout << "Memory overhead for workspace = " << size << " bytes" << endl;)
+	ClearPeelColumns();
 
-	// Initialize columns
-	for (int ii = 0; ii < _block_count; ++ii)
+	return true;
+}
+
+/*
+	ClearPeelColumns
+
+		Instead of clearing every column before each message, columns
+	carry a generation stamp and are cleared lazily the first time a row
+	touches them, or by GreedyPeeling() if no row did.  Advancing the
+	codec generation clears all of the columns at once.
+
+		The stamps can only be trusted for the same column count that they
+	were written for, because the other workspace arrays move when N
+	changes.  So a full pass is done when N changes, after allocating
+	the workspace, and when the generation counter wraps around.
+*/
+
+void Codec::ClearPeelColumns()
+{
+	// If stamps can be trusted and the generation does not wrap,
+	if (_stamped_columns == _block_count && ++_generation != 0)
+		return;
+
+	// Stamp every column with the current generation
+	for (int ii = 0; ii < (int)_block_count; ++ii)
 	{
 		_peel_col_refs[ii].row_count = 0;
 		_peel_cols[ii].w2_refs = 0;
 		_peel_cols[ii].mark = MARK_TODO;
+		_peel_cols[ii].generation = _generation;
 	}
 
-	return true;
+	_stamped_columns = _block_count;
 }
 
-void Codec::FreeWorkspace()
+void Codec::FreeRecoveryBlocks()
 {
 	if (_recovery_blocks)
 	{
@@ -5056,7 +6675,36 @@ void Codec::FreeWorkspace()
 		_recovery_blocks = 0;
 	}
 
+	_recovery_allocated = 0;
+}
+
+void Codec::FreePeelWorkspace()
+{
+	if (_workspace)
+	{
+		delete []_workspace;
+		_workspace = 0;
+	}
+
 	_workspace_allocated = 0;
+	_stamped_columns = 0;
+}
+
+void Codec::FreeWorkspace()
+{
+	FreeRecoveryBlocks();
+	FreePeelWorkspace();
+}
+
+void Codec::FreeDecks()
+{
+	if (_decks_private)
+	{
+		delete []_decks_private;
+		_decks_private = 0;
+	}
+
+	_decks_allocated = 0;
 }
 
 
@@ -5105,22 +6753,22 @@ void Codec::PrintExtraMatrix()
 
 	// For each pivot,
 	int extra_count = 0;
-	const u16 column_count = _defer_count + _mix_count;
-	const u16 first_heavy_row = _defer_count + _dense_count;
-	for (u16 pivot_i = 0; pivot_i < _pivot_count; ++pivot_i)
+	const uidx column_count = _defer_count + _mix_count;
+	const uidx first_heavy_row = _defer_count + _dense_count;
+	for (uidx pivot_i = 0; pivot_i < _pivot_count; ++pivot_i)
 	{
 		// If row is extra,
-		u16 ge_row_i = _pivots[pivot_i];
+		uidx ge_row_i = _pivots[pivot_i];
 		if (ge_row_i >= first_heavy_row && ge_row_i < first_heavy_row + _extra_count)
 		{
 			u64 * CAT_RESTRICT ge_row = _ge_matrix + _ge_pitch * ge_row_i;
-			u16 heavy_row_i = ge_row_i - first_heavy_row;
+			uidx heavy_row_i = ge_row_i - first_heavy_row;
 			u8 * CAT_RESTRICT heavy_row = _heavy_matrix + _heavy_pitch * heavy_row_i;
 
 			cout << "row=" << ge_row_i << " : light={ ";
 
 			// For each non-heavy column,
-			for (u16 ge_column_i = 0; ge_column_i < _first_heavy_column; ++ge_column_i)
+			for (uidx ge_column_i = 0; ge_column_i < _first_heavy_column; ++ge_column_i)
 			{
 				// If column is non-zero,
 				u64 ge_mask = (u64)1 << (ge_column_i & 63);
@@ -5137,9 +6785,9 @@ void Codec::PrintExtraMatrix()
 			cout << " } heavy=(";
 
 			// For each heavy column,
-			for (u16 ge_column_i = _first_heavy_column; ge_column_i < column_count; ++ge_column_i)
+			for (uidx ge_column_i = _first_heavy_column; ge_column_i < column_count; ++ge_column_i)
 			{
-				u16 heavy_col_i = ge_column_i - _first_heavy_column;
+				uidx heavy_col_i = ge_column_i - _first_heavy_column;
 				u8 code_value = heavy_row[heavy_col_i];
 
 				cout << " " << hex << setfill('0') << setw(2) << (int)code_value << dec;
@@ -5163,9 +6811,13 @@ void Codec::PrintCompressMatrix()
 
 	for (int ii = 0; ii < rows; ++ii)
 	{
+		const CompressRow *band = &_compress_rows[ii];
+
 		for (int jj = 0; jj < cols; ++jj)
 		{
-			if (_compress_matrix[_ge_pitch * ii + (jj >> 6)] & ((u64)1 << (jj & 63)))
+			const int word = jj >> 6;
+			if (word >= band->first_word && word < band->first_word + band->word_count &&
+				(_compress_matrix[band->offset + word - band->first_word] & ((u64)1 << (jj & 63))))
 				cout << '1';
 			else
 				cout << '0';
@@ -5180,7 +6832,7 @@ void Codec::PrintPeeled()
 {
 	cout << "Peeled elements :";
 
-	u16 row_i = _peel_head_rows;
+	uidx row_i = _peel_head_rows;
 	while (row_i != LIST_TERM)
 	{
 		PeelRow *row = &_peel_rows[row_i];
@@ -5197,7 +6849,7 @@ void Codec::PrintDeferredRows()
 {
 	cout << "Deferred rows :";
 
-	u16 row_i = _defer_head_rows;
+	uidx row_i = _defer_head_rows;
 	while (row_i != LIST_TERM)
 	{
 		PeelRow *row = &_peel_rows[row_i];
@@ -5214,7 +6866,7 @@ void Codec::PrintDeferredColumns()
 {
 	cout << "Deferred columns :";
 
-	u16 column_i = _defer_head_columns;
+	uidx column_i = _defer_head_columns;
 	while (column_i != LIST_TERM)
 	{
 		PeelColumn *column = &_peel_cols[column_i];
@@ -5232,13 +6884,18 @@ void Codec::PrintDeferredColumns()
 
 //// Encoder Mode
 
-Result Codec::InitializeEncoder(int message_bytes, int block_bytes)
+Result Codec::InitializeEncoder(u64 message_bytes, int block_bytes)
 {
+	StopRepairRing();
+	StopAsyncSolve();
+
+	_solved_encoder = false;
+
 	Result r = ChooseMatrix(message_bytes, block_bytes);
 	if (!r)
 	{
 		// Calculate partial final bytes
-		u32 partial_final_bytes = message_bytes % _block_bytes;
+		u32 partial_final_bytes = (u32)(message_bytes % _block_bytes);
 		if (partial_final_bytes <= 0) partial_final_bytes = _block_bytes;
 
 		// Encoder-specific
@@ -5270,23 +6927,200 @@ Result Codec::EncodeFeed(const void *message_in)
 {
 	CAT_IF_DUMP(cout << endl << "---- EncodeFeed ----" << endl << endl;)
 
-	// Validate input
-	if CAT_UNLIKELY(message_in == 0) return R_BAD_INPUT;
+	// Validate input
+	if CAT_UNLIKELY(message_in == 0 || _workspace == 0) return R_BAD_INPUT;
+
+	SetInput(message_in);
+
+	// Solve matrix, trying backup peel seeds if the seed is not checked yet
+	Result r = _seed_checked ? SolveOriginalRows() : FindPeelSeed();
+
+	// Generate recovery blocks
+	if (!r) GenerateRecoveryBlocks();
+
+	// Keep the solution for UpdateBlocks()
+	_solved_encoder = (r == R_WIN);
+	return r;
+}
+
+/*
+	SolveOriginalRows
+
+		This function peels the N original rows and solves the matrix,
+	without touching any block values.
+*/
+
+Result Codec::SolveOriginalRows()
+{
+	// For each input row,
+	for (uidx id = 0; id < _block_count; ++id)
+	{
+		if (!OpportunisticPeeling(id, id))
+			return R_BAD_PEEL_SEED;
+	}
+
+	Result r = SolveMatrix();
+	return r == R_MORE_BLOCKS ? R_BAD_PEEL_SEED : r;
+}
+
+/*
+	FindPeelSeed
+
+		This function tries the peel seeds in LargePeelSeed() order until
+	the matrix for the original rows can be solved, and publishes the one
+	that works for N.  On success the matrix is left solved, so that the
+	encoder can go on to generate the recovery blocks.
+*/
+
+Result Codec::FindPeelSeed()
+{
+	for (u32 index = 0; index < LARGE_SEED_TRIES; ++index)
+	{
+		_p_seed = LargePeelSeed(_block_count, index);
+
+		// Start over with no rows
+		_peel_head_rows = LIST_TERM;
+		_peel_tail_rows = 0;
+		_defer_head_rows = LIST_TERM;
+		ClearPeelColumns();
+
+		Result r = SolveOriginalRows();
+		if (r == R_WIN)
+		{
+			AtomicStore(SeedCacheSlot(_block_count), (u32)_block_count << 4 | index);
+			_seed_checked = true;
+		}
+		if (r != R_BAD_PEEL_SEED)
+			return r;
+	}
+
+	return R_BAD_PEEL_SEED;
+}
+
+/*
+	UpdateBlocks
+
+		The check matrix of the encoder only depends on N, so when a few
+	blocks of the message change, the peeling, compression and Gaussian
+	elimination of EncodeFeed() come out the same.  This function keeps
+	that solution and only runs the substitution again, which generates
+	the recovery blocks from the message.  That skips most of the work
+	for small blocks, and about a third of it for blocks around 1 KB.
+
+		Each recovery block depends on the whole message, so every one of
+	them changes even when a single block changes, and the substitution
+	has to run over all of them.
+
+		The encoder takes its own copy of the message the first time, so
+	the caller's message is not written.
+*/
+
+Result Codec::UpdateBlocks(const u32 * CAT_RESTRICT ids, const void * const * CAT_RESTRICT blocks, u32 count)
+{
+	CAT_IF_DUMP(cout << endl << "---- UpdateBlocks ----" << endl << endl;)
+
+	// Validate input
+	if CAT_UNLIKELY(!ids || !blocks || !_solved_encoder) return R_BAD_INPUT;
+	for (u32 ii = 0; ii < count; ++ii)
+	{
+		if CAT_UNLIKELY(ids[ii] >= _block_count || !blocks[ii]) return R_BAD_INPUT;
+	}
+
+	// Precomputed repair blocks are out of date
+	StopRepairRing();
+
+	// If the message is still referenced, copy it
+	if (_input_allocated == 0)
+	{
+		const u8 * CAT_RESTRICT message = _input_blocks;
+
+		if (!AllocateInput())
+		{
+			SetInput(message);
+			return R_OUT_OF_MEMORY;
+		}
+
+		memcpy(_input_blocks, message, (_block_count - 1) * _block_bytes + _input_final_bytes);
+	}
+
+	// Write the new blocks
+	for (u32 ii = 0; ii < count; ++ii)
+	{
+		const u32 id = ids[ii];
+		const size_t bytes = (id != (u32)_block_count - 1) ? _block_bytes : _input_final_bytes;
+		memcpy(_input_blocks + _block_bytes * id, blocks[ii], bytes);
+	}
+
+	// Reset the state that the substitution changes
+	for (uidx row_i = _peel_head_rows; row_i != LIST_TERM; row_i = _peel_rows[row_i].next)
+		_peel_rows[row_i].is_copied = 0;
+	RebuildColumnRefs();
+
+	GenerateRecoveryBlocks();
+
+	return R_WIN;
+}
+
+/*
+	TrimEncoder
+
+		After EncodeFeed() succeeds, Encode() only needs the parameters,
+	the recovery blocks and the referenced message.  This function releases
+	the peeling workspace and the GE/Compression matrix memory, which are
+	only needed while solving.  If the codec is reused by calling
+	InitializeEncoder() again, they are allocated again as needed.
+
+		Decoders keep received blocks in the input buffer and need the
+	peeling workspace to reconstruct the message, so they cannot be trimmed.
+*/
+
+Result Codec::TrimEncoder()
+{
+	// Validate that this is an encoder that has recovery blocks
+	if CAT_UNLIKELY(_recovery_blocks == 0 || _extra_count > 0)
+		return R_BAD_INPUT;
+
+	// The solution is released, so blocks can no longer be updated
+	_solved_encoder = false;
+
+	FreeMatrix();
+	FreePeelWorkspace();
+	FreeDecks();
+
+	return R_WIN;
+}
+
+/*
+	SwapSolverMemory
 
-	SetInput(message_in);
+		The peeling workspace, the matrices and the private deck table
+	are only needed while solving.  Handing them between objects lets a
+	worker that encodes many messages keep one warm set of solver memory,
+	while each encoder keeps only its own recovery blocks.  The column
+	generation stamps belong to the workspace, so they move with it.
+*/
 
-	// For each input row,
-	for (u16 id = 0; id < _block_count; ++id)
-	{
-		if (!OpportunisticPeeling(id, id))
-			return R_BAD_PEEL_SEED;
-	}
+template<class T> static CAT_INLINE void SwapValues(T &a, T &b)
+{
+	T t = a;
+	a = b;
+	b = t;
+}
 
-	// Solve matrix and generate recovery blocks
-	Result r = SolveMatrix();
-	if (!r) GenerateRecoveryBlocks();
-	else if (r == R_MORE_BLOCKS) r = R_BAD_PEEL_SEED;
-	return r;
+void Codec::SwapSolverMemory(Codec &other)
+{
+	// Neither object keeps the solution that matches its recovery blocks
+	_solved_encoder = false;
+	other._solved_encoder = false;
+
+	SwapValues(_workspace, other._workspace);
+	SwapValues(_workspace_allocated, other._workspace_allocated);
+	SwapValues(_stamped_columns, other._stamped_columns);
+	SwapValues(_generation, other._generation);
+	SwapValues(_compress_matrix, other._compress_matrix);
+	SwapValues(_ge_allocated, other._ge_allocated);
+	SwapValues(_decks_private, other._decks_private);
+	SwapValues(_decks_allocated, other._decks_allocated);
 }
 
 /*
@@ -5296,9 +7130,13 @@ Result Codec::EncodeFeed(const void *message_in)
 	it simply copies the input to the output block.  For other
 	block identifiers, it will generate a new random row and
 	sum together recovery blocks to produce the new block.
+
+		It only reads the recovery blocks, the input message and the
+	matrix parameters, so it may be called from several threads at once.
+	Debug output is collected per call so that it does not interleave.
 */
 
-u32 Codec::Encode(u32 id, void *block_out)
+u32 Codec::Encode(u32 id, void *block_out) const
 {
 	if (!block_out) return 0;
 	u8 * CAT_RESTRICT block = reinterpret_cast<u8 *>( block_out );
@@ -5309,7 +7147,7 @@ u32 Codec::Encode(u32 id, void *block_out)
 	{
 		// Until the final block in message blocks,
 		const u8 * CAT_RESTRICT src = _input_blocks + _block_bytes * id;
-		if ((int)id == _block_count - 1)
+		if ((int)id == (int)_block_count - 1)
 		{
 			// For the final block, copy partial block
 			memcpy(block, src, _input_final_bytes);
@@ -5322,16 +7160,17 @@ u32 Codec::Encode(u32 id, void *block_out)
 	}
 #endif // CAT_COPY_FIRST_N
 
-	CAT_IF_DUMP(cout << "Encode: Generating row " << id << ":";)
+	CAT_IF_DUMP(ostringstream dump;)
+	CAT_IF_DUMP(dump << "Encode: Generating row " << id << ":";)
 
-	u16 peel_weight, peel_a, peel_x, mix_a, mix_x;
+	uidx peel_weight, peel_a, peel_x, mix_a, mix_x;
 	GeneratePeelRow(id, _p_seed, _block_count, _mix_count,
 		peel_weight, peel_a, peel_x, mix_a, mix_x);
 
 	// Remember first column (there is always at least one)
-	u8 * CAT_RESTRICT first = _recovery_blocks + _block_bytes * peel_x;
+	const u8 * CAT_RESTRICT first = _recovery_blocks + _block_bytes * peel_x;
 
-	CAT_IF_DUMP(cout << " " << peel_x;)
+	CAT_IF_DUMP(dump << " " << peel_x;)
 
 	// If peeler has multiple columns,
 	if (peel_weight > 1)
@@ -5340,7 +7179,7 @@ u32 Codec::Encode(u32 id, void *block_out)
 
 		IterateNextColumn(peel_x, _block_count, _block_next_prime, peel_a);
 
-		CAT_IF_DUMP(cout << " " << peel_x;)
+		CAT_IF_DUMP(dump << " " << peel_x;)
 
 		// Combine first two columns into output buffer (faster than memcpy + memxor)
 		memxor_set(block, first, _recovery_blocks + _block_bytes * peel_x, _block_bytes);
@@ -5350,7 +7189,7 @@ u32 Codec::Encode(u32 id, void *block_out)
 		{
 			IterateNextColumn(peel_x, _block_count, _block_next_prime, peel_a);
 
-			CAT_IF_DUMP(cout << " " << peel_x;)
+			CAT_IF_DUMP(dump << " " << peel_x;)
 
 			// Mix in each column
 			memxor(block, _recovery_blocks + _block_bytes * peel_x, _block_bytes);
@@ -5365,36 +7204,216 @@ u32 Codec::Encode(u32 id, void *block_out)
 		memxor_set(block, first, _recovery_blocks + _block_bytes * (_block_count + mix_x), _block_bytes);
 	}
 
-	CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
+	CAT_IF_DUMP(dump << " " << (_block_count + mix_x);)
 
 	// For each remaining mixer column,
 	IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
 	memxor(block, _recovery_blocks + _block_bytes * (_block_count + mix_x), _block_bytes);
-	CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
+	CAT_IF_DUMP(dump << " " << (_block_count + mix_x);)
 
 	IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
 	memxor(block, _recovery_blocks + _block_bytes * (_block_count + mix_x), _block_bytes);
-	CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
+	CAT_IF_DUMP(dump << " " << (_block_count + mix_x);)
 
-	CAT_IF_DUMP(cout << endl;)
+	CAT_IF_DUMP(dump << endl; cout << dump.str();)
 
 	return _block_bytes;
 }
 
 
+//// Repair Ring
+
+/*
+	StartRepairRing
+
+		This function starts precomputing the repair blocks for ids
+	first_id, first_id + 1, ... into a ring of count slots, so that
+	the send path only has to copy them out.  The ring is filled by a
+	background task on the executor, which is started again whenever
+	half of the ring has been consumed.  Without an executor, the ring
+	is filled on the calling thread, and calling this again with the
+	same parameters fills it up again.
+
+		The ring has one producer at a time.  Consumers move the tail
+	forward with compare-and-swap, so blocks are only handed out once.
+*/
+
+Result Codec::StartRepairRing(u32 first_id, u32 count)
+{
+	// If already running with the same parameters, fill it up
+	if (count > 0 && count == _ring_size && first_id == _ring_first_id)
+	{
+		if (_executor.start)
+			ScheduleRepairFill();
+		else
+			FillRepairRing();
+
+		return R_WIN;
+	}
+
+	StopRepairRing();
+
+	if (count == 0)
+		return R_WIN;
+
+	// Only repair ids of a solved encoder can be precomputed
+	if CAT_UNLIKELY(!_recovery_blocks || _extra_count != 0 || first_id < _block_count ||
+		count > 0xffffffff / _block_bytes)
+		return R_BAD_INPUT;
+
+	_ring_blocks = new u8[count * _block_bytes];
+	if (!_ring_blocks) return R_OUT_OF_MEMORY;
+
+	_ring_size = count;
+	_ring_first_id = first_id;
+	_ring_head = 0;
+	_ring_tail = 0;
+	_ring_busy = 0;
+
+	if (_executor.start)
+		ScheduleRepairFill();
+	else
+		FillRepairRing();
+
+	return R_WIN;
+}
+
+void Codec::FillRepairRing()
+{
+	u32 head = _ring_head;
+
+	// While there is a free slot,
+	while (head - AtomicLoad(&_ring_tail) < _ring_size)
+	{
+		Encode(_ring_first_id + head, _ring_blocks + _block_bytes * (head % _ring_size));
+
+		// Publish the block after it is written
+		AtomicStore(&_ring_head, ++head);
+	}
+}
+
+void Codec::StopRepairRing()
+{
+	if (_ring_size == 0)
+		return;
+
+	// Wait for any fill task that is still running
+	if (_executor.start)
+		_executor.finish(_executor.context, this);
+
+	delete []_ring_blocks;
+	_ring_blocks = 0;
+	_ring_size = 0;
+}
+
+void Codec::ScheduleRepairFill()
+{
+	// If more than half of the ring is still ready,
+	if (AtomicLoad(&_ring_head) - AtomicLoad(&_ring_tail) > _ring_size / 2)
+		return;
+
+	// If a fill task is already scheduled,
+	if (AtomicCompareSwap(&_ring_busy, 0, 1) != 0)
+		return;
+
+	_executor.start(_executor.context, RepairFillTask, this, _ring_size * _block_bytes);
+}
+
+void Codec::RepairFillTask(void *job, int /*index*/)
+{
+	Codec *codec = reinterpret_cast<Codec *>( job );
+
+	do
+	{
+		codec->FillRepairRing();
+
+		AtomicStore(&codec->_ring_busy, 0);
+
+		// If a block was consumed after the ring was full, keep going so the wakeup is not lost
+	} while (AtomicLoad(&codec->_ring_head) - AtomicLoad(&codec->_ring_tail) < codec->_ring_size &&
+		AtomicCompareSwap(&codec->_ring_busy, 0, 1) == 0);
+}
+
+bool Codec::ReadRepairRing(u32 id, void * CAT_RESTRICT block_out)
+{
+	if (_ring_size == 0)
+		return false;
+
+	// If the id is not between the tail and the head,
+	u32 position = id - _ring_first_id;
+	u32 tail = AtomicLoad(&_ring_tail);
+	if (position - tail >= AtomicLoad(&_ring_head) - tail)
+		return false;
+
+	memcpy(block_out, _ring_blocks + _block_bytes * (position % _ring_size), _block_bytes);
+
+	// Release the slot and any skipped before it.  If another consumer moved
+	// the tail first, the slot may have been refilled during the copy.
+	if (AtomicCompareSwap(&_ring_tail, tail, position + 1) != tail)
+		return false;
+
+	if (_executor.start)
+		ScheduleRepairFill();
+
+	return true;
+}
+
+const u8 *Codec::PeekRepairRing(u32 &id)
+{
+	if (_ring_size == 0)
+		return 0;
+
+	// If the producer has not caught up yet,
+	u32 tail = _ring_tail;
+	if (tail == AtomicLoad(&_ring_head))
+		return 0;
+
+	id = _ring_first_id + tail;
+	return _ring_blocks + _block_bytes * (tail % _ring_size);
+}
+
+void Codec::PopRepairRing()
+{
+	if (_ring_size == 0)
+		return;
+
+	u32 tail = _ring_tail;
+	if (tail == AtomicLoad(&_ring_head))
+		return;
+
+	AtomicStore(&_ring_tail, tail + 1);
+
+	if (_executor.start)
+		ScheduleRepairFill();
+}
+
+
 //// Decoder Mode
 
-Result Codec::InitializeDecoder(int message_bytes, int block_bytes)
+Result Codec::InitializeDecoder(u64 message_bytes, int block_bytes)
 {
+	StopRepairRing();
+	StopAsyncSolve();
+
+	_solved_encoder = false;
+
+	// If already decoding a message of the same size, skip choosing the matrix again
+	if (_input_allocated > 0 && _workspace && _extra_count == CAT_MAX_EXTRA_ROWS && _block_bytes == (size_t)block_bytes &&
+		message_bytes == (u64)(_block_count - 1) * _block_bytes + _output_final_bytes)
+	{
+		return ResetDecoder();
+	}
+
 	Result r = ChooseMatrix(message_bytes, block_bytes);
 	if (r == R_WIN)
 	{
 		// Calculate partial final bytes
-		u32 partial_final_bytes = message_bytes % _block_bytes;
+		u32 partial_final_bytes = (u32)(message_bytes % _block_bytes);
 		if (partial_final_bytes <= 0) partial_final_bytes = _block_bytes;
 
 		// Decoder-specific
 		_row_count = 0;
+		_solve_failed = false;
 		_output_final_bytes = partial_final_bytes;
 
 		// Hack: Prevents row-based ids from causing partial copies when they happen to be the last block id
@@ -5406,13 +7425,64 @@ Result Codec::InitializeDecoder(int message_bytes, int block_bytes)
 		_all_original = true;
 #endif
 
+		ResetDeposits();
+
+		// Spare blocks are sized for the old block size
+		FreeExpected();
+		ResetExpected();
+
 		if (!AllocateInput() || !AllocateWorkspace())
 			return R_OUT_OF_MEMORY;
+
+		// If the peel seed is not checked yet, find the one the encoder used
+		if (!_seed_checked)
+		{
+			r = FindPeelSeed();
+			if (r == R_WIN)
+				r = ResetDecoder();
+		}
 	}
 
 	return r;
 }
 
+/*
+	ResetDecoder
+
+		This function prepares the decoder for a new message of the same
+	size, keeping the matrix parameters chosen by InitializeDecoder() and
+	all of the allocated memory.  The peeling columns are cleared lazily
+	by advancing their generation, so it runs in constant time.
+*/
+
+Result Codec::ResetDecoder()
+{
+	// Validate that the decoder has been initialized
+	if CAT_UNLIKELY(_input_allocated == 0 || _workspace == 0 || _extra_count != CAT_MAX_EXTRA_ROWS)
+		return R_BAD_INPUT;
+
+	CAT_IF_DUMP(cout << endl << "---- ResetDecoder ----" << endl << endl;)
+
+	StopAsyncSolve();
+
+	// Initialize lists
+	_peel_head_rows = LIST_TERM;
+	_peel_tail_rows = 0;
+	_defer_head_rows = LIST_TERM;
+
+	_row_count = 0;
+	_solve_failed = false;
+#if defined(CAT_ALL_ORIGINAL)
+	_all_original = true;
+#endif
+
+	ResetDeposits();
+	ResetExpected();
+	ClearPeelColumns();
+
+	return R_WIN;
+}
+
 /*
 	DecodeFeed
 
@@ -5427,8 +7497,25 @@ Result Codec::DecodeFeed(u32 id, const void *block_in)
 	if CAT_UNLIKELY(block_in == 0)
 		return R_BAD_INPUT;
 
+	// If some expected blocks have not arrived yet,
+	if (_expect_missing > 0)
+	{
+		// If this is one of them, store it in its reserved row
+		ExpectSlot *slot = FindExpected(id);
+		if (slot)
+			return FillExpected(slot, block_in);
+
+		// If the rows are all spoken for, the prediction was wrong
+		if (_row_count >= _block_count)
+		{
+			Result r = AbandonExpected();
+			if (r != R_MORE_BLOCKS)
+				return r;
+		}
+	}
+
 	// If less than N rows stored,
-	u16 row_i = _row_count;
+	uidx row_i = _row_count;
 	if (row_i < _block_count)
 	{
 #if defined(CAT_ALL_ORIGINAL)
@@ -5462,6 +7549,13 @@ Result Codec::DecodeFeed(u32 id, const void *block_in)
 			// If just acquired N blocks,
 			if (++_row_count == _block_count)
 			{
+				// If some expected blocks have not arrived, solve without them
+				if (_expect_missing > 0)
+				{
+					Result r = SolveExpected();
+					return r == R_WIN ? R_MORE_BLOCKS : r;
+				}
+
 #if defined(CAT_ALL_ORIGINAL)
 				// If all original data,
 				if (_all_original && IsAllOriginalData())
@@ -5484,3 +7578,251 @@ Result Codec::DecodeFeed(u32 id, const void *block_in)
 	return r;
 }
 
+/*
+	SeedKnown
+
+		This function feeds the decoder original blocks that the receiver
+	already has, such as the unchanged blocks of an older version of the
+	message.  Block i is marked by bit (i & 7) of bitmap byte (i >> 3) and
+	is read from offset i * block_bytes of message_in.
+
+		The marked rows are peeled and copied straight into the input
+	rows in one pass over the bitmap, skipping bytes with no marks, so it
+	avoids the per-block checks of DecodeFeed().  The rows are copied
+	rather than referenced because the solver works on them in place.
+	Once N rows are stored the rest go through DecodeFeed().
+*/
+
+Result Codec::SeedKnown(const u8 * CAT_RESTRICT bitmap, const void * CAT_RESTRICT message_in)
+{
+	// Validate input
+	if CAT_UNLIKELY(!bitmap || !message_in || _extra_count != CAT_MAX_EXTRA_ROWS)
+		return R_BAD_INPUT;
+
+	// Seeding does not mix with predicted or concurrent blocks
+	if CAT_UNLIKELY(_expect_missing > 0 || _deposit_next != 0)
+		return R_BAD_INPUT;
+
+	const u8 * CAT_RESTRICT message = reinterpret_cast<const u8 *>( message_in );
+	const uidx last_id = _block_count - 1;
+
+	// For each marked block,
+	for (u32 id = 0; id <= last_id; ++id)
+	{
+		// If no blocks are marked in this byte, skip it
+		u8 marks = bitmap[id >> 3];
+		if (!marks)
+		{
+			id |= 7;
+			continue;
+		}
+
+		if (marks & (1 << (id & 7)))
+		{
+			const u8 *block_in = message + _block_bytes * id;
+
+			// If N rows are already stored, resume solving from this row
+			uidx row_i = _row_count;
+			if (row_i >= _block_count)
+			{
+				Result r = DecodeFeed(id, block_in);
+				if (r != R_MORE_BLOCKS)
+					return r;
+				continue;
+			}
+
+			// If opportunistic peeling failed, skip the row
+			if (!OpportunisticPeeling(row_i, id))
+				continue;
+
+			u8 *block_store = _input_blocks + _block_bytes * row_i;
+
+			// If this is the last block id,
+			if (id == last_id)
+			{
+				u32 final_bytes = _output_final_bytes;
+
+				// Copy the new row data into the input block area
+				memcpy(block_store, block_in, final_bytes);
+
+				// Pad with zeroes
+				memset(block_store + final_bytes, 0, _block_bytes - final_bytes);
+			}
+			else
+			{
+				// Copy the new row data into the input block area
+				memcpy(block_store, block_in, _block_bytes);
+			}
+
+			// If just acquired N blocks,
+			if (++_row_count == _block_count)
+			{
+#if defined(CAT_ALL_ORIGINAL)
+				// If all original data,
+				if (_all_original && IsAllOriginalData())
+					return R_WIN;
+#endif
+
+				// Attempt to solve the matrix and generate recovery blocks
+				Result r = SolveMatrix();
+				if (r != R_MORE_BLOCKS)
+				{
+					if (!r) Codec::GenerateRecoveryBlocks();
+					return r;
+				}
+			}
+		}
+	}
+
+	return R_MORE_BLOCKS;
+}
+
+/*
+	BlocksNeeded
+
+		Before N rows are stored, the decoder needs at least N minus the
+	number of stored rows, and usually exactly that many.
+
+		After a solve attempt fails, Triangle() has stopped at the first
+	column with no pivot, and the columns after it have not been looked
+	at.  Each new block adds one row, so it finds at most one missing
+	pivot, and the unused rows may find the rest.  This counts the
+	columns left over after pairing each with an unused row, which is
+	at least one.  It is a lower bound because unused rows may turn out
+	to be dependent, but the deficit is almost always a single pivot.
+
+		Expected blocks that have not arrived are needed on top of that.
+*/
+
+u32 Codec::BlocksNeeded() const
+{
+	u32 needed = _expect_missing;
+
+	// If fewer than N rows are stored,
+	if (_row_count < _block_count)
+		return needed + (_block_count - _row_count);
+
+	// If the last solve attempt failed,
+	if (_solve_failed)
+	{
+		const uidx column_count = _defer_count + _mix_count;
+		uidx missing_count = column_count - _next_pivot;
+
+		// Heavy rows are only added to the pivot list at the first heavy column
+		uidx unused_count = _pivot_count - _next_pivot;
+		if (_next_pivot < _first_heavy_column)
+			unused_count += CAT_HEAVY_ROWS;
+
+		needed += missing_count > unused_count ? missing_count - unused_count : 1;
+	}
+
+	return needed;
+}
+
+/*
+	DepositBlock
+
+		This function lets several threads feed the same decoder, such
+	as one thread per receive queue.  Each block reserves one of the
+	first N input slots with an atomic counter and is copied into it
+	without taking a lock, so the copies run in parallel.  Only the
+	thread that finishes copying the N-th block goes on to peel all of
+	the rows and solve the matrix, because those steps change shared
+	structure.
+
+		Once all N slots are reserved, a block is passed to DecodeFeed()
+	by whichever thread takes the solver lock.  If another thread holds
+	it, the block is dropped like a lost packet instead of waiting.
+*/
+
+Result Codec::DepositBlock(u32 id, const void * CAT_RESTRICT block_in)
+{
+	// Validate input
+	if CAT_UNLIKELY(block_in == 0)
+		return R_BAD_INPUT;
+
+	// If the message is already decoded, or the background solve failed,
+	Result result = (Result)AtomicLoad(&_deposit_result);
+	if (result != R_MORE_BLOCKS)
+		return result;
+
+	// If there may be a free slot,
+	if (AtomicLoad(&_deposit_next) < _block_count)
+	{
+		u32 slot = AtomicAdd(&_deposit_next, 1) - 1;
+
+		// If a slot was reserved,
+		if (slot < _block_count)
+		{
+			u8 *block_store = _input_blocks + _block_bytes * slot;
+
+			// If this is the last block id,
+			if (id == (u32)_block_count - 1)
+			{
+				u32 final_bytes = _output_final_bytes;
+
+				// Copy the new row data into the reserved slot
+				memcpy(block_store, block_in, final_bytes);
+
+				// Pad with zeroes
+				memset(block_store + final_bytes, 0, _block_bytes - final_bytes);
+			}
+			else
+			{
+				// Copy the new row data into the reserved slot
+				memcpy(block_store, block_in, _block_bytes);
+			}
+
+			// Remember the id for peeling later
+			_peel_rows[slot].id = id;
+
+			// If other slots are still being filled,
+			if (AtomicAdd(&_deposit_count, 1) < _block_count)
+				return R_MORE_BLOCKS;
+
+			// This thread filled the last slot, so it owns the solver lock
+			if (_solved_callback)
+			{
+				_executor.start(_executor.context, PeelDepositsTask, this, _block_count * _block_bytes);
+				return R_MORE_BLOCKS;
+			}
+
+			Result r = PeelDeposits();
+			if (r == R_WIN)
+				AtomicStore(&_deposit_result, R_WIN);
+			AtomicStore(&_deposit_lock, 0);
+			return r;
+		}
+	}
+
+	// If solving in the background,
+	if (_solved_callback)
+	{
+		// Queue the block, or drop it if the queue is full
+		if (!EnqueueBlock(id, block_in))
+			return R_MORE_BLOCKS;
+
+		// If the solver is idle, start a worker to use the block
+		if (AtomicCompareSwap(&_deposit_lock, 0, 1) == 0)
+			_executor.start(_executor.context, ResumeDepositsTask, this, _block_bytes);
+
+		return R_MORE_BLOCKS;
+	}
+
+	// If another thread owns the solver, drop the block
+	if (AtomicCompareSwap(&_deposit_lock, 0, 1) != 0)
+		return R_MORE_BLOCKS;
+
+	// Check again now that the lock is held
+	Result r = R_WIN;
+	if (_deposit_result != R_WIN)
+	{
+		r = DecodeFeed(id, block_in);
+		if (r == R_WIN)
+			AtomicStore(&_deposit_result, R_WIN);
+	}
+
+	AtomicStore(&_deposit_lock, 0);
+	return r;
+}
+
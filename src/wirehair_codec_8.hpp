@@ -39,10 +39,17 @@
 
 // Limits:
 #define CAT_REF_LIST_MAX 32 /* Tune to be as small as possible and still succeed */
-#define CAT_MAX_DENSE_ROWS 500 /* Maximum check row count */
 #define CAT_MAX_EXTRA_ROWS 32 /* Maximum number of extra rows to support before reusing existing rows */
+#define CAT_MAX_EXPECT_SPARES 32 /* Maximum number of spare expected blocks to set aside */
+#if defined(WIREHAIR_LARGE_N)
+#define CAT_MAX_DENSE_ROWS 6700 /* Maximum check row count */
+#define CAT_WIREHAIR_MAX_N 1000000 /* Largest N value to allow with 32-bit indices */
+#else
+#define CAT_MAX_DENSE_ROWS 500 /* Maximum check row count */
 #define CAT_WIREHAIR_MAX_N 64000 /* Largest N value to allow */
+#endif
 #define CAT_WIREHAIR_MIN_N 2 /* Smallest N value to allow */
+#define CAT_DECK_CACHE_BYTES 4000000 /* Bytes of Shuffle-2 decks to share between codec objects */
 
 // Optimization options:
 #define CAT_COPY_FIRST_N /* Copy the first N rows from the input (faster) */
@@ -51,6 +58,11 @@
 #define CAT_WINDOWED_LOWERTRI /* Use window optimization for lower triangle elimination (faster) */
 #define CAT_ALL_ORIGINAL /* Avoid doing calculations for 0 losses -- Requires CAT_COPY_FIRST_N (faster) */
 
+// Parallelism:
+#define CAT_TASK_BYTES 65536 /* Target bytes of block operations per parallel task */
+#define CAT_MIN_SLICE_BYTES 256 /* Shortest byte range of each block to give a task */
+#define CAT_SOLVE_QUEUE_SIZE 64 /* Number of blocks that can be queued during a background solve */
+
 // Heavy rows:
 #define CAT_HEAVY_ROWS 6 /* Number of heavy rows to add - Tune for desired overhead / performance trade-off */
 #define CAT_HEAVY_MAX_COLS 18 /* Number of heavy columns that are non-zero */
@@ -60,6 +72,22 @@ namespace cat {
 namespace wirehair {
 
 
+//// Row and column indices
+
+/*
+	Rows and columns of the check matrix are counted with 16-bit indices,
+	which keeps the peeling structures small and limits N to 64000.
+	Building with WIREHAIR_LARGE_N widens them to 32 bits for one codec
+	over a much larger message.  Both builds generate the same matrix for
+	N <= 64000, so they interoperate at those sizes.
+*/
+#if defined(WIREHAIR_LARGE_N)
+typedef u32 uidx;
+#else
+typedef u16 uidx;
+#endif
+
+
 //// Result object
 
 enum Result
@@ -81,62 +109,145 @@ enum Result
 const char *GetResultString(Result r);
 
 
+//// Executor
+
+// Task run by an executor once for each index from 0 to count - 1
+typedef void (*TaskFunction)(void *job, int index);
+
+// Called once when a background solve finishes, with non-zero success if the message was decoded
+typedef void (*SolvedCallback)(void *context, int success);
+
+/*
+	Runs a batch of tasks that may execute in parallel, returning after
+	all of them have completed.  Without an executor the codec runs its
+	tasks serially on the calling thread.
+
+	task_bytes is roughly how many bytes of block operations each task
+	performs, as a hint for scheduling.
+
+	start() runs one task in the background and returns right away, and
+	finish() returns after every task started for the job has completed.
+	These are only used for work that outlives a single call, like the
+	repair ring.
+*/
+struct Executor
+{
+	void *context;		// Passed to run(), start() and finish()
+	int worker_count;	// Number of tasks that can run at once
+	void (*run)(void *context, TaskFunction task, void *job, int count, u32 task_bytes);
+	void (*start)(void *context, TaskFunction task, void *job, u32 task_bytes);
+	void (*finish)(void *context, void *job);
+};
+
+
 //// Encoder/Decoder Combined Implementation
 
 class CAT_EXPORT Codec
 {
 	// Parameters
-	u32 _block_bytes;					// Number of bytes in a block
-	u16 _block_count;					// Number of blocks in the message
-	u16 _block_next_prime;				// Next prime number at or above block count
-	u16 _extra_count;					// Number of extra rows to allocate
+	size_t _block_bytes;				// Number of bytes in a block, wide so block offsets cannot wrap
+	uidx _block_count;					// Number of blocks in the message
+	uidx _block_next_prime;				// Next prime number at or above block count
+	uidx _extra_count;					// Number of extra rows to allocate
 	u32 _p_seed;						// Seed for peeled rows of check matrix
 	u32 _d_seed;						// Seed for dense rows of check matrix
-	u16 _row_count;						// Number of stored rows
-	u16 _mix_count;						// Number of mix columns
-	u16 _mix_next_prime;				// Next prime number at or above dense count
-	u16 _dense_count;					// Number of added dense code rows
+	bool _seed_checked;					// Peel seed is known to solve the original rows?
+	uidx _row_count;						// Number of stored rows
+	uidx _mix_count;						// Number of mix columns
+	uidx _mix_next_prime;				// Next prime number at or above dense count
+	uidx _dense_count;					// Number of added dense code rows
 	u8 * CAT_RESTRICT _recovery_blocks;	// Recovery blocks
+	size_t _recovery_allocated;			// Number of bytes allocated for recovery blocks
 	u8 * CAT_RESTRICT _input_blocks;	// Input message blocks
 	u32 _input_final_bytes;				// Number of bytes in final block of input
 	u32 _output_final_bytes;			// Number of bytes in final block of output
-	u32 _input_allocated;				// Number of bytes allocated for input, or 0 if referenced
+	size_t _input_allocated;				// Number of bytes allocated for input, or 0 if referenced
 #if defined(CAT_ALL_ORIGINAL)
 	bool _all_original;					// Boolean: Only seen original data block identifiers
 #endif
+	bool _solved_encoder;				// Boolean: Solver memory still holds the encoder solution for UpdateBlocks()
 
 	// Peeling state
 	struct PeelRow;
 	struct PeelColumn;
 	struct PeelRefs;
+	struct CompressRow;
 	PeelRow * CAT_RESTRICT _peel_rows;		// Array of N peeling matrix rows
 	PeelColumn * CAT_RESTRICT _peel_cols;	// Array of N peeling matrix columns
 	PeelRefs * CAT_RESTRICT _peel_col_refs;	// List of column references
+	CompressRow * CAT_RESTRICT _compress_rows;	// Band of each Compression matrix row
 	PeelRow * CAT_RESTRICT _peel_tail_rows;	// Tail of peeling solved rows list
-	u32 _workspace_allocated;				// Number of bytes allocated for workspace
-	static const u16 LIST_TERM = 0xffff;
-	u16 _peel_head_rows;					// Head of peeling solved rows list
-	u16 _defer_head_columns;				// Head of peeling deferred columns list
-	u16 _defer_head_rows;					// Head of peeling deferred rows list
-	u16 _defer_count;						// Count of deferred rows
+	u8 * CAT_RESTRICT _workspace;			// Peeling workspace holding the arrays above
+	size_t _workspace_allocated;				// Number of bytes allocated for workspace
+	uidx _stamped_columns;					// Number of columns with trusted generation stamps
+	u8 _generation;							// Columns with a different generation stamp are cleared
+	static const uidx LIST_TERM = (uidx)~0;
+	uidx _peel_head_rows;					// Head of peeling solved rows list
+	uidx _defer_head_columns;				// Head of peeling deferred columns list
+	uidx _defer_head_rows;					// Head of peeling deferred rows list
+	uidx _defer_count;						// Count of deferred rows
 
 	// Gaussian elimination state
 	u64 * CAT_RESTRICT _ge_matrix;			// Gaussian elimination matrix
-	u32 _ge_allocated;						// Number of bytes allocated to GE matrix
-	u64 * CAT_RESTRICT _compress_matrix;	// Gaussian elimination compression matrix
-	int _ge_pitch;							// Words per row of GE matrix and compression matrix
-	u16 * CAT_RESTRICT _pivots;				// Pivots for each column of the GE matrix
-	u16 _pivot_count;						// Number of pivots in the pivot list
-	u16 * CAT_RESTRICT _ge_col_map;			// Map of GE columns to conceptual matrix columns
-	u16 * CAT_RESTRICT _ge_row_map;			// Map of GE rows to conceptual matrix rows
-	u16 _next_pivot;						// Pivot to resume Triangle() on after it fails
+	size_t _ge_allocated;						// Number of bytes allocated to GE matrix
+	u64 * CAT_RESTRICT _compress_matrix;	// Gaussian elimination compression matrix, stored in row bands
+	int _ge_pitch;							// Words per row of GE matrix
+	uidx * CAT_RESTRICT _pivots;				// Pivots for each column of the GE matrix
+	uidx _pivot_count;						// Number of pivots in the pivot list
+	uidx * CAT_RESTRICT _ge_col_map;			// Map of GE columns to conceptual matrix columns
+	uidx * CAT_RESTRICT _ge_row_map;			// Map of GE rows to conceptual matrix rows
+	uidx _next_pivot;						// Pivot to resume Triangle() on after it fails
+	bool _solve_failed;						// Boolean: The last solve attempt stopped at _next_pivot
 
 	// Heavy rows
 	u8 * CAT_RESTRICT _heavy_matrix;		// Heavy rows of GE matrix
 	int _heavy_pitch;						// Bytes per heavy matrix row
-	u16 _heavy_columns;						// Number of heavy matrix columns
-	u16 _first_heavy_column;				// First heavy column that is non-zero
-	u16 _first_heavy_pivot;					// First heavy pivot in the list
+	uidx _heavy_columns;						// Number of heavy matrix columns
+	uidx _first_heavy_column;				// First heavy column that is non-zero
+	uidx _first_heavy_pivot;					// First heavy pivot in the list
+
+	// Shuffle-2 decks
+	const u16 * CAT_RESTRICT _dense_decks;	// Row and bit decks for each window of dense columns
+	u16 * CAT_RESTRICT _decks_private;		// Deck table built for this object when the shared cache is full
+	size_t _decks_allocated;					// Number of bytes allocated for private deck table
+
+	// Parallelism
+	Executor _executor;						// Runs parallel tasks, or serial if run is 0
+
+	// Repair ring
+	u8 * CAT_RESTRICT _ring_blocks;			// Precomputed blocks, one slot per upcoming repair id
+	u32 _ring_size;							// Number of slots in the ring, or 0 if stopped
+	u32 _ring_first_id;						// Block id of the first ring position
+	volatile u32 _ring_head;				// Number of positions computed so far
+	volatile u32 _ring_tail;				// Number of positions consumed so far
+	volatile u32 _ring_busy;				// Non-zero while a fill task is scheduled or running
+
+	// Concurrent deposits
+	volatile u32 _deposit_next;				// Next input slot to reserve for a deposited block
+	volatile u32 _deposit_count;			// Number of deposited blocks copied into their slots
+	volatile u32 _deposit_lock;				// Non-zero while a thread owns the solver
+	volatile u32 _deposit_result;			// Result published by the thread that ran the solver
+
+	// Asynchronous solve
+	struct QueueSlot;
+	SolvedCallback _solved_callback;		// Called when the background solve finishes, or 0 to solve on the caller
+	void *_solved_context;					// Passed to the callback
+	QueueSlot * CAT_RESTRICT _queue_slots;	// Sequence numbers and ids of queued blocks
+	u8 * CAT_RESTRICT _queue_blocks;		// Blocks received during the background solve
+	u32 _queue_block_bytes;					// Block size the queue was allocated for
+	volatile u32 _queue_head;				// Number of blocks queued so far
+	u32 _queue_tail;						// Number of queued blocks used so far
+
+	// Speculative solve
+	struct ExpectSlot;
+	ExpectSlot * CAT_RESTRICT _expect_slots;	// Hash table of expected block ids and their rows
+	u32 _expect_mask;						// Number of hash table slots minus one
+	uidx _expect_missing;					// Number of expected blocks that have not arrived yet
+	bool _expect_solved;					// Matrix was solved before the expected blocks arrived
+	u8 * CAT_RESTRICT _expect_spare_blocks;	// Spare blocks set aside until the expected rows are done
+	u32 _expect_spare_ids[CAT_MAX_EXPECT_SPARES];	// Ids of the spare blocks that were set aside
+	uidx _expect_spare_count;				// Number of spare ids expected
+	uidx _expect_spares_arrived;				// Number of spare blocks set aside
 
 #if defined(CAT_DUMP_CODEC_DEBUG) || defined(CAT_DUMP_GE_MATRIX)
 	void PrintGEMatrix();
@@ -151,23 +262,32 @@ class CAT_EXPORT Codec
 	//// (1) Peeling
 
 	// Avalanche peeling from the newly solved column to others
-	void PeelAvalanche(u16 column_i);
+	void PeelAvalanche(uidx column_i);
 
 	// Peel a row using the given column
-	void Peel(u16 row_i, PeelRow * CAT_RESTRICT row, u16 column_i);
+	void Peel(uidx row_i, PeelRow * CAT_RESTRICT row, uidx column_i);
 
 	// If a peel reference list overflows at fail_column_i, this function will unreference the row for previous columns
-	void FixPeelFailure(PeelRow * CAT_RESTRICT row, u16 fail_column_i);
+	void FixPeelFailure(PeelRow * CAT_RESTRICT row, uidx fail_column_i);
 
 	// Walk forward through rows and solve as many as possible before deferring any
 	bool OpportunisticPeeling(u32 row_i, u32 id);
 
+	// List the rows of each column again for the encoder, after solving re-purposed the lists
+	void RebuildColumnRefs();
+
 	// Greedy algorithm to select columns to defer and resume peeling until all columns are marked
 	void GreedyPeeling();
 
 
 	//// (2) Compression
 
+	// Measure the word band of each compression matrix row, returning total words
+	u32 SetCompressBands();
+
+	// Add a compression matrix row to a full-width GE row
+	void AddCompressRow(u64 * CAT_RESTRICT ge_row, uidx row_i);
+
 	// Set deferred column bits in compression matrix
 	void SetDeferredColumns();
 
@@ -177,9 +297,15 @@ class CAT_EXPORT Codec
 	// Diagonalize the peeling matrix, generating compression matrix
 	void PeelDiagonal();
 
+	// Generate the peeled row values that go with PeelDiagonal()
+	void PeelDiagonalValues();
+
 	// Copy deferred rows from the compress matrix to the GE matrix
 	void CopyDeferredRows();
 
+	// Look up or generate the Shuffle-2 decks for the dense rows
+	bool SetDenseDecks();
+
 	// Multiply dense rows by peeling matrix to generate GE rows, but no row values yet
 	void MultiplyDenseRows();
 
@@ -207,36 +333,151 @@ class CAT_EXPORT Codec
 	// Multiply diagonalized peeling column values into dense rows
 	void MultiplyDenseValues();
 
-	// Add values for GE matrix positions under the diagonal
-	void AddSubdiagonalValues();
+	// Add values for GE matrix positions under the diagonal, for a byte range of each block
+	void AddSubdiagonalValues(u32 offset, u32 bytes);
+
+	// Add subdiagonal values for one byte range
+	static void AddSubdiagonalTask(void *job, int index);
 
 
 	//// (4) Substitution
 
-	// Back-substitute to diagonalize the GE matrix
-	void BackSubstituteAboveDiagonal();
+	// Back-substitute to diagonalize the GE matrix, for a byte range of each block
+	void BackSubstituteAboveDiagonal(u32 offset, u32 bytes);
+
+	// Back-substitute one byte range
+	static void BackSubstituteTask(void *job, int index);
+
+	// Regenerate a sparse peeled row to solve its column
+	void SubstituteRow(uidx row_i);
 
 	// Regenerate all of the sparse peeled rows to diagonalize them
 	void Substitute();
 
+	// Substitute a range of rows within one level of the peeling order
+	static void SubstituteTask(void *job, int index);
+
+
+	//// Parallelism
+
+	// Range of rows for tasks to process
+	struct RowJob;
+
+	// Number of rows of block operations to assign to each task
+	u32 RowsPerTask(u32 row_count);
+
+	// Run tasks on the executor, or serially if there is no executor
+	void RunTasks(TaskFunction task, void *job, int count, u32 task_bytes);
+
+	// Split the rows of a job between tasks and run them
+	void RunRowTasks(TaskFunction task, RowJob *job);
+
+	// Byte range of each block for tasks to process
+	struct SliceJob;
+
+	// Split the bytes of each block between tasks and run them
+	void RunSliceTasks(TaskFunction task, SliceJob *job, u32 row_ops);
+
 
 	//// Main Driver
 
 	// Choose matrix to use based on message bytes
-	Result ChooseMatrix(int message_bytes, int block_bytes);
+	Result ChooseMatrix(u64 message_bytes, int block_bytes);
 
 	// Solve matrix so that recovery blocks can be generated
 	Result SolveMatrix();
 
+	// Solve matrix for the original rows only
+	Result SolveOriginalRows();
+
+	// Find a peel seed that solves the original rows, past the seed tables
+	Result FindPeelSeed();
+
 	// Resume solver with a new block
 	Result ResumeSolveMatrix(u32 id, const void * CAT_RESTRICT block);
 
 #if defined(CAT_ALL_ORIGINAL)
 	// Verify that all data is from the original N, meaning no computations are needed
 	bool IsAllOriginalData();
+
+	// Copy bytes [offset, offset + bytes) of the message from received original blocks, if no recovery blocks were generated
+	bool CopyOriginalRange(u64 offset, u64 bytes, u8 * CAT_RESTRICT dest) const;
 #endif
 
 
+	//// Reconstruction
+
+	// Regenerate part of an original block from the same part of the recovery blocks
+	void RegenerateRange(uidx row_i, u32 offset, u32 bytes, u8 * CAT_RESTRICT dest);
+
+	// Regenerate an original block from the recovery blocks
+	void RegenerateRow(uidx row_i, u8 * CAT_RESTRICT dest);
+
+	// Regenerate a range of lost rows into the output
+	static void RegenerateTask(void *job, int index);
+
+
+	//// Speculative Solve
+
+	// Add an expected block id with its reserved row, or LIST_TERM for a spare
+	void InsertExpected(u32 id, uidx row_i);
+
+	// Look up an expected block id, or return 0 if it was not expected
+	ExpectSlot *FindExpected(u32 id);
+
+	// Solve the matrix before some of the expected blocks have arrived
+	Result SolveExpected();
+
+	// Store the data for an expected block and finish if it was the last one
+	Result FillExpected(ExpectSlot *slot, const void * CAT_RESTRICT block_in);
+
+	// Drop the rows of expected blocks that have not arrived and feed the spares
+	Result AbandonExpected();
+
+	// Feed the spare blocks that were set aside to the decoder
+	Result FeedSpares();
+
+	// Clear speculative solve state for a new message
+	void ResetExpected();
+
+	void FreeExpected();
+
+
+	//// Concurrent Deposits
+
+	// Clear deposit state for a new message
+	void ResetDeposits();
+
+	// Peel all of the deposited rows in slot order and then solve
+	Result PeelDeposits();
+
+
+	//// Asynchronous Solve
+
+	// Copy a block into the queue, or return false if it is full
+	bool EnqueueBlock(u32 id, const void * CAT_RESTRICT block_in);
+
+	// Peel the deposits if asked, then feed queued blocks to the decoder until it is done or the queue is empty
+	void FinishAsyncSolve(bool peel);
+
+	// Peel the deposited rows and solve on a worker
+	static void PeelDepositsTask(void *job, int index);
+
+	// Feed queued blocks to the decoder on a worker
+	static void ResumeDepositsTask(void *job, int index);
+
+	void FreeSolveQueue();
+
+
+	//// Repair Ring
+
+	// Start a background fill task if the ring is running low
+	void ScheduleRepairFill();
+
+	// Fill the ring until it is full or stopped
+	static void RepairFillTask(void *job, int index);
+
+
 	//// Memory Management
 
 	void SetInput(const void * CAT_RESTRICT message_in);
@@ -247,8 +488,13 @@ class CAT_EXPORT Codec
 	void FreeMatrix();
 
 	bool AllocateWorkspace();
+	void ClearPeelColumns();
+	void FreeRecoveryBlocks();
+	void FreePeelWorkspace();
 	void FreeWorkspace();
 
+	void FreeDecks();
+
 public:
 	Codec();
 	~Codec();
@@ -256,31 +502,89 @@ public:
 
 	//// Accessors
 
-	CAT_INLINE u32 PSeed() { return _p_seed; }
-	CAT_INLINE u32 CSeed() { return _d_seed; }
-	CAT_INLINE u32 BlockCount() { return _block_count; }
+	CAT_INLINE u32 PSeed() const { return _p_seed; }
+	CAT_INLINE u32 CSeed() const { return _d_seed; }
+	CAT_INLINE u32 BlockCount() const { return _block_count; }
+	CAT_INLINE size_t AllocatedBytes() { return _recovery_allocated + _workspace_allocated + _ge_allocated + _input_allocated + _decks_allocated; }
+
+
+	//// Parallelism
+
+	// Set executor for parallel work, or 0 to run serially
+	void SetExecutor(const Executor *executor);
 
 
 	//// Encoder Mode
 
 	// Initialize encoder mode
-	Result InitializeEncoder(int message_bytes, int block_bytes);
+	Result InitializeEncoder(u64 message_bytes, int block_bytes);
 
 	// Feed encoder a message
 	Result EncodeFeed(const void * CAT_RESTRICT message_in);
 
-	// Encode a block, returning number of bytes written
-	u32 Encode(u32 id, void * CAT_RESTRICT block_out);
+	// Replace some blocks of the message and generate the recovery blocks again, reusing the solution
+	Result UpdateBlocks(const u32 * CAT_RESTRICT ids, const void * const * CAT_RESTRICT blocks, u32 count);
+
+	// Release memory that is only needed while encoding the message
+	Result TrimEncoder();
+
+	// Exchange the memory only needed while solving with another object
+	void SwapSolverMemory(Codec &other);
+
+	// Encode a block, returning number of bytes written (safe to call from several threads)
+	u32 Encode(u32 id, void * CAT_RESTRICT block_out) const;
+
+
+	//// Repair Ring
+
+	// Precompute count repair blocks ahead starting from first_id, or stop if count is 0
+	Result StartRepairRing(u32 first_id, u32 count);
+
+	// Compute blocks into the free ring slots on the calling thread
+	void FillRepairRing();
+
+	// Wait for background fill tasks and free the ring
+	void StopRepairRing();
+
+	// Copy out a precomputed block, or return false if the id is not ready (safe to call from several threads)
+	bool ReadRepairRing(u32 id, void * CAT_RESTRICT block_out);
+
+	// Next precomputed block and its id, or 0 if it is not ready yet (one consumer thread only)
+	const u8 *PeekRepairRing(u32 &id);
+
+	// Release the block returned by PeekRepairRing()
+	void PopRepairRing();
 
 
 	//// Decoder Mode
 
 	// Initialize decoder mode
-	Result InitializeDecoder(int message_bytes, int block_bytes);
+	Result InitializeDecoder(u64 message_bytes, int block_bytes);
+
+	// Start decoding a new message of the same size, keeping parameters and memory
+	Result ResetDecoder();
 
 	// Feed decoder a block
 	Result DecodeFeed(u32 id, const void * CAT_RESTRICT block_in);
 
+	// Feed decoder the original blocks marked in a bitmap from a copy of the message
+	Result SeedKnown(const u8 * CAT_RESTRICT bitmap, const void * CAT_RESTRICT message_in);
+
+	// Number of blocks still needed: N minus the stored rows before N, or the missing pivots after a solve fails
+	u32 BlocksNeeded() const;
+
+	// Solve for the rows of blocks that are expected to arrive, before their data
+	Result ExpectBlocks(const u32 * CAT_RESTRICT ids, u32 count);
+
+	// Feed decoder a block (safe to call from several threads, but not mixed with DecodeFeed)
+	Result DepositBlock(u32 id, const void * CAT_RESTRICT block_in);
+
+	// Solve on a worker when deposits are complete and call back when done
+	Result StartAsyncSolve(SolvedCallback callback, void *context);
+
+	// Wait for a background solve to finish
+	void StopAsyncSolve();
+
 	// Use matrix solution to generate recovery blocks
 	void GenerateRecoveryBlocks();
 
@@ -288,7 +592,13 @@ public:
 	Result ReconstructOutput(void * CAT_RESTRICT message_out);
 
 	// Reconstruct a single original block from the recovery blocks
-	Result ReconstructBlock(u16 id, void * CAT_RESTRICT block_out);
+	Result ReconstructBlock(uidx id, void * CAT_RESTRICT block_out);
+
+	// Reconstruct bytes [offset, offset + bytes) of an original block
+	Result ReconstructRange(uidx id, u32 offset, u32 bytes, void * CAT_RESTRICT out);
+
+	// Reconstruct bytes [offset, offset + bytes) of the message
+	Result ReconstructMessageRange(u64 offset, u64 bytes, void * CAT_RESTRICT out);
 };
 
 
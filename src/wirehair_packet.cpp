@@ -0,0 +1,382 @@
+/*
+	Copyright (c) 2012-2014 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of WirehairFEC nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "wirehair_packet.hpp"
+#include <string.h>
+using namespace cat;
+using namespace wirehair;
+
+
+//// PacketCodec
+
+PacketCodec::PacketCodec()
+{
+	_packet_count = 0;
+	_table_bytes = 0;
+	_table_blocks = 0;
+	_packed_offset = 0;
+	_message_bytes = 0;
+	_block_bytes = 0;
+	_message = 0;
+	_offsets = 0;
+	_lengths = 0;
+	_block_known = 0;
+	_received = 0;
+}
+
+PacketCodec::~PacketCodec()
+{
+	Free();
+}
+
+void PacketCodec::SetExecutor(const Executor *executor)
+{
+	_codec.SetExecutor(executor);
+}
+
+Result PacketCodec::Allocate(u32 packet_count, u32 message_bytes, u32 block_bytes, bool decoder)
+{
+	Free();
+
+	_packet_count = packet_count;
+	_table_bytes = packet_count * 2;
+	_table_blocks = (_table_bytes + block_bytes - 1) / block_bytes;
+	_packed_offset = _table_blocks * block_bytes;
+	_message_bytes = message_bytes;
+	_block_bytes = block_bytes;
+
+	_message = new u8[message_bytes];
+	_offsets = new u32[packet_count];
+	_lengths = new u32[packet_count];
+	if (!_message || !_offsets || !_lengths)
+	{
+		Free();
+		return R_OUT_OF_MEMORY;
+	}
+
+	if (decoder)
+	{
+		const u32 block_count = (message_bytes + block_bytes - 1) / block_bytes;
+
+		_block_known = new u32[block_count];
+		_received = new u8[packet_count];
+		if (!_block_known || !_received)
+		{
+			Free();
+			return R_OUT_OF_MEMORY;
+		}
+
+		memset(_block_known, 0, block_count * sizeof(u32));
+		memset(_received, 0, packet_count);
+	}
+
+	_received_count = 0;
+	_table_received = 0;
+	_solved = false;
+	_table_known = false;
+
+	return R_WIN;
+}
+
+void PacketCodec::Free()
+{
+	if (_message)
+	{
+		delete []_message;
+		_message = 0;
+	}
+	if (_offsets)
+	{
+		delete []_offsets;
+		_offsets = 0;
+	}
+	if (_lengths)
+	{
+		delete []_lengths;
+		_lengths = 0;
+	}
+	if (_block_known)
+	{
+		delete []_block_known;
+		_block_known = 0;
+	}
+	if (_received)
+	{
+		delete []_received;
+		_received = 0;
+	}
+}
+
+
+//// Encoder Mode
+
+Result PacketCodec::EncodePackets(const void * const * CAT_RESTRICT packets, const u32 * CAT_RESTRICT lengths,
+	u32 packet_count, u32 block_bytes)
+{
+	if CAT_UNLIKELY(!packets || !lengths || packet_count < 1 || block_bytes < 1)
+		return R_BAD_INPUT;
+
+	// Add up the message size, which must still fit in 32 bits
+	u64 message_bytes = (packet_count * (u64)2 + block_bytes - 1) / block_bytes * block_bytes;
+	for (u32 ii = 0; ii < packet_count; ++ii)
+	{
+		if CAT_UNLIKELY(lengths[ii] > CAT_PACKET_MAX_BYTES || (lengths[ii] > 0 && !packets[ii]))
+			return R_BAD_INPUT;
+
+		message_bytes += lengths[ii];
+	}
+
+	if CAT_UNLIKELY(message_bytes > 0xffffffff)
+		return R_TOO_LARGE;
+
+	Result r = Allocate(packet_count, (u32)message_bytes, block_bytes, false);
+	if (r) return r;
+
+	// Write the length table padded out to whole blocks, then pack the packets after it
+	u8 * CAT_RESTRICT table = _message;
+	memset(table + _table_bytes, 0, _packed_offset - _table_bytes);
+	u32 offset = _packed_offset;
+	for (u32 ii = 0; ii < packet_count; ++ii)
+	{
+		const u32 bytes = lengths[ii];
+
+		table[ii * 2] = (u8)bytes;
+		table[ii * 2 + 1] = (u8)(bytes >> 8);
+
+		memcpy(_message + offset, packets[ii], bytes);
+		_offsets[ii] = offset;
+		_lengths[ii] = bytes;
+		offset += bytes;
+	}
+
+	r = _codec.InitializeEncoder(_message_bytes, block_bytes);
+	if (r) return r;
+
+	return _codec.EncodeFeed(_message);
+}
+
+u32 PacketCodec::WriteTable(u32 table_i, void * CAT_RESTRICT packet_out) const
+{
+	if CAT_UNLIKELY(table_i >= _table_blocks || !packet_out)
+		return 0;
+
+	// Only the table itself is sent, and the padding after it is implied
+	const u32 bytes = TablePacketBytes(table_i);
+
+	memcpy(packet_out, _message + table_i * _block_bytes, bytes);
+
+	return bytes;
+}
+
+u32 PacketCodec::Repair(u32 index, void * CAT_RESTRICT block_out) const
+{
+	// Repair blocks follow the N original blocks of the message
+	return _codec.Encode(_codec.BlockCount() + index, block_out);
+}
+
+
+//// Decoder Mode
+
+Result PacketCodec::InitializeDecoder(u32 message_bytes, u32 packet_count, u32 block_bytes)
+{
+	if CAT_UNLIKELY(packet_count < 1 || block_bytes < 1 ||
+					message_bytes < (packet_count * (u64)2 + block_bytes - 1) / block_bytes * block_bytes)
+		return R_BAD_INPUT;
+
+	Result r = Allocate(packet_count, message_bytes, block_bytes, true);
+	if (r) return r;
+
+	return _codec.InitializeDecoder(message_bytes, block_bytes);
+}
+
+Result PacketCodec::ReadPacket(u32 packet_i, u32 offset, const void * CAT_RESTRICT packet, u32 bytes)
+{
+	// Packets live after the table and inside the message
+	if CAT_UNLIKELY(packet_i >= _packet_count || offset < _packed_offset ||
+					offset > _message_bytes || bytes > _message_bytes - offset ||
+					(bytes > 0 && !packet))
+		return R_BAD_INPUT;
+
+	if (!_received[packet_i])
+	{
+		_received[packet_i] = 1;
+		++_received_count;
+
+		_offsets[packet_i] = offset;
+		_lengths[packet_i] = bytes;
+
+		if (bytes > 0)
+		{
+			memcpy(_message + offset, packet, bytes);
+
+			// Feed each block to the Codec once all of its bytes have arrived
+			const u32 last = offset + bytes - 1;
+			for (u32 block_i = offset / _block_bytes; block_i <= last / _block_bytes; ++block_i)
+			{
+				const u32 block_start = block_i * _block_bytes;
+				const u32 block_size = BlockSize(block_i);
+				const u32 start = offset > block_start ? offset : block_start;
+				const u32 end = last < block_start + block_size - 1 ? last : block_start + block_size - 1;
+
+				const u32 known = _block_known[block_i];
+				_block_known[block_i] = known + (end - start + 1);
+
+				if (known < block_size && _block_known[block_i] >= block_size)
+				{
+					Result r = FeedBlock(block_i);
+					if (r) return r;
+				}
+			}
+		}
+	}
+
+	return (_solved || _received_count >= _packet_count) ? R_WIN : R_MORE_BLOCKS;
+}
+
+Result PacketCodec::ReadTable(u32 table_i, const void * CAT_RESTRICT packet, u32 bytes)
+{
+	if CAT_UNLIKELY(table_i >= _table_blocks || !packet || bytes != TablePacketBytes(table_i))
+		return R_BAD_INPUT;
+
+	const u32 block_size = BlockSize(table_i);
+
+	if (_block_known[table_i] < block_size)
+	{
+		u8 * CAT_RESTRICT block = _message + table_i * _block_bytes;
+
+		// Fill in the padding after the table, which is not sent
+		memcpy(block, packet, bytes);
+		memset(block + bytes, 0, block_size - bytes);
+		_block_known[table_i] = block_size;
+
+		Result r = FeedBlock(table_i);
+		if (r) return r;
+
+		// Once the whole table is in, the offsets of lost packets are known without solving
+		if (++_table_received >= _table_blocks)
+			ParseTable();
+	}
+
+	return (_solved || _received_count >= _packet_count) ? R_WIN : R_MORE_BLOCKS;
+}
+
+Result PacketCodec::FeedBlock(u32 block_i)
+{
+	if (_solved)
+		return R_WIN;
+
+	Result r = _codec.DecodeFeed(block_i, _message + block_i * _block_bytes);
+
+	if (r == R_WIN)
+		_solved = true;
+	else if (r != R_MORE_BLOCKS)
+		return r;
+
+	return R_WIN;
+}
+
+Result PacketCodec::ReadRepair(u32 index, const void * CAT_RESTRICT block)
+{
+	if CAT_UNLIKELY(!block)
+		return R_BAD_INPUT;
+
+	if (!_solved && _received_count < _packet_count)
+	{
+		Result r = _codec.DecodeFeed(_codec.BlockCount() + index, block);
+
+		if (r == R_WIN)
+			_solved = true;
+		else if (r != R_MORE_BLOCKS)
+			return r;
+	}
+
+	return (_solved || _received_count >= _packet_count) ? R_WIN : R_MORE_BLOCKS;
+}
+
+void PacketCodec::RegenerateRange(u32 offset, u32 bytes)
+{
+	if (bytes < 1) return;
+
+	const u32 last = offset + bytes - 1;
+	for (u32 block_i = offset / _block_bytes; block_i <= last / _block_bytes; ++block_i)
+	{
+		const u32 block_size = BlockSize(block_i);
+
+		// Blocks that were fed to the Codec, or regenerated before, are already in the message
+		if (_block_known[block_i] < block_size)
+		{
+			_codec.ReconstructBlock(block_i, _message + block_i * _block_bytes);
+			_block_known[block_i] = block_size;
+		}
+	}
+}
+
+void PacketCodec::ParseTable()
+{
+	RegenerateRange(0, _table_bytes);
+
+	const u8 * CAT_RESTRICT table = _message;
+	u32 offset = _packed_offset;
+	for (u32 ii = 0; ii < _packet_count; ++ii)
+	{
+		const u32 bytes = table[ii * 2] | ((u32)table[ii * 2 + 1] << 8);
+
+		_offsets[ii] = offset;
+		_lengths[ii] = bytes;
+		offset += bytes;
+	}
+
+	_table_known = true;
+}
+
+Result PacketCodec::Recover(u32 packet_i, void * CAT_RESTRICT packet_out, u32 &bytes)
+{
+	if CAT_UNLIKELY(packet_i >= _packet_count || !packet_out)
+		return R_BAD_INPUT;
+
+	if (!_received[packet_i])
+	{
+		if (!_solved)
+			return R_MORE_BLOCKS;
+
+		// Find the lost packet from the table, and regenerate only the blocks it covers
+		if (!_table_known)
+			ParseTable();
+
+		if CAT_UNLIKELY(_offsets[packet_i] > _message_bytes ||
+						_lengths[packet_i] > _message_bytes - _offsets[packet_i])
+			return R_ERROR;
+
+		RegenerateRange(_offsets[packet_i], _lengths[packet_i]);
+	}
+
+	bytes = _lengths[packet_i];
+	memcpy(packet_out, _message + _offsets[packet_i], bytes);
+
+	return R_WIN;
+}
@@ -0,0 +1,173 @@
+/*
+	Copyright (c) 2012-2014 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of WirehairFEC nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_WIREHAIR_PACKET_HPP
+#define CAT_WIREHAIR_PACKET_HPP
+
+#ifdef WIREHAIR_GF_W16
+#include "wirehair_codec_16.hpp"
+#else
+#include "wirehair_codec_8.hpp"
+#endif
+
+// Limits:
+#define CAT_PACKET_MAX_BYTES 65535 /* Largest packet, so each length fits in 16 bits of the table */
+
+/*
+	Variable-length packet codec
+
+		A burst of datagrams of different sizes is packed into one
+	message for the Codec without padding between them: a table of 16-bit
+	lengths, padded out to whole blocks, followed by the packets back to
+	back.  The packets are sent as they are, each with its offset in the
+	message, and the table is sent as one or more table packets of up to
+	block_bytes that only carry its two bytes per packet.  Only repair
+	blocks are sent in block_bytes.
+
+		The decoder copies each received packet to its offset, and feeds
+	every original block of the message to the Codec as soon as all of its
+	bytes have arrived.  Each table packet is its own original block, so a
+	received table costs no repair.  Blocks that straddle a lost packet
+	and the table blocks that were lost are what the repair blocks make up
+	for.  Once the Codec is solved, the table is regenerated if needed to
+	find the lost packets, and then only the blocks that overlap each lost
+	packet are regenerated.
+*/
+
+namespace cat {
+
+namespace wirehair {
+
+
+//// Variable-Length Packet Encoder/Decoder
+
+class CAT_EXPORT PacketCodec
+{
+	// Parameters
+	u32 _packet_count;					// Number of packets P
+	u32 _table_bytes;					// Bytes in the length table at the start of the message
+	u32 _table_blocks;					// Number of blocks the table is padded out to
+	u32 _packed_offset;					// Offset of the first packet, after the table blocks
+	u32 _message_bytes;					// Bytes in the table and packets
+	u32 _block_bytes;					// Number of bytes in a block
+	Codec _codec;						// Codes the packed message
+
+	// Message
+	u8 * CAT_RESTRICT _message;			// Table followed by the packets, without padding
+	u32 * CAT_RESTRICT _offsets;		// Offset of each packet in the message, once known
+	u32 * CAT_RESTRICT _lengths;		// Length of each packet, once known
+
+	// Decoder
+	u32 * CAT_RESTRICT _block_known;	// Bytes of each original block that are known
+	u8 * CAT_RESTRICT _received;		// Has each packet been received?
+	u32 _received_count;				// Number of packets received
+	u32 _table_received;				// Number of table packets received
+	bool _solved;						// Has the Codec been solved?
+	bool _table_known;					// Have the offsets and lengths of the packets been read from the table?
+
+	// Allocate buffers for the packets and message
+	Result Allocate(u32 packet_count, u32 message_bytes, u32 block_bytes, bool decoder);
+
+	void Free();
+
+	// Number of bytes in an original block of the message
+	CAT_INLINE u32 BlockSize(u32 block_i) const
+	{
+		const u32 offset = block_i * _block_bytes;
+		return _message_bytes - offset < _block_bytes ? _message_bytes - offset : _block_bytes;
+	}
+
+	// Regenerate the original blocks that overlap bytes [offset, offset + bytes) and are not known
+	void RegenerateRange(u32 offset, u32 bytes);
+
+	// Number of bytes of the table in a table packet
+	CAT_INLINE u32 TablePacketBytes(u32 table_i) const
+	{
+		const u32 offset = table_i * _block_bytes;
+		return _table_bytes - offset < _block_bytes ? _table_bytes - offset : _block_bytes;
+	}
+
+	// Feed an original block to the Codec unless it is already solved, returning R_WIN unless it fails
+	Result FeedBlock(u32 block_i);
+
+	// Regenerate the length table if needed and find the offsets of the packets
+	void ParseTable();
+
+public:
+	PacketCodec();
+	~PacketCodec();
+
+	CAT_INLINE u32 PacketCount() const { return _packet_count; }
+	CAT_INLINE u32 MessageBytes() const { return _message_bytes; }
+	CAT_INLINE u32 BlockBytes() const { return _block_bytes; }
+	CAT_INLINE u32 TableCount() const { return _table_blocks; }
+
+	// Set executor for the Codec, or 0 to run serially
+	void SetExecutor(const Executor *executor);
+
+
+	//// Encoder Mode
+
+	// Pack the packets into a message and encode it
+	Result EncodePackets(const void * const * CAT_RESTRICT packets, const u32 * CAT_RESTRICT lengths,
+		u32 packet_count, u32 block_bytes);
+
+	// Offset of a packet in the message, which is sent with it
+	CAT_INLINE u32 Offset(u32 packet_i) const { return _offsets[packet_i]; }
+
+	// Write a table packet, returning number of bytes written
+	u32 WriteTable(u32 table_i, void * CAT_RESTRICT packet_out) const;
+
+	// Write a repair block, returning number of bytes written (safe to call from several threads)
+	u32 Repair(u32 index, void * CAT_RESTRICT block_out) const;
+
+
+	//// Decoder Mode
+
+	// Initialize decoder mode
+	Result InitializeDecoder(u32 message_bytes, u32 packet_count, u32 block_bytes);
+
+	// Feed decoder a received packet, returning R_WIN when every packet can be recovered
+	Result ReadPacket(u32 packet_i, u32 offset, const void * CAT_RESTRICT packet, u32 bytes);
+
+	// Feed decoder a table packet, returning R_WIN when every packet can be recovered
+	Result ReadTable(u32 table_i, const void * CAT_RESTRICT packet, u32 bytes);
+
+	// Feed decoder a repair block, returning R_WIN when every packet can be recovered
+	Result ReadRepair(u32 index, const void * CAT_RESTRICT block);
+
+	// Copy out a packet, received or recovered, and its length
+	Result Recover(u32 packet_i, void * CAT_RESTRICT packet_out, u32 &bytes);
+};
+
+
+} // namespace wirehair
+
+} // namespace cat
+
+#endif // CAT_WIREHAIR_PACKET_HPP
@@ -0,0 +1,364 @@
+/*
+	Copyright (c) 2012-2014 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of WirehairFEC nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "wirehair_segment.hpp"
+#include "wirehair_atomic.hpp"
+using namespace cat;
+using namespace wirehair;
+
+
+//// Data Structures
+
+struct SegmentedCodec::SegmentJob
+{
+	SegmentedCodec *codec;
+	const Executor *inner;		// Executor for each segment, if the segments are not split between workers
+	volatile u32 next;			// Number of segments claimed so far
+	volatile u32 failures;		// Number of segments that failed
+
+	// Decoder only
+	const u32 *ids;				// Received block ids
+	const void * const *blocks;	// Received block data
+	const u32 *starts;			// First entry in order for each segment, and one past the end
+	const u32 *order;			// Received blocks sorted by segment
+	u8 *object_out;				// Reconstructed object
+};
+
+
+//// Segment Layout
+
+SegmentedCodec::SegmentedCodec()
+{
+	_block_count = 0;
+	_segment_count = 0;
+	_encoders = 0;
+	_object = 0;
+
+	// Run tasks serially
+	SetExecutor(0);
+}
+
+SegmentedCodec::~SegmentedCodec()
+{
+	FreeEncoders();
+}
+
+void SegmentedCodec::SetExecutor(const Executor *executor)
+{
+	if (executor)
+	{
+		_executor = *executor;
+		if (_executor.worker_count < 1)
+			_executor.worker_count = 1;
+	}
+	else
+	{
+		_executor.context = 0;
+		_executor.worker_count = 1;
+		_executor.run = 0;
+		_executor.start = 0;
+		_executor.finish = 0;
+	}
+}
+
+/*
+	ChooseSegments
+
+		This function picks the fewest segments that keep every segment
+	within the limits of one Codec, both in blocks and in bytes, and then
+	balances the blocks between them.  The leading segments take one
+	extra block each when the blocks do not divide evenly, and the final
+	partial block of the object ends up in the last segment.
+*/
+
+Result SegmentedCodec::ChooseSegments(u64 object_bytes, u32 block_bytes)
+{
+	if (object_bytes < 1 || block_bytes < 1)
+		return R_BAD_INPUT;
+
+	u64 block_count = (object_bytes + block_bytes - 1) / block_bytes;
+	if (block_count < CAT_WIREHAIR_MIN_N)
+		return R_TOO_SMALL;
+	if (block_count > 0xffffffff)
+		return R_TOO_LARGE;
+
+	// Largest segment, which can exceed 4 GB since the codec takes 64-bit message sizes
+	const u32 max_blocks = CAT_SEGMENT_MAX_N;
+
+	u32 segment_count = (u32)((block_count + max_blocks - 1) / max_blocks);
+
+	_object_bytes = object_bytes;
+	_block_bytes = block_bytes;
+	_block_count = (u32)block_count;
+	_segment_count = segment_count;
+	_segment_blocks = _block_count / segment_count;
+	_long_segments = _block_count % segment_count;
+
+	return R_WIN;
+}
+
+u64 SegmentedCodec::SegmentOffset(u32 segment_i) const
+{
+	// Leading segments are one block longer
+	u32 extra = segment_i < _long_segments ? segment_i : _long_segments;
+
+	return ((u64)segment_i * _segment_blocks + extra) * _block_bytes;
+}
+
+u64 SegmentedCodec::SegmentBytes(u32 segment_i) const
+{
+	// The last segment holds the final partial block
+	if (segment_i == _segment_count - 1)
+		return _object_bytes - SegmentOffset(segment_i);
+
+	return (u64)SegmentBlocks(segment_i) * _block_bytes;
+}
+
+u64 SegmentedCodec::BlockOffset(u32 id) const
+{
+	// Original id i is block i / S of segment i % S
+	return SegmentOffset(id % _segment_count) + (u64)(id / _segment_count) * _block_bytes;
+}
+
+
+//// Parallelism
+
+/*
+	RunSegmentTasks
+
+		Like wirehair_encode_many(), one task is started per worker and
+	each task keeps claiming the next segment until none are left.  The
+	codec of each segment only gets the executor itself when there is a
+	single task, so that small objects still split their row operations.
+*/
+
+void SegmentedCodec::RunSegmentTasks(TaskFunction task, SegmentJob *job)
+{
+	u32 task_count = _executor.run ? (u32)_executor.worker_count : 1;
+	if (task_count > _segment_count)
+		task_count = _segment_count;
+
+	job->codec = this;
+	job->next = 0;
+	job->failures = 0;
+
+	if (task_count > 1)
+	{
+		job->inner = 0;
+
+		// Each task handles about an equal share of the object
+		u64 task_bytes = _object_bytes / task_count;
+		if (task_bytes > 0xffffffff)
+			task_bytes = 0xffffffff;
+
+		_executor.run(_executor.context, task, job, task_count, (u32)task_bytes);
+	}
+	else
+	{
+		job->inner = _executor.run ? &_executor : 0;
+
+		task(job, 0);
+	}
+}
+
+
+//// Encoder
+
+Result SegmentedCodec::EncodeObject(const void *object, u64 object_bytes, u32 block_bytes)
+{
+	if (!object)
+		return R_BAD_INPUT;
+
+	u32 old_count = _segment_count;
+
+	Result r = ChooseSegments(object_bytes, block_bytes);
+	if (r) return r;
+
+	// If the number of segments changed, allocate new encoders
+	if (!_encoders || old_count != _segment_count)
+	{
+		FreeEncoders();
+
+		_encoders = new Codec[_segment_count];
+		if (!_encoders) return R_OUT_OF_MEMORY;
+	}
+
+	_object = reinterpret_cast<const u8 *>( object );
+
+	SegmentJob job;
+	RunSegmentTasks(&SegmentedCodec::EncodeTask, &job);
+
+	return job.failures ? R_BAD_INPUT : R_WIN;
+}
+
+void SegmentedCodec::EncodeTask(void *job, int /*index*/)
+{
+	SegmentJob *sj = reinterpret_cast<SegmentJob *>( job );
+	SegmentedCodec *codec = sj->codec;
+
+	for (;;)
+	{
+		// Claim next segment
+		u32 segment_i = AtomicAdd(&sj->next, 1) - 1;
+		if (segment_i >= codec->_segment_count)
+			break;
+
+		Codec *encoder = &codec->_encoders[segment_i];
+		encoder->SetExecutor(sj->inner);
+
+		Result r = encoder->InitializeEncoder(codec->SegmentBytes(segment_i), codec->_block_bytes);
+
+		if (!r)
+			r = encoder->EncodeFeed(codec->_object + codec->SegmentOffset(segment_i));
+
+		// Keep only the recovery blocks, since every segment stays around
+		if (!r)
+			r = encoder->TrimEncoder();
+
+		if (r)
+			AtomicAdd(&sj->failures, 1);
+	}
+}
+
+u32 SegmentedCodec::Encode(u32 id, void * CAT_RESTRICT block_out) const
+{
+	if (!_encoders) return 0;
+
+	// Map interleaved id to its segment
+	return _encoders[id % _segment_count].Encode(id / _segment_count, block_out);
+}
+
+void SegmentedCodec::FreeEncoders()
+{
+	delete []_encoders;
+	_encoders = 0;
+}
+
+
+//// Decoder
+
+/*
+	DecodeObject
+
+		This function sorts the received blocks by segment, and then
+	decodes each segment straight from the caller's buffers into its
+	part of the object.  Each worker reuses one decoder for all of the
+	segments it claims.  If any segment did not get enough blocks it
+	returns R_MORE_BLOCKS, and the call can be repeated with more.
+*/
+
+Result SegmentedCodec::DecodeObject(u64 object_bytes, u32 block_bytes, const u32 * CAT_RESTRICT ids,
+	const void * const * CAT_RESTRICT blocks, u32 count, void * CAT_RESTRICT object_out)
+{
+	if (!ids || !blocks || !object_out)
+		return R_BAD_INPUT;
+
+	Result r = ChooseSegments(object_bytes, block_bytes);
+	if (r) return r;
+
+	// Not enough blocks even without losses
+	if (count < _block_count)
+		return R_MORE_BLOCKS;
+
+	u32 segment_count = _segment_count;
+	u32 *starts = new u32[segment_count + 1 + count];
+	if (!starts) return R_OUT_OF_MEMORY;
+	u32 *order = starts + segment_count + 1;
+
+	// Count the blocks for each segment
+	for (u32 ii = 0; ii <= segment_count; ++ii)
+		starts[ii] = 0;
+	for (u32 ii = 0; ii < count; ++ii)
+		++starts[ids[ii] % segment_count + 1];
+
+	// Convert counts to the first entry for each segment
+	for (u32 ii = 1; ii <= segment_count; ++ii)
+		starts[ii] += starts[ii - 1];
+
+	// Sort block indices by segment, keeping the order they were received in
+	for (u32 ii = 0; ii < count; ++ii)
+		order[starts[ids[ii] % segment_count]++] = ii;
+
+	// Shift the ends back to the starts
+	for (u32 ii = segment_count; ii > 0; --ii)
+		starts[ii] = starts[ii - 1];
+	starts[0] = 0;
+
+	SegmentJob job;
+	job.ids = ids;
+	job.blocks = blocks;
+	job.starts = starts;
+	job.order = order;
+	job.object_out = reinterpret_cast<u8 *>( object_out );
+
+	RunSegmentTasks(&SegmentedCodec::DecodeTask, &job);
+
+	delete []starts;
+
+	return job.failures ? R_MORE_BLOCKS : R_WIN;
+}
+
+void SegmentedCodec::DecodeTask(void *job, int /*index*/)
+{
+	SegmentJob *sj = reinterpret_cast<SegmentJob *>( job );
+	SegmentedCodec *codec = sj->codec;
+	const u32 segment_count = codec->_segment_count;
+
+	Codec decoder;
+	decoder.SetExecutor(sj->inner);
+
+	for (;;)
+	{
+		// Claim next segment
+		u32 segment_i = AtomicAdd(&sj->next, 1) - 1;
+		if (segment_i >= segment_count)
+			break;
+
+		Result r = decoder.InitializeDecoder(codec->SegmentBytes(segment_i), codec->_block_bytes);
+
+		// Feed the blocks for this segment until it is decoded
+		if (!r)
+		{
+			r = R_MORE_BLOCKS;
+
+			for (u32 ii = sj->starts[segment_i]; r == R_MORE_BLOCKS && ii < sj->starts[segment_i + 1]; ++ii)
+			{
+				u32 block_i = sj->order[ii];
+
+				r = decoder.DecodeFeed(sj->ids[block_i] / segment_count, sj->blocks[block_i]);
+			}
+		}
+
+		// If decoded, write the segment into its place in the object
+		if (!r)
+			r = decoder.ReconstructOutput(sj->object_out + codec->SegmentOffset(segment_i));
+
+		if (r)
+			AtomicAdd(&sj->failures, 1);
+	}
+}
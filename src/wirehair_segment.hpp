@@ -0,0 +1,143 @@
+/*
+	Copyright (c) 2012-2014 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of WirehairFEC nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_WIREHAIR_SEGMENT_HPP
+#define CAT_WIREHAIR_SEGMENT_HPP
+
+#ifdef WIREHAIR_GF_W16
+#include "wirehair_codec_16.hpp"
+#else
+#include "wirehair_codec_8.hpp"
+#endif
+
+// Limits:
+#define CAT_SEGMENT_MAX_N 64000 /* Largest segment, the end of the range covered by the seed tables */
+
+/*
+	Segmented large-object codec
+
+		One Codec is limited to CAT_WIREHAIR_MAX_N blocks, because its
+	row and column indices are 16-bit.  Larger objects are split into
+	the fewest segments that fit, with block counts that differ by at
+	most one, and each segment is coded on its own.  Segments stay at
+	CAT_SEGMENT_MAX_N blocks or less even when the codec is built with
+	WIREHAIR_LARGE_N, where the seeds are tuned and solving is fastest.
+
+		Block ids are interleaved across the segments: id i belongs to
+	segment i % S as segment block id i / S.  So a burst of lost blocks
+	is spread evenly over all of the segments instead of hitting one,
+	and ids below the total block count are exactly the original blocks,
+	though not in object order when S > 1.
+
+		Segments are encoded and decoded as separate tasks on the
+	executor.  Each segment costs a little overhead of its own, so a
+	receiver needs a few more blocks than it would for a single Codec.
+*/
+
+namespace cat {
+
+namespace wirehair {
+
+
+//// Segmented Encoder/Decoder
+
+class CAT_EXPORT SegmentedCodec
+{
+	// Parameters
+	u64 _object_bytes;					// Number of bytes in the object
+	u32 _block_bytes;					// Number of bytes in a block
+	u32 _block_count;					// Number of blocks in the object
+	u32 _segment_count;					// Number of segments S
+	u32 _segment_blocks;				// Number of blocks in the shorter segments
+	u32 _long_segments;					// Number of leading segments with one more block
+
+	// Encoder
+	Codec * CAT_RESTRICT _encoders;		// One encoder per segment
+	const u8 * CAT_RESTRICT _object;	// Object being encoded
+
+	// Parallelism
+	Executor _executor;					// Runs parallel tasks, or serial if run is 0
+
+	struct SegmentJob;
+
+	// Split the object into segments
+	Result ChooseSegments(u64 object_bytes, u32 block_bytes);
+
+	// Number of blocks in a segment
+	CAT_INLINE u32 SegmentBlocks(u32 segment_i) const
+	{
+		return _segment_blocks + (segment_i < _long_segments ? 1 : 0);
+	}
+
+	// Offset of the first byte of a segment in the object
+	u64 SegmentOffset(u32 segment_i) const;
+
+	// Number of bytes in a segment
+	u64 SegmentBytes(u32 segment_i) const;
+
+	// Run a task for each segment, one segment at a time per worker
+	void RunSegmentTasks(TaskFunction task, SegmentJob *job);
+
+	// Encode the segments claimed by one worker
+	static void EncodeTask(void *job, int index);
+
+	// Decode the segments claimed by one worker
+	static void DecodeTask(void *job, int index);
+
+	void FreeEncoders();
+
+public:
+	SegmentedCodec();
+	~SegmentedCodec();
+
+	// Set executor for segment tasks, or 0 to run them serially
+	void SetExecutor(const Executor *executor);
+
+	CAT_INLINE u32 BlockCount() const { return _block_count; }
+	CAT_INLINE u32 SegmentCount() const { return _segment_count; }
+
+	// Offset of an original block in the object, for an interleaved id below BlockCount()
+	u64 BlockOffset(u32 id) const;
+
+	// Encode an object, which must stay unmodified while blocks are written
+	Result EncodeObject(const void *object, u64 object_bytes, u32 block_bytes);
+
+	// Write a block for an interleaved id, returning number of bytes written (safe to call from several threads)
+	u32 Encode(u32 id, void * CAT_RESTRICT block_out) const;
+
+	// Decode an object from the received blocks
+	Result DecodeObject(u64 object_bytes, u32 block_bytes, const u32 * CAT_RESTRICT ids,
+		const void * const * CAT_RESTRICT blocks, u32 count, void * CAT_RESTRICT object_out);
+};
+
+
+} // namespace wirehair
+
+} // namespace cat
+
+#endif // CAT_WIREHAIR_SEGMENT_HPP
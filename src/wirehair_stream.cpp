@@ -0,0 +1,528 @@
+/*
+	Copyright (c) 2012-2014 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of WirehairFEC nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "wirehair_stream.hpp"
+#include "Galois256.hpp"
+#include <string.h>
+using namespace cat;
+using namespace wirehair;
+
+
+//// Data Structures
+
+struct StreamCodec::Row
+{
+	u64 lead;		// Sequence number of the leading 1
+	u64 last;		// Last sequence number with a coefficient
+	bool used;		// Row is in use?
+};
+
+
+//// Utility: Coefficients
+
+/*
+	GenerateCoefficients
+
+		The coefficients of a repair packet only depend on the values
+	that identify it, so the decoder can regenerate them.  They are never
+	zero, so every packet of the window is covered.
+*/
+
+static void GenerateCoefficients(u32 last, u32 index, u32 count, u8 * CAT_RESTRICT coeffs)
+{
+	Abyssinian prng;
+	prng.Initialize(last, index);
+
+	for (u32 ii = 0; ii < count; ++ii)
+	{
+		u8 coeff = (u8)prng.Next();
+		coeffs[ii] = coeff ? coeff : 1;
+	}
+}
+
+// Add c times the ring-indexed coefficients of src to dest, for sequence numbers [first, last]
+static void RingMulAdd(u8 * CAT_RESTRICT dest, u8 c, const u8 * CAT_RESTRICT src, u64 first, u64 last, u32 ring)
+{
+	const u32 offset = (u32)(first % ring);
+	const u32 count = (u32)(last - first) + 1;
+	const u32 run = count < ring - offset ? count : ring - offset;
+
+	GF256MemMulAdd(dest + offset, c, src + offset, run);
+	if (count > run)
+		GF256MemMulAdd(dest, c, src, count - run);
+}
+
+// Divide the ring-indexed coefficients of dest by c, for sequence numbers [first, last]
+static void RingDivide(u8 * CAT_RESTRICT dest, u8 c, u64 first, u64 last, u32 ring)
+{
+	const u32 offset = (u32)(first % ring);
+	const u32 count = (u32)(last - first) + 1;
+	const u32 run = count < ring - offset ? count : ring - offset;
+
+	GF256MemDivide(dest + offset, c, run);
+	if (count > run)
+		GF256MemDivide(dest, c, count - run);
+}
+
+
+//// Buffers
+
+StreamCodec::StreamCodec()
+{
+	_window = 0;
+	_block_bytes = 0;
+	_coeffs = 0;
+	_packets = 0;
+	_packet_seqs = 0;
+	_rows = 0;
+	_row_coeffs = 0;
+	_row_blocks = 0;
+	_pivots = 0;
+}
+
+StreamCodec::~StreamCodec()
+{
+	Free();
+}
+
+Result StreamCodec::Allocate(u32 window, u32 block_bytes, bool decoder)
+{
+	if CAT_UNLIKELY(window < 1 || window > CAT_STREAM_MAX_WINDOW || block_bytes < 1)
+		return R_BAD_INPUT;
+
+	GF256Init();
+
+	Free();
+
+	_window = window;
+	_block_bytes = block_bytes;
+
+	_coeffs = new u8[window];
+	if (!_coeffs) return R_OUT_OF_MEMORY;
+
+	// The decoder keeps 2W packets, so a window can still be solved after its oldest packets are released
+	const u32 ring = decoder ? window * 2 : window;
+	_packets = new u8[ring * (size_t)block_bytes];
+	if (!_packets)
+	{
+		Free();
+		return R_OUT_OF_MEMORY;
+	}
+
+	if (decoder)
+	{
+		_packet_seqs = new u64[ring];
+		_rows = new Row[ring];
+		_row_coeffs = new u8[ring * (size_t)ring];
+		_row_blocks = new u8[ring * (size_t)block_bytes];
+		_pivots = new u32[ring];
+		if (!_packet_seqs || !_rows || !_row_coeffs || !_row_blocks || !_pivots)
+		{
+			Free();
+			return R_OUT_OF_MEMORY;
+		}
+
+		for (u32 ii = 0; ii < ring; ++ii)
+		{
+			_packet_seqs[ii] = 0;
+			_rows[ii].used = false;
+			_pivots[ii] = NO_ROW;
+		}
+	}
+
+	_first = 0;
+	_end = 0;
+	_repair_end = 0;
+	_repair_next = 0;
+	_row_count = 0;
+	_next = 0;
+
+	return R_WIN;
+}
+
+void StreamCodec::Free()
+{
+	if (_coeffs)
+	{
+		delete []_coeffs;
+		_coeffs = 0;
+	}
+	if (_packets)
+	{
+		delete []_packets;
+		_packets = 0;
+	}
+	if (_packet_seqs)
+	{
+		delete []_packet_seqs;
+		_packet_seqs = 0;
+	}
+	if (_rows)
+	{
+		delete []_rows;
+		_rows = 0;
+	}
+	if (_row_coeffs)
+	{
+		delete []_row_coeffs;
+		_row_coeffs = 0;
+	}
+	if (_row_blocks)
+	{
+		delete []_row_blocks;
+		_row_blocks = 0;
+	}
+	if (_pivots)
+	{
+		delete []_pivots;
+		_pivots = 0;
+	}
+}
+
+
+Result StreamCodec::Start(u32 seq)
+{
+	// Only before the first packet
+	if CAT_UNLIKELY(!_packets || _end != _first)
+		return R_BAD_INPUT;
+
+	_first = seq;
+	_end = seq;
+	_repair_end = seq;
+	_next = seq;
+
+	return R_WIN;
+}
+
+
+//// Encoder Mode
+
+Result StreamCodec::InitializeEncoder(u32 window, u32 block_bytes)
+{
+	return Allocate(window, block_bytes, false);
+}
+
+Result StreamCodec::Add(const void * CAT_RESTRICT packet)
+{
+	if CAT_UNLIKELY(!_packets || _packet_seqs || !packet)
+		return R_BAD_INPUT;
+
+	memcpy(_packets + (_end % _window) * (size_t)_block_bytes, packet, _block_bytes);
+
+	++_end;
+
+	return R_WIN;
+}
+
+Result StreamCodec::Repair(u32 &last, u32 &index, void * CAT_RESTRICT block_out)
+{
+	if CAT_UNLIKELY(!_packets || _packet_seqs || _end == _first || !block_out)
+		return R_BAD_INPUT;
+
+	// If the window moved since the last repair packet, start its indices over
+	if (_repair_end != _end)
+	{
+		_repair_end = _end;
+		_repair_next = 0;
+	}
+
+	last = (u32)(_end - 1);
+	index = _repair_next++;
+
+	const u32 count = WindowCount(_end - 1);
+	const u64 first = _end - count;
+
+	GenerateCoefficients(last, index, count, _coeffs);
+
+	// Sum the packets of the window times their coefficients
+	memset(block_out, 0, _block_bytes);
+	for (u32 ii = 0; ii < count; ++ii)
+	{
+		const u8 *packet = _packets + ((first + ii) % _window) * (size_t)_block_bytes;
+
+		GF256MemMulAdd(block_out, _coeffs[ii], packet, _block_bytes);
+	}
+
+	return R_WIN;
+}
+
+
+//// Decoder Mode
+
+Result StreamCodec::InitializeDecoder(u32 window, u32 block_bytes)
+{
+	return Allocate(window, block_bytes, true);
+}
+
+void StreamCodec::Advance(u64 end)
+{
+	if (end <= _end)
+		return;
+
+	_end = end;
+
+	const u32 ring = _window * 2;
+	if (_end - _first <= ring)
+		return;
+
+	// Packets older than the ring are gone, even if they were not released yet
+	if (_next < _end - ring)
+		_next = _end - ring;
+
+	// Rows that lead with a packet older than the ring can no longer be solved
+	for (u32 ii = 0; _row_count > 0 && ii < ring; ++ii)
+		if (_rows[ii].used && _rows[ii].lead < _end - ring)
+			FreeRow(ii);
+}
+
+void StreamCodec::FreeRow(u32 row_i)
+{
+	Row *row = &_rows[row_i];
+
+	_pivots[RingSlot(row->lead)] = NO_ROW;
+	row->used = false;
+	--_row_count;
+}
+
+/*
+	Eliminate
+
+		This walks the row from its oldest sequence number.  Known packets
+	are added into the block value, and missing packets that already have a
+	pivot row are eliminated with it, which can extend the row up to the
+	last packet of that pivot.  The first missing packet without a pivot
+	becomes the leading 1 of this row.
+*/
+
+bool StreamCodec::Eliminate(u32 row_i, u64 first, u64 last)
+{
+	Row *row = &_rows[row_i];
+	u8 *coeffs = RowCoeffs(row_i);
+	u8 *block = RowBlock(row_i);
+	const u32 ring = _window * 2;
+
+	for (u64 seq = first; seq <= last; ++seq)
+	{
+		const u32 slot = RingSlot(seq);
+		const u8 c = coeffs[slot];
+		if (!c)
+			continue;
+
+		// If the packet is known, move it to the block value
+		if (HasPacket(seq))
+		{
+			GF256MemMulAdd(block, c, DecoderPacket(seq), _block_bytes);
+			coeffs[slot] = 0;
+			continue;
+		}
+
+		// If another row leads with this packet, eliminate it
+		const u32 pivot_i = _pivots[slot];
+		if (pivot_i != NO_ROW)
+		{
+			const Row *pivot = &_rows[pivot_i];
+
+			RingMulAdd(coeffs, c, RowCoeffs(pivot_i), seq, pivot->last, ring);
+			GF256MemMulAdd(block, c, RowBlock(pivot_i), _block_bytes);
+
+			if (last < pivot->last)
+				last = pivot->last;
+			continue;
+		}
+
+		// Normalize the row so it leads with a 1
+		if (c != 1)
+		{
+			RingDivide(coeffs, c, seq, last, ring);
+			GF256MemDivide(block, c, _block_bytes);
+		}
+
+		row->lead = seq;
+		row->last = last;
+		_pivots[slot] = row_i;
+		return true;
+	}
+
+	// Redundant
+	row->used = false;
+	--_row_count;
+	return false;
+}
+
+void StreamCodec::BackSubstitute()
+{
+	const u32 ring = _window * 2;
+	const u64 oldest = _end - _first > ring ? _end - ring : _first;
+
+	// Newest first, so packets recovered by later rows are known to earlier ones
+	for (u64 seq = _end; _row_count > 0 && seq-- > oldest;)
+	{
+		const u32 row_i = _pivots[RingSlot(seq)];
+		if (row_i == NO_ROW)
+			continue;
+
+		const Row *row = &_rows[row_i];
+		u8 *coeffs = RowCoeffs(row_i);
+		u8 *block = RowBlock(row_i);
+
+		bool solved = true;
+		for (u64 other = seq + 1; other <= row->last; ++other)
+		{
+			const u32 slot = RingSlot(other);
+			const u8 c = coeffs[slot];
+			if (!c)
+				continue;
+
+			if (HasPacket(other))
+			{
+				GF256MemMulAdd(block, c, DecoderPacket(other), _block_bytes);
+				coeffs[slot] = 0;
+			}
+			else
+				solved = false;
+		}
+
+		// If the leading packet is the only one left, it is the block value
+		if (solved)
+		{
+			memcpy(DecoderPacket(seq), block, _block_bytes);
+			_packet_seqs[RingSlot(seq)] = seq + 1;
+			FreeRow(row_i);
+		}
+	}
+}
+
+Result StreamCodec::ReadSource(u32 wire_seq, const void * CAT_RESTRICT packet)
+{
+	if CAT_UNLIKELY(!_packet_seqs || !packet)
+		return R_BAD_INPUT;
+
+	// If it is from before the stream, or was already released or received,
+	u64 seq;
+	if (!Unwrap(wire_seq, seq) || seq < _next || (seq < _end && HasPacket(seq)))
+		return R_WIN;
+
+	Advance(seq + 1);
+
+	const u32 slot = RingSlot(seq);
+	memcpy(DecoderPacket(seq), packet, _block_bytes);
+	_packet_seqs[slot] = seq + 1;
+
+	if (_row_count > 0)
+	{
+		// If a row led with it, that row now leads with a later packet
+		const u32 row_i = _pivots[slot];
+		if (row_i != NO_ROW)
+		{
+			_pivots[slot] = NO_ROW;
+			Eliminate(row_i, seq, _rows[row_i].last);
+		}
+
+		BackSubstitute();
+	}
+
+	return R_WIN;
+}
+
+Result StreamCodec::ReadRepair(u32 wire_last, u32 index, const void * CAT_RESTRICT block)
+{
+	if CAT_UNLIKELY(!_packet_seqs || !block)
+		return R_BAD_INPUT;
+
+	// If it is from before the stream, or all of its packets were already released,
+	u64 last;
+	if (!Unwrap(wire_last, last) || last < _next)
+		return R_WIN;
+
+	Advance(last + 1);
+
+	const u32 ring = _window * 2;
+	const u32 count = WindowCount(last);
+	const u64 first = last + 1 - count;
+
+	// If its oldest packets fell out of the ring,
+	if (first + ring < _end)
+		return R_WIN;
+
+	// If none of its packets are missing, it is not needed
+	u32 missing = 0;
+	for (u64 seq = first; seq <= last; ++seq)
+		if (!HasPacket(seq))
+			++missing;
+	if (missing == 0)
+		return R_WIN;
+
+	// Find a free row
+	u32 row_i = 0;
+	while (row_i < ring && _rows[row_i].used)
+		++row_i;
+	if (row_i >= ring)
+		return R_WIN;
+
+	Row *row = &_rows[row_i];
+	row->used = true;
+	++_row_count;
+
+	u8 *coeffs = RowCoeffs(row_i);
+	memset(coeffs, 0, ring);
+	memcpy(RowBlock(row_i), block, _block_bytes);
+
+	GenerateCoefficients(wire_last, index, count, _coeffs);
+	for (u32 ii = 0; ii < count; ++ii)
+		coeffs[RingSlot(first + ii)] = _coeffs[ii];
+
+	if (Eliminate(row_i, first, last))
+		BackSubstitute();
+
+	return R_WIN;
+}
+
+bool StreamCodec::Pop(u32 &seq, void * CAT_RESTRICT packet_out)
+{
+	if CAT_UNLIKELY(!_packet_seqs || !packet_out)
+		return false;
+
+	while (_next < _end)
+	{
+		if (HasPacket(_next))
+		{
+			memcpy(packet_out, DecoderPacket(_next), _block_bytes);
+			seq = (u32)_next++;
+			return true;
+		}
+
+		// If a later window can still cover it, wait for it
+		if (_next + _window >= _end)
+			break;
+
+		// Give up on it
+		++_next;
+	}
+
+	return false;
+}
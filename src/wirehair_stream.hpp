@@ -0,0 +1,209 @@
+/*
+	Copyright (c) 2012-2014 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of WirehairFEC nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_WIREHAIR_STREAM_HPP
+#define CAT_WIREHAIR_STREAM_HPP
+
+#ifdef WIREHAIR_GF_W16
+#include "wirehair_codec_16.hpp"
+#else
+#include "wirehair_codec_8.hpp"
+#endif
+
+// Limits:
+#define CAT_STREAM_MAX_WINDOW 1024 /* Largest window, which bounds the decoder's elimination rows */
+
+/*
+	Sliding-window stream codec
+
+		Source packets of a live stream are numbered in order from 0.
+	A repair packet covers the window of the last W source packets sent
+	before it, or all of them at the start of the stream.  It is a sum of
+	those packets in GF(256), with non-zero coefficients drawn from the
+	same Abyssinian generator that seeds the rows of the Codec, seeded by
+	the last sequence number in its window and by its repair index.  Those
+	two values identify the repair packet on the wire.
+
+		Unlike the Codec, a repair packet is not tied to one message of
+	N blocks: any repair packet whose window covers a lost packet helps
+	to recover it, even though the windows of consecutive repair packets
+	all start at different places.  So the decoder keeps an elimination
+	matrix over the missing packets of the last 2W sequence numbers, in the
+	same way as the heavy rows of the Codec solver.  Each row is kept
+	normalized with a leading 1 at the oldest missing packet it touches,
+	and a row whose other missing packets were all recovered or received
+	gives its leading packet right away, so packets come out as soon as
+	they are determined, oldest first.
+
+		Packets are released in sequence order as soon as they are present.
+	A packet that is still missing once the newest sequence number seen is
+	W past it cannot be covered by any later window, so it is skipped.  The
+	delay is therefore zero without loss, and it grows with the loss up to
+	W packets instead of always being a whole generation.
+
+		Sequence numbers are 32 bits on the wire and wrap around, so a
+	stream can run for as long as it likes.  Both sides count in 64 bits
+	and extend each received sequence number to the one nearest the
+	newest seen, which works while packets are less than 2^31 late.
+	The coefficients are seeded with the low 32 bits.
+*/
+
+namespace cat {
+
+namespace wirehair {
+
+
+//// Sliding-Window Stream Encoder/Decoder
+
+class CAT_EXPORT StreamCodec
+{
+	// Parameters
+	u32 _window;						// Largest number of source packets covered by a repair packet
+	u32 _block_bytes;					// Number of bytes in a packet
+	u8 * CAT_RESTRICT _coeffs;			// Coefficients of the window of one repair packet
+
+	// Source packets
+	u8 * CAT_RESTRICT _packets;			// Ring of recent source packets: W slots to encode, 2W to decode
+	u64 _first;							// Sequence number of the first packet of the stream
+	u64 _end;							// One past the newest sequence number seen
+
+	// Encoder
+	u64 _repair_end;					// Value of _end for the last repair packet written
+	u32 _repair_next;					// Next repair index for that window
+
+	// Decoder
+	struct Row;
+	static const u32 NO_ROW = ~(u32)0;
+	u64 * CAT_RESTRICT _packet_seqs;	// Sequence number + 1 held by each ring slot, or 0 if empty
+	Row * CAT_RESTRICT _rows;			// Elimination rows, one per ring slot
+	u8 * CAT_RESTRICT _row_coeffs;		// Coefficients of each row, indexed by ring slot
+	u8 * CAT_RESTRICT _row_blocks;		// Block values of each row
+	u32 * CAT_RESTRICT _pivots;			// Row with its leading 1 at each ring slot, or NO_ROW
+	u32 _row_count;						// Number of rows in use
+	u64 _next;							// Next sequence number to release
+
+	// Number of source packets covered by the window ending at last
+	CAT_INLINE u32 WindowCount(u64 last) const
+	{
+		return last - _first < _window ? (u32)(last - _first) + 1 : _window;
+	}
+
+	// Extend a 32-bit sequence number to the one nearest the newest seen, or return false if it is before the stream
+	CAT_INLINE bool Unwrap(u32 seq, u64 &full) const
+	{
+		full = _end + (s64)(s32)(seq - (u32)_end);
+		return full >= _first && full < _end + 0x80000000ULL;
+	}
+
+	// Decoder ring slot for a sequence number
+	CAT_INLINE u32 RingSlot(u64 seq) const
+	{
+		return (u32)(seq % (_window * 2));
+	}
+
+	CAT_INLINE u8 *DecoderPacket(u64 seq) const
+	{
+		return _packets + RingSlot(seq) * (size_t)_block_bytes;
+	}
+
+	CAT_INLINE bool HasPacket(u64 seq) const
+	{
+		return _packet_seqs[RingSlot(seq)] == seq + 1;
+	}
+
+	CAT_INLINE u8 *RowCoeffs(u32 row_i) const
+	{
+		return _row_coeffs + row_i * (size_t)(_window * 2);
+	}
+
+	CAT_INLINE u8 *RowBlock(u32 row_i) const
+	{
+		return _row_blocks + row_i * (size_t)_block_bytes;
+	}
+
+	// Allocate buffers for the window and block size
+	Result Allocate(u32 window, u32 block_bytes, bool decoder);
+
+	void Free();
+
+	// Note a sequence number seen in the stream, dropping what falls out of the ring
+	void Advance(u64 end);
+
+	// Release a row and its pivot
+	void FreeRow(u32 row_i);
+
+	// Reduce a row by the known packets and pivots from first, and make it a pivot, or free it if it reduces to zero
+	bool Eliminate(u32 row_i, u64 first, u64 last);
+
+	// Recover the packets of pivot rows whose other packets are all known, newest first
+	void BackSubstitute();
+
+public:
+	StreamCodec();
+	~StreamCodec();
+
+	CAT_INLINE u32 Window() const { return _window; }
+	CAT_INLINE u32 BlockBytes() const { return _block_bytes; }
+
+	// Set the sequence number of the first packet, before any packet is added or read
+	Result Start(u32 seq);
+
+
+	//// Encoder Mode
+
+	// Initialize encoder mode
+	Result InitializeEncoder(u32 window, u32 block_bytes);
+
+	// Add the next source packet to the window
+	Result Add(const void * CAT_RESTRICT packet);
+
+	// Write a repair packet for the current window, and the values that identify it
+	Result Repair(u32 &last, u32 &index, void * CAT_RESTRICT block_out);
+
+
+	//// Decoder Mode
+
+	// Initialize decoder mode
+	Result InitializeDecoder(u32 window, u32 block_bytes);
+
+	// Feed decoder a source packet
+	Result ReadSource(u32 seq, const void * CAT_RESTRICT packet);
+
+	// Feed decoder a repair packet
+	Result ReadRepair(u32 last, u32 index, const void * CAT_RESTRICT block);
+
+	// Copy out the next source packet in order, or return false if it is not ready yet
+	bool Pop(u32 &seq, void * CAT_RESTRICT packet_out);
+};
+
+
+} // namespace wirehair
+
+} // namespace cat
+
+#endif // CAT_WIREHAIR_STREAM_HPP
@@ -0,0 +1,319 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Number of messages to decode for each case
+const int TRIALS = 100;
+
+// Message sizes are picked at random from N = 2..MAX_N blocks
+const int MAX_N = 1000;
+const int BLOCK_BYTES = 100;
+
+// Spares kept by wirehair_expect() beyond the first N rows
+const int SPARE_COUNT = 32;
+
+// Largest number of ids in one list
+const int MAX_IDS = MAX_N * 4;
+
+// Hash of encoder output before wirehair_expect() split PeelDiagonalValues(),
+// for the GF(256) and GF(2^16) builds
+const u64 ENCODER_HASH_8 = 0x284ba10cfe4487aeULL;
+const u64 ENCODER_HASH_16 = 0xf9c3d88c9ae981daULL;
+
+
+//// Message
+
+static Abyssinian m_prng;
+static wirehair_state m_encoder = 0;
+static wirehair_state m_decoder = 0;
+static u8 *m_message = 0;
+static u8 *m_message_out = 0;
+static int m_n, m_bytes;
+
+// Ids in the order they are sent, with originals lost at random
+static u32 m_ids[MAX_IDS];
+
+static bool NewMessage() {
+	// The GF(2^16) codec cannot encode a few N, so pick another one
+	do {
+		m_n = 2 + m_prng.Next() % (MAX_N - 1);
+		m_bytes = m_n * BLOCK_BYTES - m_prng.Next() % BLOCK_BYTES;
+
+		for (int ii = 0; ii < m_bytes; ++ii) {
+			m_message[ii] = (u8)m_prng.Next();
+		}
+
+		m_encoder = wirehair_encode(m_encoder, m_message, m_bytes, BLOCK_BYTES);
+	} while (!m_encoder);
+
+	// 25% of the originals are lost, then repair blocks follow
+	int count = 0;
+	for (int id = 0; id < m_n; ++id) {
+		if (m_prng.Next() % 4) {
+			m_ids[count++] = id;
+		}
+	}
+	for (u32 id = m_n; count < MAX_IDS; ++id) {
+		m_ids[count++] = id;
+	}
+
+	m_decoder = wirehair_decode(m_decoder, m_bytes, BLOCK_BYTES);
+
+	return m_decoder != 0;
+}
+
+// Write a block from the encoder and read it into the decoder
+static bool Read(u32 id) {
+	u8 block[BLOCK_BYTES];
+
+	wirehair_write(m_encoder, id, block);
+
+	return wirehair_read(m_decoder, id, block) != 0;
+}
+
+// Keep reading ids from the list, starting at index, until the message is decoded
+static bool Finish(int index, bool complete) {
+	for (; !complete && index < MAX_IDS; ++index) {
+		complete = Read(m_ids[index]);
+	}
+
+	return complete &&
+		wirehair_reconstruct(m_decoder, m_message_out) &&
+		!memcmp(m_message_out, m_message, m_bytes);
+}
+
+//// Cases
+
+// Expect the first N ids and then read them all
+static bool ExpectAll() {
+	if (!wirehair_expect(m_decoder, m_ids, m_n)) {
+		return false;
+	}
+
+	bool complete = false;
+	for (int ii = 0; ii < m_n && !complete; ++ii) {
+		complete = Read(m_ids[ii]);
+	}
+
+	return Finish(m_n, complete);
+}
+
+// Expect ids in two calls, reading some of the first ones in between
+static bool ExpectTwice() {
+	const int half = m_n / 2;
+
+	if (!wirehair_expect(m_decoder, m_ids, half)) {
+		return false;
+	}
+
+	bool complete = false;
+	for (int ii = 0; ii < half / 2; ++ii) {
+		complete = Read(m_ids[ii]);
+	}
+
+	// List the ids that are still expected again, which are skipped
+	if (!wirehair_expect(m_decoder, m_ids + half / 2, m_n - half / 2 + SPARE_COUNT)) {
+		return false;
+	}
+
+	for (int ii = half / 2; ii < m_n + SPARE_COUNT && !complete; ++ii) {
+		complete = Read(m_ids[ii]);
+	}
+
+	return Finish(m_n + SPARE_COUNT, complete);
+}
+
+// Lose one expected block, so that every spare arrives first
+static bool SpareOverflow() {
+	// List more ids than there are spares for
+	if (!wirehair_expect(m_decoder, m_ids, m_n + SPARE_COUNT + 8)) {
+		return false;
+	}
+
+	const int lost = m_prng.Next() % m_n;
+
+	bool complete = false;
+	for (int ii = 0; ii < m_n + SPARE_COUNT + 8 && !complete; ++ii) {
+		if (ii != lost) {
+			complete = Read(m_ids[ii]);
+		}
+	}
+
+	return Finish(m_n + SPARE_COUNT + 8, complete);
+}
+
+// Lose a few expected blocks, and then read a block that was not listed
+static bool Unlisted() {
+	if (!wirehair_expect(m_decoder, m_ids, m_n)) {
+		return false;
+	}
+
+	bool complete = false;
+	for (int ii = 0; ii < m_n && !complete; ++ii) {
+		if (ii % 7 != 3) {
+			complete = Read(m_ids[ii]);
+		}
+	}
+
+	return Finish(m_n, complete);
+}
+
+// Expect N ids that do not solve, so the spares are needed
+static bool SolveFailed() {
+	// Find a list where the first N blocks are not enough, which is rare for some N
+	for (int attempt = 0; attempt < 1000; ++attempt) {
+		bool complete = false;
+		for (int ii = 0; ii < m_n && !complete; ++ii) {
+			complete = Read(m_ids[ii]);
+		}
+
+		if (!complete) {
+			break;
+		}
+
+		// Shuffle the ids and try again
+		for (int ii = MAX_IDS - 1; ii > 0; --ii) {
+			int jj = m_prng.Next() % (ii + 1);
+			u32 id = m_ids[ii];
+			m_ids[ii] = m_ids[jj];
+			m_ids[jj] = id;
+		}
+
+		m_decoder = wirehair_decode(m_decoder, m_bytes, BLOCK_BYTES);
+		if (!m_decoder) {
+			return false;
+		}
+	}
+
+	m_decoder = wirehair_decode(m_decoder, m_bytes, BLOCK_BYTES);
+	if (!m_decoder || !wirehair_expect(m_decoder, m_ids, m_n + SPARE_COUNT)) {
+		return false;
+	}
+
+	// Read all but the last expected block, then two spares, then the last one
+	bool complete = false;
+	for (int ii = 0; ii < m_n - 1; ++ii) {
+		complete = Read(m_ids[ii]);
+	}
+
+	complete = Read(m_ids[m_n]) || complete;
+	complete = Read(m_ids[m_n + 1]) || complete;
+	complete = Read(m_ids[m_n - 1]) || complete;
+
+	return Finish(m_n + 2, complete);
+}
+
+static int RunCase(const char *name, bool (*test)()) {
+	int failures = 0;
+
+	double t0 = m_clock.usec();
+
+	for (int trial = 0; trial < TRIALS; ++trial) {
+		if (!NewMessage() || !test()) {
+			cout << name << ": failed for N = " << m_n << endl;
+			++failures;
+		}
+	}
+
+	double t1 = m_clock.usec();
+
+	cout << name << ": " << TRIALS - failures << " of " << TRIALS << " decoded, " << (t1 - t0) / TRIALS << " usec/message" << endl;
+
+	return failures ? 1 : 0;
+}
+
+
+//// Encoder output
+
+// Encoder output must not change when the decoder changes
+static bool CheckEncoder() {
+	const int counts[] = { 2, 3, 7, 30, 255, 256, 1000, 4097, 20000, 64000 };
+	const int block_bytes = 40;
+
+	u64 hash = 1469598103934665603ULL;
+	u8 *message = new u8[64000 * block_bytes];
+	u8 block[block_bytes];
+
+	for (int ii = 0; ii < (int)(sizeof(counts) / sizeof(counts[0])); ++ii) {
+		const int N = counts[ii];
+
+		for (int jj = 0; jj < N * block_bytes; ++jj) {
+			message[jj] = (u8)(jj * 131 + 7);
+		}
+
+		wirehair_state encoder = wirehair_encode(0, message, N * block_bytes, block_bytes);
+		if (!encoder) {
+			delete []message;
+			return false;
+		}
+
+		for (int id = N; id < N + 40; ++id) {
+			wirehair_write(encoder, id, block);
+
+			for (int kk = 0; kk < block_bytes; ++kk) {
+				hash = (hash ^ block[kk]) * 1099511628211ULL;
+			}
+		}
+
+		wirehair_free(encoder);
+	}
+
+	delete []message;
+
+	bool matched = hash == ENCODER_HASH_8 || hash == ENCODER_HASH_16;
+
+	cout << "Encoder output: " << (matched ? "unchanged" : "CHANGED") << endl;
+
+	return matched;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	m_prng.Initialize(0);
+
+	m_message = new u8[MAX_N * BLOCK_BYTES];
+	m_message_out = new u8[MAX_N * BLOCK_BYTES];
+
+	int failures = 0;
+
+	failures += RunCase("Expect all", ExpectAll);
+	failures += RunCase("Expect twice", ExpectTwice);
+	failures += RunCase("Every spare first", SpareOverflow);
+	failures += RunCase("Unlisted block", Unlisted);
+	failures += RunCase("Solve failed", SolveFailed);
+
+	if (!CheckEncoder()) {
+		++failures;
+	}
+
+	wirehair_free(m_encoder);
+	wirehair_free(m_decoder);
+	delete []m_message;
+	delete []m_message_out;
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
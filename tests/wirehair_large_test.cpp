@@ -0,0 +1,157 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Consecutive N checked just past the seed tables, which include N = 64085 that needs a backup peel seed
+const int FIRST_N = 64001;
+const int SWEEP_COUNT = 100;
+const int SWEEP_BLOCK_BYTES = 2;
+
+// Larger N that also needs a backup peel seed
+const int LARGE_N = 168931;
+const int LARGE_BLOCK_BYTES = 8;
+
+// Percentage of blocks lost on the way
+const int LOSS_PERCENT = 10;
+
+
+//// Message
+
+static Abyssinian m_prng;
+static u8 *m_message = 0;
+static u8 *m_message_out = 0;
+
+static double m_encode_usec, m_decoder_usec, m_decode_usec;
+
+// Encode and decode a message of N blocks.  When decoder_first is set the decoder
+// is created before the encoder, so it has to find the peel seed by itself
+static bool TestMessage(int n, int block_bytes, bool decoder_first) {
+	const int bytes = n * block_bytes - m_prng.Next() % block_bytes;
+
+	for (int ii = 0; ii < bytes; ++ii) {
+		m_message[ii] = (u8)m_prng.Next();
+	}
+
+	wirehair_state encoder = 0, decoder = 0;
+
+	double t0 = m_clock.usec();
+	if (decoder_first) {
+		decoder = wirehair_decode(0, bytes, block_bytes);
+	}
+	double t1 = m_clock.usec();
+	encoder = wirehair_encode(0, m_message, bytes, block_bytes);
+	double t2 = m_clock.usec();
+	if (!decoder_first) {
+		decoder = wirehair_decode(0, bytes, block_bytes);
+	}
+	double t3 = m_clock.usec();
+
+	m_decoder_usec += (t1 - t0) + (t3 - t2);
+	m_encode_usec += t2 - t1;
+
+	if (!encoder || !decoder) {
+		cout << (encoder ? "wirehair_decode" : "wirehair_encode") << " failed for N = " << n << endl;
+		wirehair_free(encoder);
+		wirehair_free(decoder);
+		return false;
+	}
+
+	// Drop original and repair blocks at random until it decodes
+	u8 block[LARGE_BLOCK_BYTES];
+	bool complete = false;
+
+	for (u32 id = 0; !complete && id < (u32)n * 2; ++id) {
+		if (m_prng.Next() % 100 < LOSS_PERCENT) {
+			continue;
+		}
+
+		wirehair_write(encoder, id, block);
+		complete = wirehair_read(decoder, id, block) != 0;
+	}
+
+	const bool success = complete &&
+		wirehair_reconstruct(decoder, m_message_out) &&
+		!memcmp(m_message_out, m_message, bytes);
+
+	m_decode_usec += m_clock.usec() - t3;
+
+	if (!success) {
+		cout << "Decode failed for N = " << n << ", block_bytes = " << block_bytes << endl;
+	}
+
+	wirehair_free(encoder);
+	wirehair_free(decoder);
+
+	return success;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	m_prng.Initialize(0);
+
+	m_message = new u8[LARGE_N * LARGE_BLOCK_BYTES];
+	m_message_out = new u8[LARGE_N * LARGE_BLOCK_BYTES];
+
+	int failures = 0;
+
+	// Without WIREHAIR_LARGE_N, N is limited to 64000
+	if (!TestMessage(FIRST_N, SWEEP_BLOCK_BYTES, false)) {
+		cout << "The library must be built with WIREHAIR_LARGE_N (make release-large)" << endl;
+		++failures;
+	} else {
+		// Every N is decoded once with the decoder first and once with the encoder
+		// first, and each finds the peel seed by itself in one of them
+		m_encode_usec = m_decoder_usec = m_decode_usec = 0;
+
+		for (int ii = 0; ii < SWEEP_COUNT; ++ii) {
+			if (!TestMessage(FIRST_N + ii, SWEEP_BLOCK_BYTES, (ii & 1) != 0)) {
+				++failures;
+			}
+		}
+
+		cout << "N = " << FIRST_N << ".." << FIRST_N + SWEEP_COUNT - 1 << ": " << SWEEP_COUNT - failures << " of "
+			<< SWEEP_COUNT << " decoded, encoder " << m_encode_usec / SWEEP_COUNT << " usec, new decoder "
+			<< m_decoder_usec / SWEEP_COUNT << " usec, decode " << m_decode_usec / SWEEP_COUNT << " usec" << endl;
+
+		for (int decoder_first = 1; decoder_first >= 0; --decoder_first) {
+			m_encode_usec = m_decoder_usec = m_decode_usec = 0;
+
+			if (!TestMessage(LARGE_N, LARGE_BLOCK_BYTES, decoder_first != 0)) {
+				++failures;
+			}
+
+			cout << "N = " << LARGE_N << (decoder_first ? ", decoder first" : ", seed known") << ": encoder "
+				<< m_encode_usec << " usec, new decoder " << m_decoder_usec << " usec, decode "
+				<< m_decode_usec << " usec" << endl;
+		}
+	}
+
+	delete []m_message;
+	delete []m_message_out;
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,261 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+#include <pthread.h>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Number of messages in each batch
+const int MESSAGE_COUNT = 4000;
+
+// Message sizes are picked at random from N = 2..MAX_N blocks
+const int MAX_N = 200;
+const int BLOCK_BYTES = 64;
+
+// Number of batches to time
+const int TRIALS = 10;
+
+// Number of worker threads for the executor
+const int WORKERS = 4;
+
+
+//// Simple executor: A fixed pool of threads sharing one task queue
+
+struct Task {
+	wirehair_task task;
+	void *job;
+	int index;
+};
+
+static pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t m_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t m_finished = PTHREAD_COND_INITIALIZER;
+static Task m_queue[WORKERS * 4];
+static int m_queue_count = 0;
+static int m_pending = 0;
+static bool m_shutdown = false;
+
+// Run one queued task, with the lock held on entry and on return
+static void RunQueuedTask() {
+	Task task = m_queue[--m_queue_count];
+
+	pthread_mutex_unlock(&m_lock);
+	task.task(task.job, task.index);
+	pthread_mutex_lock(&m_lock);
+
+	if (--m_pending == 0) {
+		pthread_cond_broadcast(&m_finished);
+	}
+}
+
+static void *WorkerThread(void *) {
+	pthread_mutex_lock(&m_lock);
+
+	while (!m_shutdown) {
+		if (m_queue_count > 0) {
+			RunQueuedTask();
+		} else {
+			pthread_cond_wait(&m_queued, &m_lock);
+		}
+	}
+
+	pthread_mutex_unlock(&m_lock);
+
+	wirehair_pool_flush();
+
+	return 0;
+}
+
+static void Submit(void *, wirehair_task task, void *job, int index, unsigned int) {
+	pthread_mutex_lock(&m_lock);
+
+	Task &entry = m_queue[m_queue_count++];
+	entry.task = task;
+	entry.job = job;
+	entry.index = index;
+	++m_pending;
+
+	pthread_cond_signal(&m_queued);
+	pthread_mutex_unlock(&m_lock);
+}
+
+static void Wait(void *, void *) {
+	pthread_mutex_lock(&m_lock);
+
+	// Help run tasks from the calling thread
+	while (m_pending > 0) {
+		if (m_queue_count > 0) {
+			RunQueuedTask();
+		} else {
+			pthread_cond_wait(&m_finished, &m_lock);
+		}
+	}
+
+	pthread_mutex_unlock(&m_lock);
+}
+
+
+//// Benchmark
+
+static const void *m_messages[MESSAGE_COUNT];
+static int m_bytes[MESSAGE_COUNT];
+static wirehair_state m_encoders[MESSAGE_COUNT];
+
+static void FreeEncoders() {
+	for (int ii = 0; ii < MESSAGE_COUNT; ++ii) {
+		wirehair_free(m_encoders[ii]);
+		m_encoders[ii] = 0;
+	}
+}
+
+static void Report(const char *name, double usec) {
+	cout << name << ": " << MESSAGE_COUNT * TRIALS / (usec / 1000000.) << " messages/sec" << endl;
+}
+
+static bool BenchmarkSingle() {
+	double t0 = m_clock.usec();
+
+	for (int trial = 0; trial < TRIALS; ++trial) {
+		for (int ii = 0; ii < MESSAGE_COUNT; ++ii) {
+			m_encoders[ii] = wirehair_encode(0, m_messages[ii], m_bytes[ii], BLOCK_BYTES);
+			if (!m_encoders[ii]) {
+				return false;
+			}
+		}
+
+		FreeEncoders();
+	}
+
+	double t1 = m_clock.usec();
+
+	Report("wirehair_encode", t1 - t0);
+
+	return true;
+}
+
+static bool BenchmarkMany(const char *name) {
+	double t0 = m_clock.usec();
+
+	for (int trial = 0; trial < TRIALS; ++trial) {
+		if (wirehair_encode_many(m_encoders, m_messages, m_bytes, MESSAGE_COUNT, BLOCK_BYTES) != MESSAGE_COUNT) {
+			return false;
+		}
+
+		FreeEncoders();
+	}
+
+	double t1 = m_clock.usec();
+
+	Report(name, t1 - t0);
+
+	return true;
+}
+
+// Check that batch encoders write the same blocks as wirehair_encode()
+static bool VerifyMany() {
+	if (wirehair_encode_many(m_encoders, m_messages, m_bytes, MESSAGE_COUNT, BLOCK_BYTES) != MESSAGE_COUNT) {
+		return false;
+	}
+
+	u8 expected[BLOCK_BYTES], block[BLOCK_BYTES];
+	bool success = true;
+
+	for (int ii = 0; ii < MESSAGE_COUNT && success; ++ii) {
+		wirehair_state encoder = wirehair_encode(0, m_messages[ii], m_bytes[ii], BLOCK_BYTES);
+
+		for (u32 id = 0; id < 300; ++id) {
+			wirehair_write(encoder, id, expected);
+			wirehair_write(m_encoders[ii], id, block);
+
+			if (memcmp(expected, block, BLOCK_BYTES)) {
+				success = false;
+				break;
+			}
+		}
+
+		wirehair_free(encoder);
+	}
+
+	FreeEncoders();
+
+	return success;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	Abyssinian prng;
+	prng.Initialize(0);
+
+	// Generate messages
+	for (int ii = 0; ii < MESSAGE_COUNT; ++ii) {
+		int N = 2 + prng.Next() % (MAX_N - 1);
+		int bytes = N * BLOCK_BYTES - prng.Next() % BLOCK_BYTES;
+
+		u8 *message = new u8[bytes];
+		for (int jj = 0; jj < bytes; ++jj) {
+			message[jj] = (u8)prng.Next();
+		}
+
+		m_messages[ii] = message;
+		m_bytes[ii] = bytes;
+	}
+
+	bool success = BenchmarkSingle() &&
+		BenchmarkMany("wirehair_encode_many, serial") &&
+		VerifyMany();
+
+	// Start executor
+	pthread_t threads[WORKERS - 1];
+	for (int ii = 0; ii < WORKERS - 1; ++ii) {
+		pthread_create(&threads[ii], 0, WorkerThread, 0);
+	}
+
+	wirehair_executor executor = { 0, WORKERS, Submit, Wait };
+	wirehair_set_executor(&executor);
+
+	success = success &&
+		BenchmarkMany("wirehair_encode_many, 4 workers") &&
+		VerifyMany();
+
+	wirehair_set_executor(0);
+
+	// Stop executor
+	pthread_mutex_lock(&m_lock);
+	m_shutdown = true;
+	pthread_cond_broadcast(&m_queued);
+	pthread_mutex_unlock(&m_lock);
+
+	for (int ii = 0; ii < WORKERS - 1; ++ii) {
+		pthread_join(threads[ii], 0);
+	}
+
+	wirehair_pool_flush();
+
+	for (int ii = 0; ii < MESSAGE_COUNT; ++ii) {
+		delete [](u8 *)m_messages[ii];
+	}
+
+	m_clock.OnFinalize();
+
+	if (!success) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,717 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Message parameters
+const int N = 1000;
+const int BLOCK_BYTES = 1300;
+
+// Number of block ids to check, including the original N
+const int ID_COUNT = N * 4;
+
+// Number of passes over the ids in each thread
+const int ROUNDS = 4;
+
+// Largest number of threads to run
+const int MAX_THREADS = 8;
+
+// Number of worker threads for the executor
+const int WORKERS = 4;
+
+// Number of precomputed blocks in the repair ring
+const int RING_SIZE = 64;
+
+// Number of times to retry a block that is not ready yet before giving up
+const int MAX_SPINS = 10000000;
+
+
+//// Shared state
+
+static wirehair_state m_encoder = 0;
+static u8 *m_message = 0;
+static u8 *m_expected = 0;
+
+
+//// Worker thread
+
+struct Worker {
+	pthread_t thread;
+	int index, count;
+	u32 mismatches;
+	u32 decode_failures;
+};
+
+static void *WorkerThread(void *param) {
+	Worker *worker = reinterpret_cast<Worker *>( param );
+	u8 block[BLOCK_BYTES];
+
+	// Write every count'th block id from the shared encoder
+	for (int round = 0; round < ROUNDS; ++round) {
+		for (int id = worker->index; id < ID_COUNT; id += worker->count) {
+			if (!wirehair_write(m_encoder, id, block) ||
+				memcmp(block, m_expected + id * BLOCK_BYTES, BLOCK_BYTES)) {
+				++worker->mismatches;
+			}
+		}
+	}
+
+	// Decode the message from blocks written while the other threads write too
+	Abyssinian prng;
+	prng.Initialize(worker->index, worker->count);
+
+	u8 *message_out = new u8[N * BLOCK_BYTES];
+	wirehair_state decoder = wirehair_decode(0, N * BLOCK_BYTES, BLOCK_BYTES);
+
+	bool decoded = false;
+	for (u32 id = 0; decoder && id < 0x10000; ++id) {
+		// 50% packetloss to randomize received message IDs
+		if (prng.Next() & 1) continue;
+
+		wirehair_write(m_encoder, id, block);
+
+		if (wirehair_read(decoder, id, block)) {
+			decoded = wirehair_reconstruct(decoder, message_out) &&
+				!memcmp(message_out, m_message, N * BLOCK_BYTES);
+			break;
+		}
+	}
+
+	if (!decoded) {
+		++worker->decode_failures;
+	}
+
+	wirehair_free(decoder);
+	delete []message_out;
+
+	return 0;
+}
+
+
+//// Deposit thread
+
+static wirehair_state m_decoder = 0;
+
+static void *DepositThread(void *param) {
+	Worker *worker = reinterpret_cast<Worker *>( param );
+
+	Abyssinian prng;
+	prng.Initialize(worker->index + 100, worker->count);
+
+	// Deposit every count'th block id into the shared decoder until it is done
+	for (int id = worker->index; id < ID_COUNT; id += worker->count) {
+		// 50% packetloss to randomize received message IDs
+		if (prng.Next() & 1) continue;
+
+		if (wirehair_deposit(m_decoder, id, m_expected + id * BLOCK_BYTES)) {
+			return 0;
+		}
+	}
+
+	++worker->decode_failures;
+
+	return 0;
+}
+
+
+//// Executor: A fixed pool of threads sharing one task queue
+
+/*
+	Background tasks from the repair ring and wirehair_decode_async() can
+	be queued while a batch runs, so wait() counts the tasks of each job
+	apart and only waits for the job it is given.  Batches are never
+	nested, so a wait() from inside a task is counted as a failure.
+*/
+
+struct Task {
+	wirehair_task task;
+	void *job;
+	int index;
+};
+
+struct Job {
+	void *job;
+	int pending;
+};
+
+const int MAX_TASKS = 1024;
+const int MAX_JOBS = 64;
+
+static pthread_mutex_t m_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t m_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t m_finished = PTHREAD_COND_INITIALIZER;
+static Task m_queue[MAX_TASKS];
+static int m_queue_head = 0, m_queue_count = 0;
+static Job m_jobs[MAX_JOBS];
+static bool m_shutdown = false;
+
+// Does wait() run queued tasks on the calling thread?
+static bool m_wait_helps = true;
+
+// Number of wait() calls made from inside a task
+static int m_nested_waits = 0;
+
+// Number of tasks running on this thread
+static __thread int m_task_depth = 0;
+
+static pthread_t m_threads[WORKERS];
+static int m_thread_count = 0;
+
+// Find the pending count of a job, with the lock held
+static Job *FindJob(void *job) {
+	Job *free_job = 0;
+
+	for (int ii = 0; ii < MAX_JOBS; ++ii) {
+		if (m_jobs[ii].pending > 0 && m_jobs[ii].job == job) {
+			return &m_jobs[ii];
+		}
+		if (!free_job && m_jobs[ii].pending == 0) {
+			free_job = &m_jobs[ii];
+		}
+	}
+
+	free_job->job = job;
+	return free_job;
+}
+
+// Run one queued task, with the lock held on entry and on return
+static void RunQueuedTask() {
+	Task task = m_queue[m_queue_head];
+	m_queue_head = (m_queue_head + 1) % MAX_TASKS;
+	--m_queue_count;
+
+	pthread_mutex_unlock(&m_lock);
+	++m_task_depth;
+	task.task(task.job, task.index);
+	--m_task_depth;
+	pthread_mutex_lock(&m_lock);
+
+	if (--FindJob(task.job)->pending == 0) {
+		pthread_cond_broadcast(&m_finished);
+	}
+}
+
+static void *ExecutorThread(void *) {
+	pthread_mutex_lock(&m_lock);
+
+	while (!m_shutdown) {
+		if (m_queue_count > 0) {
+			RunQueuedTask();
+		} else {
+			pthread_cond_wait(&m_queued, &m_lock);
+		}
+	}
+
+	pthread_mutex_unlock(&m_lock);
+
+	return 0;
+}
+
+static void Submit(void *, wirehair_task task, void *job, int index, unsigned int) {
+	pthread_mutex_lock(&m_lock);
+
+	Task &entry = m_queue[(m_queue_head + m_queue_count++) % MAX_TASKS];
+	entry.task = task;
+	entry.job = job;
+	entry.index = index;
+	++FindJob(job)->pending;
+
+	pthread_cond_signal(&m_queued);
+	pthread_mutex_unlock(&m_lock);
+}
+
+static void Wait(void *, void *job) {
+	pthread_mutex_lock(&m_lock);
+
+	if (m_task_depth > 0) {
+		++m_nested_waits;
+	}
+
+	// Help run tasks from the calling thread, if enabled
+	while (FindJob(job)->pending > 0) {
+		if (m_wait_helps && m_queue_count > 0) {
+			RunQueuedTask();
+		} else {
+			pthread_cond_wait(&m_finished, &m_lock);
+		}
+	}
+
+	pthread_mutex_unlock(&m_lock);
+}
+
+// Start thread_count threads, and set an executor that runs worker_count tasks at once
+static void StartExecutor(int thread_count, int worker_count, bool wait_helps) {
+	m_shutdown = false;
+	m_wait_helps = wait_helps;
+	m_nested_waits = 0;
+
+	m_thread_count = thread_count;
+	for (int ii = 0; ii < thread_count; ++ii) {
+		pthread_create(&m_threads[ii], 0, ExecutorThread, 0);
+	}
+
+	wirehair_executor executor = { 0, worker_count, Submit, Wait };
+	wirehair_set_executor(&executor);
+}
+
+// Stop the executor threads, returning the number of nested waits
+static int StopExecutor() {
+	wirehair_set_executor(0);
+
+	pthread_mutex_lock(&m_lock);
+	m_shutdown = true;
+	pthread_cond_broadcast(&m_queued);
+	pthread_mutex_unlock(&m_lock);
+
+	for (int ii = 0; ii < m_thread_count; ++ii) {
+		pthread_join(m_threads[ii], 0);
+	}
+
+	return m_nested_waits;
+}
+
+
+//// Repair ring
+
+static wirehair_state m_ring_encoder = 0;
+static bool m_writing = false;
+
+static bool Writing() {
+	pthread_mutex_lock(&m_lock);
+	bool writing = m_writing;
+	pthread_mutex_unlock(&m_lock);
+
+	return writing;
+}
+
+static void *RingThread(void *param) {
+	Worker *worker = reinterpret_cast<Worker *>( param );
+	u8 block[BLOCK_BYTES];
+
+	// Write every count'th repair id, so the ring is read out of order
+	for (int id = N + worker->index; id < ID_COUNT; id += worker->count) {
+		if (!wirehair_write(m_ring_encoder, id, block) ||
+			memcmp(block, m_expected + id * BLOCK_BYTES, BLOCK_BYTES)) {
+			++worker->mismatches;
+		}
+	}
+
+	return 0;
+}
+
+static void *RefillThread(void *) {
+	// Fill the free slots again from a thread owned by the application
+	while (Writing()) {
+		wirehair_precompute(m_ring_encoder, N, RING_SIZE);
+		sched_yield();
+	}
+
+	return 0;
+}
+
+// Read the ring in order with wirehair_peek() and wirehair_pop()
+static bool PeekRing(bool refill) {
+	for (u32 next_id = N; next_id < (u32)ID_COUNT; ++next_id) {
+		unsigned int id = 0;
+		const void *block = 0;
+
+		for (int spins = 0; spins < MAX_SPINS; ++spins) {
+			block = wirehair_peek(m_ring_encoder, &id);
+			if (block) {
+				break;
+			}
+
+			// Without an executor, the caller fills the ring
+			if (refill) {
+				wirehair_precompute(m_ring_encoder, N, RING_SIZE);
+			} else {
+				sched_yield();
+			}
+		}
+
+		if (!block || id != next_id || memcmp(block, m_expected + id * BLOCK_BYTES, BLOCK_BYTES)) {
+			return false;
+		}
+
+		wirehair_pop(m_ring_encoder);
+	}
+
+	return true;
+}
+
+// Compare blocks written from a precompute ring with an encoder that has none
+static int TestRing(const char *name, bool refill) {
+	int failures = 0;
+
+	m_ring_encoder = wirehair_encode(0, m_message, N * BLOCK_BYTES, BLOCK_BYTES);
+	if (!m_ring_encoder) {
+		cout << "wirehair_encode failed" << endl;
+		return 1;
+	}
+
+	for (int count = 1; count <= MAX_THREADS; count *= 2) {
+		Worker workers[MAX_THREADS];
+		pthread_t refill_thread;
+
+		// Start a new ring at the first repair id
+		if (!wirehair_precompute(m_ring_encoder, N, 0) ||
+			!wirehair_precompute(m_ring_encoder, N, RING_SIZE)) {
+			cout << "wirehair_precompute failed" << endl;
+			return 1;
+		}
+
+		m_writing = true;
+		if (refill) {
+			pthread_create(&refill_thread, 0, RefillThread, 0);
+		}
+
+		for (int ii = 0; ii < count; ++ii) {
+			workers[ii].index = ii;
+			workers[ii].count = count;
+			workers[ii].mismatches = 0;
+			pthread_create(&workers[ii].thread, 0, RingThread, &workers[ii]);
+		}
+
+		u32 mismatches = 0;
+		for (int ii = 0; ii < count; ++ii) {
+			pthread_join(workers[ii].thread, 0);
+			mismatches += workers[ii].mismatches;
+		}
+
+		pthread_mutex_lock(&m_lock);
+		m_writing = false;
+		pthread_mutex_unlock(&m_lock);
+		if (refill) {
+			pthread_join(refill_thread, 0);
+		}
+
+		cout << "wirehair_write with " << name << " from " << count << " threads: " << mismatches << " mismatched blocks" << endl;
+
+		if (mismatches) {
+			++failures;
+		}
+	}
+
+	// Start a new ring and read it in order without copying
+	wirehair_precompute(m_ring_encoder, N, 0);
+	wirehair_precompute(m_ring_encoder, N, RING_SIZE);
+
+	bool matched = PeekRing(refill);
+
+	cout << "wirehair_peek with " << name << ": " << (matched ? "matched" : "failed") << endl;
+
+	if (!matched) {
+		++failures;
+	}
+
+	wirehair_free(m_ring_encoder);
+	m_ring_encoder = 0;
+
+	return failures;
+}
+
+
+//// Asynchronous decode
+
+static pthread_cond_t m_solved_cond = PTHREAD_COND_INITIALIZER;
+static int m_solved_count = 0;
+static int m_solved_success = 0;
+
+static void OnSolved(void *, int success) {
+	pthread_mutex_lock(&m_lock);
+
+	++m_solved_count;
+	if (success) {
+		++m_solved_success;
+	}
+
+	pthread_cond_broadcast(&m_solved_cond);
+	pthread_mutex_unlock(&m_lock);
+}
+
+static int SolvedCount() {
+	pthread_mutex_lock(&m_lock);
+	int count = m_solved_count;
+	pthread_mutex_unlock(&m_lock);
+
+	return count;
+}
+
+static void *AsyncDepositThread(void *param) {
+	Worker *worker = reinterpret_cast<Worker *>( param );
+
+	Abyssinian prng;
+	prng.Initialize(worker->index + 200, worker->count);
+
+	// Deposit every count'th block id until the callback runs
+	for (int id = worker->index; id < ID_COUNT && !SolvedCount(); id += worker->count) {
+		// 50% packetloss to randomize received message IDs
+		if (prng.Next() & 1) continue;
+
+		wirehair_deposit(m_decoder, id, m_expected + id * BLOCK_BYTES);
+	}
+
+	return 0;
+}
+
+// Start a background solve on the decoder, with the callback counts cleared
+static bool StartAsync() {
+	pthread_mutex_lock(&m_lock);
+	m_solved_count = 0;
+	m_solved_success = 0;
+	pthread_mutex_unlock(&m_lock);
+
+	return wirehair_decode_async(m_decoder, OnSolved, 0) != 0;
+}
+
+// Deposit the first N repair blocks so that the last one starts a solve
+static void DepositRepairBlocks() {
+	for (int id = N; id < N * 2; ++id) {
+		wirehair_deposit(m_decoder, id, m_expected + id * BLOCK_BYTES);
+	}
+}
+
+static int TestAsync(u8 *message_out) {
+	int failures = 0;
+	const int bytes = N * BLOCK_BYTES;
+
+	for (int count = 1; count <= MAX_THREADS; count *= 2) {
+		Worker workers[MAX_THREADS];
+
+		m_decoder = wirehair_decode(m_decoder, bytes, BLOCK_BYTES);
+		if (!m_decoder || !StartAsync()) {
+			cout << "wirehair_decode_async failed" << endl;
+			return 1;
+		}
+
+		for (int ii = 0; ii < count; ++ii) {
+			workers[ii].index = ii;
+			workers[ii].count = count;
+			pthread_create(&workers[ii].thread, 0, AsyncDepositThread, &workers[ii]);
+		}
+
+		for (int ii = 0; ii < count; ++ii) {
+			pthread_join(workers[ii].thread, 0);
+		}
+
+		// Blocks may all be in before the worker is done solving
+		pthread_mutex_lock(&m_lock);
+		while (m_solved_count == 0) {
+			pthread_cond_wait(&m_solved_cond, &m_lock);
+		}
+		bool solved = m_solved_count == 1 && m_solved_success == 1;
+		pthread_mutex_unlock(&m_lock);
+
+		bool decoded = solved &&
+			wirehair_reconstruct(m_decoder, message_out) &&
+			!memcmp(message_out, m_message, bytes);
+
+		cout << "wirehair_decode_async from " << count << " threads: " << (decoded ? "decoded" : "failed") << endl;
+
+		if (!decoded) {
+			++failures;
+		}
+	}
+
+	// Reset while the worker is solving, then decode the next message serially
+	m_decoder = wirehair_decode(m_decoder, bytes, BLOCK_BYTES);
+	bool decoded = m_decoder && StartAsync();
+	if (decoded) {
+		DepositRepairBlocks();
+
+		decoded = wirehair_decode_reset(m_decoder) && SolvedCount() <= 1;
+
+		bool complete = false;
+		for (int id = 0; decoded && !complete && id < ID_COUNT; id += 2) {
+			complete = wirehair_read(m_decoder, id, m_expected + id * BLOCK_BYTES) != 0;
+		}
+
+		decoded = complete &&
+			wirehair_reconstruct(m_decoder, message_out) &&
+			!memcmp(message_out, m_message, bytes);
+	}
+
+	cout << "wirehair_decode_reset during a background solve: " << (decoded ? "decoded" : "failed") << endl;
+
+	if (!decoded) {
+		++failures;
+	}
+
+	// Free while the worker is solving
+	m_decoder = wirehair_decode(m_decoder, bytes, BLOCK_BYTES);
+	if (!m_decoder || !StartAsync()) {
+		cout << "wirehair_decode_async failed" << endl;
+		return failures + 1;
+	}
+
+	DepositRepairBlocks();
+
+	wirehair_free(m_decoder);
+	m_decoder = 0;
+
+	cout << "wirehair_free during a background solve: " << SolvedCount() << " callbacks" << endl;
+
+	if (SolvedCount() > 1) {
+		++failures;
+	}
+
+	return failures;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	Abyssinian prng;
+	prng.Initialize(0);
+
+	// Fill input message with random data
+	const int bytes = N * BLOCK_BYTES;
+	m_message = new u8[bytes];
+	for (int ii = 0; ii < bytes; ++ii) {
+		m_message[ii] = (u8)prng.Next();
+	}
+
+	// Share one encoder between all threads, without the solver memory
+	m_encoder = wirehair_encode(0, m_message, bytes, BLOCK_BYTES);
+	if (!m_encoder || !wirehair_trim(m_encoder)) {
+		cout << "wirehair_encode failed" << endl;
+		return 1;
+	}
+
+	// Generate expected blocks on one thread
+	m_expected = new u8[ID_COUNT * BLOCK_BYTES];
+	for (int id = 0; id < ID_COUNT; ++id) {
+		wirehair_write(m_encoder, id, m_expected + id * BLOCK_BYTES);
+	}
+
+	int failures = 0;
+
+	for (int count = 1; count <= MAX_THREADS; count *= 2) {
+		Worker workers[MAX_THREADS];
+
+		double t0 = m_clock.usec();
+
+		for (int ii = 0; ii < count; ++ii) {
+			workers[ii].index = ii;
+			workers[ii].count = count;
+			workers[ii].mismatches = 0;
+			workers[ii].decode_failures = 0;
+			pthread_create(&workers[ii].thread, 0, WorkerThread, &workers[ii]);
+		}
+
+		u32 mismatches = 0, decode_failures = 0;
+		for (int ii = 0; ii < count; ++ii) {
+			pthread_join(workers[ii].thread, 0);
+			mismatches += workers[ii].mismatches;
+			decode_failures += workers[ii].decode_failures;
+		}
+
+		double t1 = m_clock.usec();
+
+		// Includes the decoders, so it is a lower bound on write throughput
+		double written = (double)ROUNDS * ID_COUNT * BLOCK_BYTES + (double)count * bytes * 2;
+		cout << "wirehair_write from " << count << " threads: " << mismatches << " mismatched blocks, " << decode_failures << " failed decodes, " << written / (t1 - t0) << " MB/s" << endl;
+
+		if (mismatches || decode_failures) {
+			++failures;
+		}
+	}
+
+	u8 *message_out = new u8[bytes];
+
+	for (int count = 1; count <= MAX_THREADS; count *= 2) {
+		Worker workers[MAX_THREADS];
+
+		m_decoder = wirehair_decode(m_decoder, bytes, BLOCK_BYTES);
+		if (!m_decoder) {
+			cout << "wirehair_decode failed" << endl;
+			return 1;
+		}
+
+		double t0 = m_clock.usec();
+
+		for (int ii = 0; ii < count; ++ii) {
+			workers[ii].index = ii;
+			workers[ii].count = count;
+			workers[ii].mismatches = 0;
+			workers[ii].decode_failures = 0;
+			pthread_create(&workers[ii].thread, 0, DepositThread, &workers[ii]);
+		}
+
+		// The decode succeeded if any thread saw it finish
+		u32 decode_failures = 0;
+		for (int ii = 0; ii < count; ++ii) {
+			pthread_join(workers[ii].thread, 0);
+			decode_failures += workers[ii].decode_failures;
+		}
+
+		double t1 = m_clock.usec();
+
+		bool decoded = decode_failures < (u32)count &&
+			wirehair_reconstruct(m_decoder, message_out) &&
+			!memcmp(message_out, m_message, bytes);
+
+		cout << "wirehair_deposit from " << count << " threads: " << (decoded ? "decoded" : "failed") << ", " << bytes / (t1 - t0) << " MB/s" << endl;
+
+		if (!decoded) {
+			++failures;
+		}
+	}
+
+	// Caller-driven repair ring
+	failures += TestRing("caller-filled ring", true);
+
+	// Executor with the calling thread helping
+	StartExecutor(WORKERS - 1, WORKERS, true);
+
+	failures += TestRing("executor-filled ring", false);
+	failures += TestAsync(message_out);
+
+	int nested_waits = StopExecutor();
+
+	// One thread and a wait() that only blocks, so a nested batch could never finish
+	StartExecutor(1, 2, false);
+
+	failures += TestAsync(message_out);
+
+	nested_waits += StopExecutor();
+
+	cout << "wait() from inside a task: " << nested_waits << " times" << endl;
+
+	if (nested_waits) {
+		++failures;
+	}
+
+	wirehair_free(m_decoder);
+	delete []message_out;
+
+	wirehair_free(m_encoder);
+	delete []m_expected;
+	delete []m_message;
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
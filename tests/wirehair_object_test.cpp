@@ -0,0 +1,275 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Largest segment, which is the largest N of a single state object
+const u32 SEGMENT_MAX_N = 64000;
+
+// Percentage of the original blocks lost on the way, for the segment that runs short and the others
+const int SHORT_LOSS_PERCENT = 20;
+const int LOSS_PERCENT = 5;
+
+// Repair blocks sent for each segment beyond the ones it lost, and then added each time decoding fails
+const u32 REPAIR_MARGIN = 8;
+const int MAX_ROUNDS = 20;
+
+struct Case {
+	u32 block_count;		// N
+	int block_bytes;
+	int final_bytes;		// Bytes in the last block of the object
+};
+
+static const Case CASES[] = {
+	{ 1000, 20, 20 },		// One segment
+	{ 64001, 16, 9 },		// Two segments of 32001 and 32000 blocks
+	{ 128051, 10, 3 },		// Three segments, two of them one block longer than the third
+	{ 192000, 10, 10 },		// Three segments of the same size
+};
+
+
+//// Object
+
+static Abyssinian m_prng;
+static wirehair_object m_encoder = 0;
+static u8 *m_object = 0;
+static u8 *m_object_out = 0;
+static size_t m_bytes;
+static u32 m_n, m_segment_count;
+static int m_block_bytes;
+
+// Received blocks
+static vector<u32> m_ids;
+static vector<u8> m_data;
+
+// Next block index of each segment to send as a repair block
+static vector<u32> m_next_repair;
+
+// Find each segment from the offsets of ids 0..S-1, which are their first blocks, and check
+// that the sizes differ by at most one block with the longer segments first
+static bool CheckSegments(const Case &c) {
+	m_segment_count = (m_n + SEGMENT_MAX_N - 1) / SEGMENT_MAX_N;
+
+	u32 smallest = SEGMENT_MAX_N, largest = 0, previous = SEGMENT_MAX_N;
+	size_t end = m_bytes;
+
+	for (int segment_i = (int)m_segment_count - 1; segment_i >= 0; --segment_i) {
+		size_t offset;
+		if (!wirehair_object_offset(m_encoder, segment_i, &offset)) {
+			return false;
+		}
+
+		const u32 blocks = (u32)((end - offset + m_block_bytes - 1) / m_block_bytes);
+		end = offset;
+
+		if (segment_i == 0 && offset != 0) {
+			return false;
+		}
+		if (segment_i < (int)m_segment_count - 1 && blocks < previous) {
+			return false;
+		}
+		previous = blocks;
+
+		if (smallest > blocks) {
+			smallest = blocks;
+		}
+		if (largest < blocks) {
+			largest = blocks;
+		}
+	}
+
+	cout << "N = " << m_n << ", block_bytes = " << c.block_bytes << ": " << m_segment_count
+		<< " segments of " << smallest << ".." << largest << " blocks" << endl;
+
+	return largest <= SEGMENT_MAX_N && largest - smallest <= 1;
+}
+
+// Check that each original id writes the block at its offset, that every block
+// of the object has one id, and that repair ids have no offset
+static bool CheckOffsets() {
+	vector<bool> seen(m_n, false);
+	u8 block[32];
+
+	for (u32 id = 0; id < m_n; ++id) {
+		size_t offset;
+		if (!wirehair_object_offset(m_encoder, id, &offset) ||
+			offset % m_block_bytes != 0 || offset >= m_bytes || seen[offset / m_block_bytes]) {
+			return false;
+		}
+		seen[offset / m_block_bytes] = true;
+
+		const size_t bytes = m_bytes - offset < (size_t)m_block_bytes ? m_bytes - offset : m_block_bytes;
+
+		if (!wirehair_object_write(m_encoder, id, block) || memcmp(block, m_object + offset, bytes)) {
+			return false;
+		}
+	}
+
+	size_t offset;
+	return !wirehair_object_offset(m_encoder, m_n, &offset) &&
+		!wirehair_object_offset(m_encoder, m_n + m_segment_count, &offset) &&
+		!wirehair_object_offset(m_encoder, 0xffffffff, &offset) &&
+		!wirehair_object_offset(0, 0, &offset) &&
+		!wirehair_object_offset(m_encoder, 0, 0);
+}
+
+static void Receive(u32 id) {
+	m_ids.push_back(id);
+	m_data.resize(m_ids.size() * m_block_bytes);
+
+	wirehair_object_write(m_encoder, id, &m_data[(m_ids.size() - 1) * m_block_bytes]);
+}
+
+// Send repair blocks for one segment
+static void ReceiveRepair(u32 segment_i, u32 count) {
+	for (u32 ii = 0; ii < count; ++ii) {
+		Receive(m_next_repair[segment_i]++ * m_segment_count + segment_i);
+	}
+}
+
+static bool Decode() {
+	vector<const void *> blocks(m_ids.size());
+	for (size_t ii = 0; ii < m_ids.size(); ++ii) {
+		blocks[ii] = &m_data[ii * m_block_bytes];
+	}
+
+	return wirehair_object_decode(m_bytes, m_block_bytes, &m_ids[0], &blocks[0], (u32)m_ids.size(), m_object_out) != 0;
+}
+
+static bool TestObject(const Case &c) {
+	m_n = c.block_count;
+	m_block_bytes = c.block_bytes;
+	m_bytes = (size_t)(m_n - 1) * m_block_bytes + c.final_bytes;
+
+	// Exactly the object, so writing past the end of it is caught
+	m_object = new u8[m_bytes];
+	m_object_out = new u8[m_bytes];
+
+	for (size_t ii = 0; ii < m_bytes; ++ii) {
+		m_object[ii] = (u8)m_prng.Next();
+	}
+
+	double t0 = m_clock.usec();
+	m_encoder = wirehair_object_encode(m_object, m_bytes, m_block_bytes);
+	double t1 = m_clock.usec();
+
+	bool success = m_encoder && wirehair_object_count(m_encoder) == m_n;
+
+	if (success && !CheckSegments(c)) {
+		cout << "Segment sizes are wrong" << endl;
+		success = false;
+	}
+	if (success && !CheckOffsets()) {
+		cout << "wirehair_object_offset() does not match the written blocks" << endl;
+		success = false;
+	}
+
+	// The last segment is short of blocks, and the others make up for it in total
+	const u32 short_i = m_segment_count - 1;
+	vector<u32> lost(m_segment_count, 0);
+	u32 lost_total = 0;
+
+	m_ids.clear();
+	m_data.clear();
+
+	for (u32 id = 0; success && id < m_n; ++id) {
+		const u32 segment_i = id % m_segment_count;
+
+		if ((int)(m_prng.Next() % 100) < (segment_i == short_i ? SHORT_LOSS_PERCENT : LOSS_PERCENT)) {
+			++lost[segment_i];
+			++lost_total;
+		} else {
+			Receive(id);
+		}
+	}
+
+	// Share of the blocks lost from the short segment that each of the others sends on top
+	const u32 share = m_segment_count > 1 ? lost[short_i] / (m_segment_count - 1) + 1 : 0;
+
+	m_next_repair.resize(m_segment_count);
+	for (u32 segment_i = 0; success && segment_i < m_segment_count; ++segment_i) {
+		m_next_repair[segment_i] = m_n / m_segment_count + (segment_i < m_n % m_segment_count);
+
+		if (segment_i != short_i) {
+			ReceiveRepair(segment_i, lost[segment_i] + REPAIR_MARGIN + share);
+		}
+	}
+
+	double t2 = m_clock.usec();
+
+	if (success && Decode()) {
+		cout << "Decoded with segment " << short_i << " short of blocks" << endl;
+		success = false;
+	}
+
+	// Then send repair blocks for the short segment until it decodes
+	int rounds = 0;
+	bool decoded = false;
+
+	if (success) {
+		ReceiveRepair(short_i, lost[short_i] + REPAIR_MARGIN);
+
+		for (; rounds < MAX_ROUNDS && !decoded; ++rounds) {
+			decoded = Decode();
+
+			for (u32 segment_i = 0; !decoded && segment_i < m_segment_count; ++segment_i) {
+				ReceiveRepair(segment_i, REPAIR_MARGIN);
+			}
+		}
+
+		success = decoded && !memcmp(m_object_out, m_object, m_bytes);
+	}
+
+	double t3 = m_clock.usec();
+
+	cout << "Lost " << lost_total << " of " << m_n << " original blocks, " << lost[short_i]
+		<< " in segment " << short_i << ": " << (success ? "decoded" : "failed") << " from " << m_ids.size()
+		<< " blocks in " << rounds + 1 << " calls, encode " << (t1 - t0) << " usec, decode "
+		<< (t3 - t2) / (rounds + 1) << " usec" << endl;
+
+	wirehair_object_free(m_encoder);
+	m_encoder = 0;
+	delete []m_object;
+	delete []m_object_out;
+
+	return success;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	m_prng.Initialize(0);
+
+	int failures = 0;
+
+	for (int ii = 0; ii < (int)(sizeof(CASES) / sizeof(CASES[0])); ++ii) {
+		if (!TestObject(CASES[ii])) {
+			++failures;
+		}
+	}
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
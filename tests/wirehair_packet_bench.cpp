@@ -0,0 +1,285 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Number of frames to protect
+const int FRAME_COUNT = 2000;
+
+// Video packets are MTU-sized except for the last one of each frame
+const int MIN_VIDEO_PACKETS = 2;
+const int MAX_VIDEO_PACKETS = 40;
+const int VIDEO_BYTES = 1200;
+
+// Audio packets that go out along with each frame
+const int MAX_AUDIO_PACKETS = 3;
+const int MIN_AUDIO_BYTES = 60;
+const int MAX_AUDIO_BYTES = 200;
+
+const int MAX_PACKETS = MAX_VIDEO_PACKETS + MAX_AUDIO_PACKETS;
+
+// Percentage of packets lost on the way
+const int LOSS_PERCENT = 10;
+
+
+//// Frames
+
+struct Frame {
+	int count;
+	const void *packets[MAX_PACKETS];
+	unsigned int bytes[MAX_PACKETS];
+	bool lost[MAX_PACKETS];
+};
+
+static Frame m_frames[FRAME_COUNT];
+
+// Packet buffers for the receiver
+static u8 m_packet[65536];
+static u8 m_block[65536];
+
+
+//// Benchmark
+
+struct Stats {
+	double encode_usec;
+	double decode_usec;
+	u64 source_bytes;	// Bytes of the packets
+	u64 coded_bytes;	// Bytes of the message that is encoded
+	u64 table_bytes;	// Bytes of table packets sent
+	u64 lost_bytes;		// Bytes of the packets that were lost
+	u64 repair_bytes;	// Bytes of repair blocks needed to recover them
+};
+
+static void Report(const char *name, const Stats &stats) {
+	cout << name << ": encode " << stats.encode_usec / FRAME_COUNT << " usec/frame, decode "
+		<< stats.decode_usec / FRAME_COUNT << " usec/frame, coded "
+		<< 100. * stats.coded_bytes / stats.source_bytes << "% of source, table "
+		<< 100. * stats.table_bytes / stats.source_bytes << "% of source, repair "
+		<< 100. * stats.repair_bytes / stats.lost_bytes << "% of lost bytes" << endl;
+}
+
+// Every packet padded out to a whole block, one packet per block
+static bool BenchmarkPadded(Stats &stats) {
+	memset(&stats, 0, sizeof(stats));
+
+	static u8 message[MAX_PACKETS * VIDEO_BYTES];
+
+	for (int ii = 0; ii < FRAME_COUNT; ++ii) {
+		const Frame &frame = m_frames[ii];
+		const int bytes = frame.count * VIDEO_BYTES;
+
+		double t0 = m_clock.usec();
+
+		memset(message, 0, bytes);
+		for (int jj = 0; jj < frame.count; ++jj) {
+			memcpy(message + jj * VIDEO_BYTES, frame.packets[jj], frame.bytes[jj]);
+		}
+
+		wirehair_state encoder = wirehair_encode(0, message, bytes, VIDEO_BYTES);
+		if (!encoder) {
+			return false;
+		}
+
+		double t1 = m_clock.usec();
+
+		wirehair_state decoder = wirehair_decode(0, bytes, VIDEO_BYTES);
+		if (!decoder) {
+			return false;
+		}
+
+		bool complete = false;
+		for (int jj = 0; jj < frame.count && !complete; ++jj) {
+			if (!frame.lost[jj]) {
+				complete = wirehair_read(decoder, jj, message + jj * VIDEO_BYTES) != 0;
+			}
+		}
+
+		for (unsigned int id = frame.count; !complete; ++id) {
+			wirehair_write(encoder, id, m_block);
+			complete = wirehair_read(decoder, id, m_block) != 0;
+			stats.repair_bytes += VIDEO_BYTES;
+		}
+
+		for (int jj = 0; jj < frame.count; ++jj) {
+			if (frame.lost[jj]) {
+				if (!wirehair_reconstruct_block(decoder, jj, m_block) ||
+					memcmp(m_block, frame.packets[jj], frame.bytes[jj])) {
+					return false;
+				}
+			}
+		}
+
+		double t2 = m_clock.usec();
+
+		wirehair_free(encoder);
+		wirehair_free(decoder);
+
+		stats.encode_usec += t1 - t0;
+		stats.decode_usec += t2 - t1;
+		stats.coded_bytes += bytes;
+	}
+
+	return true;
+}
+
+// Packets packed back to back behind a length table that is sent in table packets
+static bool BenchmarkPacked(Stats &stats, int block_bytes) {
+	memset(&stats, 0, sizeof(stats));
+
+	// Table packets are lost as often as the others
+	Abyssinian prng;
+	prng.Initialize(1);
+
+	for (int ii = 0; ii < FRAME_COUNT; ++ii) {
+		const Frame &frame = m_frames[ii];
+
+		double t0 = m_clock.usec();
+
+		wirehair_packets encoder = wirehair_packets_encode(frame.packets, frame.bytes, frame.count, block_bytes);
+		if (!encoder) {
+			return false;
+		}
+
+		double t1 = m_clock.usec();
+
+		const size_t message_bytes = wirehair_packets_message_bytes(encoder);
+
+		wirehair_packets decoder = wirehair_packets_decoder(message_bytes, frame.count, block_bytes);
+		if (!decoder) {
+			return false;
+		}
+
+		bool complete = false;
+		const unsigned int table_count = wirehair_packets_table_count(encoder);
+		for (unsigned int jj = 0; jj < table_count; ++jj) {
+			unsigned int bytes;
+			if (!wirehair_packets_table(encoder, jj, m_packet, &bytes)) {
+				return false;
+			}
+			stats.table_bytes += bytes;
+
+			if ((int)(prng.Next() % 100) >= LOSS_PERCENT) {
+				complete = wirehair_packets_read_table(decoder, jj, m_packet, bytes) != 0;
+			}
+		}
+		for (int jj = 0; jj < frame.count; ++jj) {
+			if (!frame.lost[jj]) {
+				complete = wirehair_packets_read(decoder, jj, wirehair_packets_offset(encoder, jj), frame.packets[jj], frame.bytes[jj]) != 0;
+			}
+		}
+
+		for (unsigned int index = 0; !complete; ++index) {
+			wirehair_packets_repair(encoder, index, m_block);
+			complete = wirehair_packets_read_repair(decoder, index, m_block) != 0;
+			stats.repair_bytes += block_bytes;
+		}
+
+		for (int jj = 0; jj < frame.count; ++jj) {
+			if (frame.lost[jj]) {
+				unsigned int bytes;
+				if (!wirehair_packets_recover(decoder, jj, m_packet, &bytes) ||
+					bytes != frame.bytes[jj] || memcmp(m_packet, frame.packets[jj], bytes)) {
+					return false;
+				}
+			}
+		}
+
+		double t2 = m_clock.usec();
+
+		wirehair_packets_free(encoder);
+		wirehair_packets_free(decoder);
+
+		stats.encode_usec += t1 - t0;
+		stats.decode_usec += t2 - t1;
+		stats.coded_bytes += message_bytes;
+	}
+
+	return true;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	Abyssinian prng;
+	prng.Initialize(0);
+
+	// Generate frames of video packets with a few audio packets mixed in
+	u64 source_bytes = 0, lost_bytes = 0;
+	for (int ii = 0; ii < FRAME_COUNT; ++ii) {
+		Frame &frame = m_frames[ii];
+
+		const int video_count = MIN_VIDEO_PACKETS + prng.Next() % (MAX_VIDEO_PACKETS - MIN_VIDEO_PACKETS + 1);
+		const int audio_count = prng.Next() % (MAX_AUDIO_PACKETS + 1);
+		frame.count = video_count + audio_count;
+
+		for (int jj = 0; jj < frame.count; ++jj) {
+			int bytes;
+			if (jj < video_count - 1) {
+				bytes = VIDEO_BYTES;
+			} else if (jj == video_count - 1) {
+				bytes = 1 + prng.Next() % VIDEO_BYTES;
+			} else {
+				bytes = MIN_AUDIO_BYTES + prng.Next() % (MAX_AUDIO_BYTES - MIN_AUDIO_BYTES + 1);
+			}
+
+			u8 *packet = new u8[bytes];
+			for (int kk = 0; kk < bytes; ++kk) {
+				packet[kk] = (u8)prng.Next();
+			}
+
+			frame.packets[jj] = packet;
+			frame.bytes[jj] = bytes;
+			frame.lost[jj] = (int)(prng.Next() % 100) < LOSS_PERCENT;
+
+			source_bytes += bytes;
+			if (frame.lost[jj]) {
+				lost_bytes += bytes;
+			}
+		}
+	}
+
+	Stats padded, packed_mtu, packed_small;
+
+	bool success = BenchmarkPadded(padded) &&
+		BenchmarkPacked(packed_mtu, VIDEO_BYTES) &&
+		BenchmarkPacked(packed_small, VIDEO_BYTES / 4);
+
+	if (success) {
+		padded.source_bytes = packed_mtu.source_bytes = packed_small.source_bytes = source_bytes;
+		padded.lost_bytes = packed_mtu.lost_bytes = packed_small.lost_bytes = lost_bytes;
+
+		Report("Padded, 1200-byte blocks", padded);
+		Report("Packed, 1200-byte blocks", packed_mtu);
+		Report("Packed, 300-byte blocks", packed_small);
+	}
+
+	for (int ii = 0; ii < FRAME_COUNT; ++ii) {
+		for (int jj = 0; jj < m_frames[ii].count; ++jj) {
+			delete [](u8 *)m_frames[ii].packets[jj];
+		}
+	}
+
+	m_clock.OnFinalize();
+
+	if (!success) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,261 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <pthread.h>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Message sizes, with the medium one too large for the buffers of the small one
+const int SMALL_N = 200;
+const int MEDIUM_N = 2000;
+const int LARGE_N = 4000;
+const int BLOCK_BYTES = 100;
+
+// Budget that keeps everything
+const u32 LARGE_BUDGET = 64000000;
+
+// Messages encoded by the worker thread while the budget changes
+const int THREAD_MESSAGES = 200;
+
+
+//// Allocation counting
+
+/*
+	The library allocates with new, so counting the bytes that are live
+	shows which objects the pool keeps, and counting the calls shows
+	whether an object from the pool needed any new buffers.
+*/
+
+static volatile long m_live_bytes = 0;
+static volatile long m_allocations = 0;
+
+static const size_t HEADER_BYTES = 16;
+
+void *operator new(size_t bytes) {
+	u8 *p = (u8 *)malloc(bytes + HEADER_BYTES);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+
+	*(size_t *)p = bytes;
+	__sync_fetch_and_add(&m_live_bytes, (long)bytes);
+	__sync_fetch_and_add(&m_allocations, 1);
+
+	return p + HEADER_BYTES;
+}
+
+void *operator new[](size_t bytes) {
+	return operator new(bytes);
+}
+
+void operator delete(void *ptr) throw() {
+	if (ptr) {
+		u8 *p = (u8 *)ptr - HEADER_BYTES;
+		__sync_fetch_and_sub(&m_live_bytes, (long)*(size_t *)p);
+		free(p);
+	}
+}
+
+void operator delete[](void *ptr) throw() {
+	operator delete(ptr);
+}
+
+// Sized forms, which some runtimes would otherwise send straight to free()
+void operator delete(void *ptr, size_t) throw() {
+	operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t) throw() {
+	operator delete(ptr);
+}
+
+
+//// Messages
+
+static u8 m_messages[3][LARGE_N * BLOCK_BYTES];
+static const int MESSAGE_N[3] = { SMALL_N, MEDIUM_N, LARGE_N };
+
+// First repair block of each message, written by an encoder that was not pooled
+static u8 m_expected[3][BLOCK_BYTES];
+
+static wirehair_state Encode(int message_i) {
+	return wirehair_encode(0, m_messages[message_i], MESSAGE_N[message_i] * BLOCK_BYTES, BLOCK_BYTES);
+}
+
+// Check the first repair block against the one written before pooling
+static bool Matches(wirehair_state encoder, int message_i) {
+	u8 block[BLOCK_BYTES];
+
+	return encoder && wirehair_write(encoder, MESSAGE_N[message_i], block) &&
+		!memcmp(block, m_expected[message_i], BLOCK_BYTES);
+}
+
+static int m_failures = 0;
+
+static void Check(bool ok, const char *what) {
+	if (!ok) {
+		cout << "Failed: " << what << endl;
+		++m_failures;
+	}
+}
+
+
+//// Worker thread
+
+// Encode and free messages with its own pool, and then flush it
+static void *PoolThread(void *) {
+	for (int ii = 0; ii < THREAD_MESSAGES; ++ii) {
+		wirehair_state encoder = Encode(ii % 3);
+		if (!Matches(encoder, ii % 3)) {
+			__sync_fetch_and_add(&m_failures, 1);
+		}
+		wirehair_free(encoder);
+	}
+
+	wirehair_pool_flush();
+
+	return 0;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	Abyssinian prng;
+	prng.Initialize(0);
+
+	for (int message_i = 0; message_i < 3; ++message_i) {
+		for (int ii = 0; ii < MESSAGE_N[message_i] * BLOCK_BYTES; ++ii) {
+			m_messages[message_i][ii] = (u8)prng.Next();
+		}
+	}
+
+	cout << "Checking the state object pool..." << endl;
+
+	// Without a budget, objects are freed.  This also fills the shared caches for each N
+	for (int message_i = 0; message_i < 3; ++message_i) {
+		wirehair_state encoder = Encode(message_i);
+		wirehair_write(encoder, MESSAGE_N[message_i], m_expected[message_i]);
+		wirehair_free(encoder);
+	}
+
+	const long baseline = m_live_bytes;
+
+	{
+		wirehair_state encoder = Encode(0);
+		wirehair_free(encoder);
+		Check(m_live_bytes == baseline, "an object is freed without a budget");
+	}
+
+	wirehair_pool_budget(LARGE_BUDGET);
+
+	// Release: Objects are kept in the pool
+	long before = m_live_bytes;
+	wirehair_state small = Encode(0);
+	const long small_bytes = m_live_bytes - before;
+	wirehair_state large = Encode(2);
+	const long pooled_bytes = m_live_bytes - baseline;
+
+	wirehair_free(small);
+	wirehair_free(large);
+	Check(m_live_bytes == baseline + pooled_bytes, "freed objects are kept in the pool");
+
+	// Acquire: Each N takes the pooled object that fits it best, and needs no new buffers
+	long allocations = m_allocations;
+	wirehair_state encoder = Encode(2);
+	Check(encoder == large && m_allocations == allocations, "the large object is reused for the same N");
+	Check(Matches(encoder, 2), "the reused large object encodes correctly");
+
+	allocations = m_allocations;
+	wirehair_state encoder2 = Encode(0);
+	Check(encoder2 == small && m_allocations == allocations, "the small object is reused for the same N");
+	Check(Matches(encoder2, 0), "the reused small object encodes correctly");
+
+	wirehair_free(encoder);
+	wirehair_free(encoder2);
+
+	// Across N: The small object is too small for the medium N, so the large one is taken
+	encoder = Encode(1);
+	Check(encoder == large, "the large object is reused for a smaller N");
+	Check(Matches(encoder, 1), "the reused object encodes a smaller N correctly");
+	wirehair_free(encoder);
+
+	// The small object is taken for a decoder of the small N
+	wirehair_state decoder = wirehair_decode(0, SMALL_N * BLOCK_BYTES, BLOCK_BYTES);
+	Check(decoder == small, "the small object is reused for a decoder");
+	wirehair_free(decoder);
+
+	// Flush: Nothing is kept
+	wirehair_pool_flush();
+	Check(m_live_bytes == baseline, "wirehair_pool_flush() empties the pool");
+
+	// Budget: Only the small object fits, so the large one is freed
+	wirehair_pool_budget((u32)small_bytes);
+
+	small = Encode(0);
+	large = Encode(2);
+	wirehair_free(small);
+	wirehair_free(large);
+	Check(m_live_bytes == baseline + small_bytes, "an object over the budget is freed");
+
+	encoder = Encode(0);
+	Check(encoder == small, "the object within the budget is reused");
+	wirehair_free(encoder);
+
+	wirehair_pool_flush();
+	Check(m_live_bytes == baseline, "wirehair_pool_flush() empties the pool after a smaller budget");
+
+	// Threads: Each has its own pool, while the budget changes under it
+	wirehair_pool_budget(LARGE_BUDGET);
+
+	double t0 = m_clock.usec();
+
+	pthread_t thread;
+	pthread_create(&thread, 0, PoolThread, 0);
+
+	for (int ii = 0; ii < THREAD_MESSAGES; ++ii) {
+		wirehair_pool_budget(ii % 2 ? LARGE_BUDGET : (u32)small_bytes);
+
+		encoder = Encode(ii % 3);
+		if (!Matches(encoder, ii % 3)) {
+			++m_failures;
+		}
+		wirehair_free(encoder);
+	}
+
+	pthread_join(thread, 0);
+	wirehair_pool_flush();
+
+	double t1 = m_clock.usec();
+
+	Check(m_live_bytes == baseline, "each thread flushes its own pool");
+
+	wirehair_pool_budget(0);
+
+	cout << "Pooled " << pooled_bytes << " bytes for N = " << SMALL_N << " and " << LARGE_N << ", two threads encoded "
+		<< 2 * THREAD_MESSAGES << " messages in " << (t1 - t0) / 1000 << " msec" << endl;
+
+	m_clock.OnFinalize();
+
+	if (m_failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,258 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Number of messages to decode
+const int TRIALS = 200;
+
+// Message sizes are picked at random from N = 2..MAX_N blocks
+const int MAX_N = 2000;
+const int MAX_BLOCK_BYTES = 400;
+
+// Percentage of blocks lost on the way, when not all of the original blocks arrive
+const int LOSS_PERCENT = 10;
+
+// Random ranges read from each message
+const int RANGES = 50;
+
+// Bytes after each range that must not be written
+const int GUARD_BYTES = 16;
+const u8 GUARD = 0xa5;
+
+
+//// Message
+
+static Abyssinian m_prng;
+static u8 *m_message = 0;
+static u8 *m_message_out = 0;		// Output of wirehair_reconstruct()
+static u8 *m_range = 0;				// Output of a range, followed by guard bytes
+static int m_n, m_bytes, m_block_bytes, m_final_bytes;
+
+static bool NewMessage(wirehair_state &encoder) {
+	// The GF(2^16) codec cannot encode a few N, so pick another one
+	do {
+		m_block_bytes = 2 * (1 + m_prng.Next() % (MAX_BLOCK_BYTES / 2));
+		m_n = 2 + m_prng.Next() % (MAX_N - 1);
+		m_bytes = m_n * m_block_bytes - m_prng.Next() % m_block_bytes;
+		m_final_bytes = m_bytes - (m_n - 1) * m_block_bytes;
+
+		for (int ii = 0; ii < m_bytes; ++ii) {
+			m_message[ii] = (u8)m_prng.Next();
+		}
+
+		encoder = wirehair_encode(encoder, m_message, m_bytes, m_block_bytes);
+	} while (!encoder);
+
+	return true;
+}
+
+// Decode from all of the original blocks in a random order, or from blocks with some lost
+static bool Decode(wirehair_state encoder, wirehair_state decoder, bool all_original) {
+	static u32 ids[MAX_N];
+	static u8 block[MAX_BLOCK_BYTES];
+
+	for (int ii = 0; ii < m_n; ++ii) {
+		ids[ii] = ii;
+	}
+	for (int ii = m_n - 1; ii > 0; --ii) {
+		const int jj = m_prng.Next() % (ii + 1);
+		const u32 id = ids[ii];
+		ids[ii] = ids[jj];
+		ids[jj] = id;
+	}
+
+	for (u32 ii = 0; ii < (u32)m_n * 4; ++ii) {
+		const u32 id = ii < (u32)m_n ? ids[ii] : ii;
+
+		if (!all_original && m_prng.Next() % 100 < LOSS_PERCENT) {
+			continue;
+		}
+
+		wirehair_write(encoder, id, block);
+		if (wirehair_read(decoder, id, block)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Check a range that was written at m_range against the reconstructed message
+static bool CheckRange(size_t offset, size_t bytes) {
+	if (memcmp(m_range, m_message_out + offset, bytes)) {
+		return false;
+	}
+
+	for (int ii = 0; ii < GUARD_BYTES; ++ii) {
+		if (m_range[bytes + ii] != GUARD) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Read [offset, offset + bytes) of block id
+static bool ReadBlockRange(wirehair_state decoder, u32 id, u32 offset, u32 bytes) {
+	memset(m_range, GUARD, MAX_BLOCK_BYTES + GUARD_BYTES);
+
+	return wirehair_reconstruct_range(decoder, id, offset, bytes, m_range) &&
+		CheckRange((size_t)id * m_block_bytes + offset, bytes);
+}
+
+// Read [offset, offset + bytes) of the message, split into two ranges read in one call
+static bool ReadMessageRange(wirehair_state decoder, size_t offset, size_t bytes) {
+	memset(m_range, GUARD, m_bytes + GUARD_BYTES);
+
+	const size_t first = bytes / 2;
+	size_t offsets[2] = { offset, offset + first };
+	size_t counts[2] = { first, bytes - first };
+	void *outs[2] = { m_range, m_range + first };
+
+	return wirehair_reconstruct_ranges(decoder, offsets, counts, outs, 2) &&
+		CheckRange(offset, bytes);
+}
+
+// Every range that goes past the end of its block or of the message is rejected
+static bool CheckOutOfBounds(wirehair_state decoder) {
+	const u32 last = m_n - 1;
+	const u32 block_bytes = m_block_bytes, final_bytes = m_final_bytes;
+
+	size_t offset = m_bytes, bytes = 1;
+	void *out = m_range;
+	size_t huge = (size_t)0 - 1;
+
+	return !wirehair_reconstruct_range(decoder, m_n, 0, 1, m_range) &&
+		!wirehair_reconstruct_range(decoder, 0xffffffff, 0, 1, m_range) &&
+		!wirehair_reconstruct_range(decoder, 0, 0, block_bytes + 1, m_range) &&
+		!wirehair_reconstruct_range(decoder, 0, 1, block_bytes, m_range) &&
+		!wirehair_reconstruct_range(decoder, 0, block_bytes + 1, 0, m_range) &&
+		!wirehair_reconstruct_range(decoder, 0, 2, 0xffffffff, m_range) &&
+		!wirehair_reconstruct_range(decoder, last, 0, final_bytes + 1, m_range) &&
+		!wirehair_reconstruct_range(decoder, last, final_bytes + 1, 0, m_range) &&
+		!wirehair_reconstruct_range(decoder, 0, 0, 1, 0) &&
+		!wirehair_reconstruct_ranges(decoder, &offset, &bytes, &out, 1) &&
+		!wirehair_reconstruct_ranges(decoder, &huge, &bytes, &out, 1) &&
+		!wirehair_reconstruct_ranges(decoder, &bytes, &huge, &out, 1) &&
+		!wirehair_reconstruct_ranges(decoder, &offset, &bytes, &out, -1);
+}
+
+static bool TestMessage(wirehair_state &encoder, wirehair_state &decoder, bool all_original) {
+	NewMessage(encoder);
+
+	decoder = wirehair_decode(decoder, m_bytes, m_block_bytes);
+	if (!decoder || !Decode(encoder, decoder, all_original)) {
+		return false;
+	}
+
+	if (!wirehair_reconstruct(decoder, m_message_out) || memcmp(m_message_out, m_message, m_bytes)) {
+		return false;
+	}
+
+	const u32 last = m_n - 1;
+	bool success = true;
+
+	// The whole short last block, and a range that ends with it
+	const u32 start = m_prng.Next() % m_final_bytes;
+	success = success && ReadBlockRange(decoder, last, 0, m_final_bytes);
+	success = success && ReadBlockRange(decoder, last, start, m_final_bytes - start);
+
+	// Zero-length ranges, including ones at the end of a block and of the message
+	success = success && ReadBlockRange(decoder, 0, 0, 0);
+	success = success && ReadBlockRange(decoder, 0, m_block_bytes, 0);
+	success = success && ReadBlockRange(decoder, last, m_final_bytes, 0);
+	success = success && ReadMessageRange(decoder, m_bytes, 0);
+
+	// The whole message
+	success = success && ReadMessageRange(decoder, 0, m_bytes);
+
+	// A range that crosses from the second to last block into the last one
+	const size_t tail = 1 + m_prng.Next() % m_block_bytes;
+	success = success && ReadMessageRange(decoder, (size_t)(last - 1) * m_block_bytes + m_block_bytes - tail, tail + 1);
+
+	// Random ranges of each block and of the message, which often cross blocks
+	for (int ii = 0; ii < RANGES && success; ++ii) {
+		const u32 id = m_prng.Next() % m_n;
+		const u32 block_bytes = id == last ? m_final_bytes : m_block_bytes;
+		const u32 offset = m_prng.Next() % (block_bytes + 1);
+		success = ReadBlockRange(decoder, id, offset, m_prng.Next() % (block_bytes - offset + 1));
+
+		const size_t message_offset = m_prng.Next() % (m_bytes + 1);
+		const size_t span = 3 * (size_t)m_block_bytes;
+		const size_t max_bytes = m_bytes - message_offset < span ? m_bytes - message_offset : span;
+		success = success && ReadMessageRange(decoder, message_offset, m_prng.Next() % (max_bytes + 1));
+	}
+
+	if (success && !CheckOutOfBounds(decoder)) {
+		cout << "A range out of bounds was accepted" << endl;
+		success = false;
+	}
+
+	return success;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	m_prng.Initialize(0);
+
+	m_message = new u8[MAX_N * MAX_BLOCK_BYTES];
+	m_message_out = new u8[MAX_N * MAX_BLOCK_BYTES];
+	m_range = new u8[MAX_N * MAX_BLOCK_BYTES + GUARD_BYTES];
+
+	wirehair_state encoder = 0, decoder = 0;
+	int failures = 0;
+
+	// Without losses the ranges are copied from the original blocks that were read
+	for (int all_original = 0; all_original < 2; ++all_original) {
+		int mode_failures = 0;
+
+		double t0 = m_clock.usec();
+
+		for (int trial = 0; trial < TRIALS; ++trial) {
+			if (!TestMessage(encoder, decoder, all_original != 0)) {
+				cout << "Range failed for N = " << m_n << ", block_bytes = " << m_block_bytes
+					<< ", bytes = " << m_bytes << endl;
+				++mode_failures;
+			}
+		}
+
+		double t1 = m_clock.usec();
+
+		cout << (all_original ? "All original blocks: " : "With losses: ") << TRIALS - mode_failures << " of "
+			<< TRIALS << " messages read back by range, " << (t1 - t0) / TRIALS << " usec/message" << endl;
+
+		failures += mode_failures;
+	}
+
+	wirehair_free(encoder);
+	wirehair_free(decoder);
+	delete []m_message;
+	delete []m_message_out;
+	delete []m_range;
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,242 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Number of messages to decode
+const int TRIALS = 400;
+
+// Message sizes are picked at random from N = 2..MAX_N blocks
+const int MAX_N = 1000;
+const int MAX_BLOCK_BYTES = 200;
+
+// Percentage of repair blocks lost on the way
+const int LOSS_PERCENT = 10;
+
+// Solving with N blocks rarely fails, so decode without seeding until it has
+const int FAILED_READS = 5;
+const int MAX_UNSEEDED = 20000;
+
+
+//// Message
+
+static Abyssinian m_prng;
+static wirehair_state m_encoder = 0;
+static wirehair_state m_decoder = 0;
+static u8 *m_message = 0;		// New version of the message, which is sent
+static u8 *m_message_out = 0;
+static int m_n, m_bytes, m_block_bytes;
+
+// Old version of the message that the receiver has, without padding after
+// the last block so that reading past the end of it is caught
+static u8 *m_old = 0;
+
+// Bitmap of the blocks that did not change, with one spare byte
+static u8 m_bitmap[(MAX_N + 7) / 8 + 1];
+
+// Blocks that changed, and the number of them
+static u32 m_changed[MAX_N];
+static int m_changed_count;
+
+// Blocks the decoder has stored, and whether wirehair_needed() agreed every time
+static int m_rows;
+static bool m_needed_ok;
+
+// Number of blocks read that left the decoder with N or more blocks and not done
+static int m_failed_reads = 0;
+
+static bool NewMessage() {
+	// The GF(2^16) codec cannot encode a few N, so pick another one
+	do {
+		m_block_bytes = 2 * (1 + m_prng.Next() % (MAX_BLOCK_BYTES / 2));
+		m_n = 2 + m_prng.Next() % (MAX_N - 1);
+		m_bytes = m_n * m_block_bytes - m_prng.Next() % m_block_bytes;
+
+		for (int ii = 0; ii < m_bytes; ++ii) {
+			m_message[ii] = (u8)m_prng.Next();
+		}
+
+		m_encoder = wirehair_encode(m_encoder, m_message, m_bytes, m_block_bytes);
+	} while (!m_encoder);
+
+	delete []m_old;
+	m_old = new u8[m_bytes];
+	memcpy(m_old, m_message, m_bytes);
+
+	// Bits past N, in the last partial byte and the spare byte, are garbage
+	for (int ii = 0; ii < (int)sizeof(m_bitmap); ++ii) {
+		m_bitmap[ii] = (u8)m_prng.Next();
+	}
+
+	// Change a random share of the blocks in the old version
+	const u32 percent = m_prng.Next() % 100;
+	m_changed_count = 0;
+
+	for (int id = 0; id < m_n; ++id) {
+		const int block_bytes = id == m_n - 1 ? m_bytes - id * m_block_bytes : m_block_bytes;
+
+		if (m_prng.Next() % 100 < percent) {
+			m_changed[m_changed_count++] = id;
+			m_bitmap[id >> 3] &= ~(1 << (id & 7));
+
+			for (int ii = 0; ii < block_bytes; ++ii) {
+				m_old[id * m_block_bytes + ii] ^= 1 + m_prng.Next() % 255;
+			}
+		} else {
+			m_bitmap[id >> 3] |= 1 << (id & 7);
+		}
+	}
+
+	m_decoder = wirehair_decode(m_decoder, m_bytes, m_block_bytes);
+
+	m_rows = 0;
+	m_needed_ok = m_decoder && wirehair_needed(m_decoder) == m_n;
+
+	return m_decoder != 0;
+}
+
+// Before N blocks the decoder needs the rest of them, and after that at least one until it is done
+static void CheckNeeded(bool complete) {
+	const int needed = wirehair_needed(m_decoder);
+
+	if (complete) {
+		m_needed_ok = m_needed_ok && needed == 0;
+	} else if (m_rows < m_n) {
+		m_needed_ok = m_needed_ok && needed == m_n - m_rows;
+	} else {
+		m_needed_ok = m_needed_ok && needed > 0;
+		++m_failed_reads;
+	}
+}
+
+// Write a block from the encoder and read it into the decoder
+static bool Read(u32 id) {
+	static u8 block[MAX_BLOCK_BYTES];
+
+	wirehair_write(m_encoder, id, block);
+
+	const bool complete = wirehair_read(m_decoder, id, block) != 0;
+
+	++m_rows;
+	CheckNeeded(complete);
+
+	return complete;
+}
+
+static bool TestMessage(bool seed) {
+	if (!NewMessage()) {
+		return false;
+	}
+
+	bool complete = false;
+	u32 first_id = 0;
+
+	if (seed) {
+		// Read a few of the changed blocks before seeding, which are left out of the bitmap
+		const int early = m_prng.Next() % 3;
+		int changed_i = 0;
+
+		for (; changed_i < m_changed_count && changed_i < early && !complete; ++changed_i) {
+			complete = Read(m_changed[changed_i]);
+		}
+
+		if (!complete) {
+			complete = wirehair_seed_known(m_decoder, m_bitmap, m_old) != 0;
+
+			m_rows += m_n - m_changed_count;
+			CheckNeeded(complete);
+		}
+
+		// The blocks are copied while seeding, so the old version is not read again
+		memset(m_old, 0x55, m_bytes);
+
+		// Then the rest of the changed blocks, and repair blocks until it is done
+		for (; changed_i < m_changed_count && !complete; ++changed_i) {
+			complete = Read(m_changed[changed_i]);
+		}
+
+		first_id = m_n;
+	}
+
+	for (u32 id = first_id; !complete && id < (u32)m_n * 4; ++id) {
+		if (m_prng.Next() % 100 >= LOSS_PERCENT) {
+			complete = Read(id);
+		}
+	}
+
+	return complete && m_needed_ok &&
+		wirehair_reconstruct(m_decoder, m_message_out) &&
+		!memcmp(m_message_out, m_message, m_bytes) &&
+		wirehair_needed(m_decoder) == 0;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	m_prng.Initialize(0);
+
+	m_message = new u8[MAX_N * MAX_BLOCK_BYTES];
+	m_message_out = new u8[MAX_N * MAX_BLOCK_BYTES];
+
+	int failures = 0;
+
+	double t0 = m_clock.usec();
+
+	for (int trial = 0; trial < TRIALS; ++trial) {
+		if (!TestMessage(true)) {
+			cout << "Seeded decode failed for N = " << m_n << ", block_bytes = " << m_block_bytes
+				<< ", changed = " << m_changed_count << endl;
+			++failures;
+		}
+	}
+
+	double t1 = m_clock.usec();
+
+	cout << "Seeded decoder: " << TRIALS - failures << " of " << TRIALS << " decoded, "
+		<< (t1 - t0) / TRIALS << " usec/message" << endl;
+
+	// Check wirehair_needed() after solving with N blocks fails
+	int unseeded = 0;
+	for (; m_failed_reads < FAILED_READS && unseeded < MAX_UNSEEDED; ++unseeded) {
+		if (!TestMessage(false)) {
+			cout << "Decode failed for N = " << m_n << ", block_bytes = " << m_block_bytes << endl;
+			++failures;
+		}
+	}
+
+	cout << "Blocks needed: checked " << m_failed_reads << " blocks read after N in " << unseeded << " messages" << endl;
+
+	if (m_failed_reads < FAILED_READS) {
+		++failures;
+	}
+
+	wirehair_free(m_encoder);
+	wirehair_free(m_decoder);
+	delete []m_message;
+	delete []m_message_out;
+	delete []m_old;
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
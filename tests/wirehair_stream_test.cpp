@@ -0,0 +1,269 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Stream parameters
+const int WINDOW = 64;
+const int BLOCK_BYTES = 200;
+
+// Number of source packets sent in each case
+const int PACKET_COUNT = 20000;
+
+// Packets in flight are delivered from this many slots at random, so they arrive out of order
+const int REORDER_SLOTS = 8;
+
+// Packets held longer than this are delivered anyway, so none arrives after it was given up on
+const u32 MAX_REORDER = WINDOW / 2;
+
+
+//// Packets
+
+struct Packet {
+	bool repair;
+	u32 seq;		// Sequence number, or last sequence number of a repair window
+	u32 index;		// Repair index
+	u8 data[BLOCK_BYTES];
+};
+
+// Contents of a source packet, which the receiver can check
+static void SourcePacket(u32 seq, u8 *packet) {
+	Abyssinian prng;
+	prng.Initialize(seq, 7);
+
+	for (int ii = 0; ii < BLOCK_BYTES; ++ii) {
+		packet[ii] = (u8)prng.Next();
+	}
+}
+
+
+//// Receiver
+
+struct Stats {
+	u32 sent;			// Source packets sent
+	u32 lost;			// Source packets lost on the way
+	u32 popped;			// Source packets released in order
+	u32 recovered;		// Lost source packets that were released
+	u32 skipped;		// Source packets given up on
+	u32 mismatches;		// Released packets that are wrong or out of order
+	u64 delay_sum;		// Later source packets sent before each packet was released
+	u32 delay_max;
+};
+
+static wirehair_stream m_decoder = 0;
+static bool m_lost[PACKET_COUNT];
+static u32 m_start;		// Sequence number of the first packet
+static u32 m_next;		// Next packet expected from wirehair_stream_pop(), counting from the first
+
+static void Deliver(const Packet &packet, Stats &stats) {
+	if (packet.repair) {
+		wirehair_stream_read_repair(m_decoder, packet.seq, packet.index, packet.data);
+	} else {
+		wirehair_stream_read(m_decoder, packet.seq, packet.data);
+	}
+
+	u8 expected[BLOCK_BYTES], block[BLOCK_BYTES];
+	unsigned int wire_seq;
+
+	while (wirehair_stream_pop(m_decoder, &wire_seq, block)) {
+		SourcePacket(wire_seq, expected);
+
+		// Sequence numbers may wrap around during the stream
+		const u32 seq = wire_seq - m_start;
+
+		if (seq < m_next || seq >= stats.sent || memcmp(block, expected, BLOCK_BYTES)) {
+			++stats.mismatches;
+			continue;
+		}
+
+		stats.skipped += seq - m_next;
+		m_next = seq + 1;
+
+		++stats.popped;
+		if (m_lost[seq]) {
+			++stats.recovered;
+		}
+
+		const u32 delay = stats.sent - 1 - seq;
+		stats.delay_sum += delay;
+		if (stats.delay_max < delay) {
+			stats.delay_max = delay;
+		}
+	}
+}
+
+
+//// Cases
+
+// Send the stream with one repair packet after every repair_interval source packets
+static bool TestStream(int loss_percent, int repair_interval, bool reorder, bool must_recover_all, u32 start = 0) {
+	Stats stats;
+	memset(&stats, 0, sizeof(stats));
+	memset(m_lost, 0, sizeof(m_lost));
+	m_start = start;
+	m_next = 0;
+
+	Abyssinian prng;
+	prng.Initialize(loss_percent, repair_interval);
+
+	wirehair_stream encoder = wirehair_stream_encoder(WINDOW, BLOCK_BYTES);
+	m_decoder = wirehair_stream_decoder(WINDOW, BLOCK_BYTES);
+	if (!encoder || !m_decoder) {
+		cout << "wirehair_stream_encoder/decoder failed" << endl;
+		return false;
+	}
+
+	if (start && (!wirehair_stream_start(encoder, start) || !wirehair_stream_start(m_decoder, start))) {
+		cout << "wirehair_stream_start failed" << endl;
+		return false;
+	}
+
+	static Packet slots[REORDER_SLOTS];
+	bool full[REORDER_SLOTS] = { false };
+	u32 held_since[REORDER_SLOTS];
+
+	double t0 = m_clock.usec();
+
+	for (u32 seq = 0; seq < (u32)PACKET_COUNT; ++seq) {
+		const bool repair_next = (seq + 1) % repair_interval == 0;
+
+		for (int ii = 0; ii < (repair_next ? 2 : 1); ++ii) {
+			Packet packet;
+
+			if (ii == 0) {
+				packet.repair = false;
+				packet.seq = start + seq;
+				SourcePacket(packet.seq, packet.data);
+				wirehair_stream_add(encoder, packet.data);
+				++stats.sent;
+			} else {
+				packet.repair = true;
+				if (!wirehair_stream_repair(encoder, &packet.seq, &packet.index, packet.data)) {
+					return false;
+				}
+			}
+
+			if ((int)(prng.Next() % 100) < loss_percent) {
+				if (!packet.repair) {
+					m_lost[seq] = true;
+					++stats.lost;
+				}
+				continue;
+			}
+
+			if (!reorder) {
+				Deliver(packet, stats);
+				continue;
+			}
+
+			// Deliver packets that were held too long
+			for (int slot = 0; slot < REORDER_SLOTS; ++slot) {
+				if (full[slot] && seq - held_since[slot] > MAX_REORDER) {
+					Deliver(slots[slot], stats);
+					full[slot] = false;
+				}
+			}
+
+			// Put the packet in a random slot, and deliver the one that was there
+			const int slot = prng.Next() % REORDER_SLOTS;
+			if (full[slot]) {
+				Deliver(slots[slot], stats);
+			}
+			slots[slot] = packet;
+			full[slot] = true;
+			held_since[slot] = seq;
+		}
+	}
+
+	// Deliver what is still in flight, and then enough repair packets to cover the tail
+	for (int slot = 0; slot < REORDER_SLOTS; ++slot) {
+		if (full[slot]) {
+			Deliver(slots[slot], stats);
+		}
+	}
+	for (int ii = 0; ii < WINDOW && m_next < stats.sent; ++ii) {
+		Packet packet;
+		packet.repair = true;
+		wirehair_stream_repair(encoder, &packet.seq, &packet.index, packet.data);
+		Deliver(packet, stats);
+	}
+
+	double t1 = m_clock.usec();
+
+	// Whatever is left at the end of the stream was never released
+	stats.skipped += stats.sent - m_next;
+
+	wirehair_stream_free(encoder);
+	wirehair_stream_free(m_decoder);
+	m_decoder = 0;
+
+	cout << loss_percent << "% loss, " << 100 / repair_interval << "% repair, " << (reorder ? "reordered" : "in order")
+		<< (start ? ", wrapped" : "") << ": recovered "
+		<< stats.recovered << " of " << stats.lost << " lost, skipped " << stats.skipped
+		<< ", delay " << (double)stats.delay_sum / stats.popped << " avg " << stats.delay_max
+		<< " max packets, " << (t1 - t0) / PACKET_COUNT << " usec/packet" << endl;
+
+	if (stats.mismatches) {
+		cout << stats.mismatches << " packets released out of order or wrong" << endl;
+		return false;
+	}
+
+	// Every packet is either released or skipped, and one that arrived is never skipped
+	if (stats.popped + stats.skipped != stats.sent || stats.popped < stats.sent - stats.lost) {
+		return false;
+	}
+
+	return !must_recover_all || stats.skipped == 0;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	int failures = 0;
+
+	for (int reorder = 0; reorder < 2; ++reorder) {
+		if (!TestStream(0, 4, reorder != 0, true)) {
+			++failures;
+		}
+		if (!TestStream(5, 4, reorder != 0, true)) {
+			++failures;
+		}
+		if (!TestStream(10, 4, reorder != 0, false)) {
+			++failures;
+		}
+
+		// More loss than repair, so some packets are skipped
+		if (!TestStream(30, 4, reorder != 0, false)) {
+			++failures;
+		}
+
+		// Sequence numbers wrap around in the middle of the stream
+		if (!TestStream(5, 4, reorder != 0, true, 0u - PACKET_COUNT / 2)) {
+			++failures;
+		}
+	}
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}
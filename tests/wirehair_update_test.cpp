@@ -0,0 +1,182 @@
+#include "wirehair.h"
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+using namespace cat;
+
+#include <iostream>
+#include <cstring>
+using namespace std;
+
+static Clock m_clock;
+
+
+// Number of messages to update
+const int TRIALS = 200;
+
+// Message sizes are picked at random from N = 2..MAX_N blocks
+const int MAX_N = 2000;
+const int MAX_BLOCK_BYTES = 400;
+
+// Rounds of updates for each message, and blocks replaced in each round
+const int ROUNDS = 4;
+const int MAX_UPDATES = 8;
+
+// Repair blocks compared after each round
+const int REPAIR_COUNT = 50;
+
+
+//// Message
+
+static Abyssinian m_prng;
+static u8 *m_message = 0;		// Message as the encoder was created with
+static u8 *m_current = 0;		// Message with all of the updates so far
+static int m_n, m_bytes, m_block_bytes;
+
+// Number of bytes in block id, which is short at the end of the message
+static int BlockSize(u32 id) {
+	return id == (u32)m_n - 1 ? m_bytes - (m_n - 1) * m_block_bytes : m_block_bytes;
+}
+
+static wirehair_state NewMessage() {
+	// The GF(2^16) codec cannot encode a few N, so pick another one
+	wirehair_state encoder;
+	do {
+		m_block_bytes = 2 * (1 + m_prng.Next() % (MAX_BLOCK_BYTES / 2));
+		m_n = 2 + m_prng.Next() % (MAX_N - 1);
+		m_bytes = m_n * m_block_bytes - m_prng.Next() % m_block_bytes;
+
+		for (int ii = 0; ii < m_bytes; ++ii) {
+			m_message[ii] = (u8)m_prng.Next();
+		}
+
+		encoder = wirehair_encode(0, m_message, m_bytes, m_block_bytes);
+	} while (!encoder);
+
+	memcpy(m_current, m_message, m_bytes);
+
+	// Updates drop precomputed blocks, so have some to drop
+	if (m_prng.Next() % 2) {
+		wirehair_precompute(encoder, m_n, 16);
+	}
+
+	return encoder;
+}
+
+// Replace a few blocks at random and update the encoder
+static bool Update(wirehair_state encoder) {
+	static u8 blocks[MAX_UPDATES][MAX_BLOCK_BYTES];
+	const void *pointers[MAX_UPDATES];
+	u32 ids[MAX_UPDATES];
+
+	const int count = 1 + m_prng.Next() % MAX_UPDATES;
+
+	for (int ii = 0; ii < count; ++ii) {
+		// The last block is picked more often, since it is short
+		ids[ii] = m_prng.Next() % 4 ? m_prng.Next() % m_n : m_n - 1;
+
+		for (int jj = 0; jj < m_block_bytes; ++jj) {
+			blocks[ii][jj] = (u8)m_prng.Next();
+		}
+		pointers[ii] = blocks[ii];
+
+		memcpy(m_current + ids[ii] * m_block_bytes, blocks[ii], BlockSize(ids[ii]));
+	}
+
+	return wirehair_update_blocks(encoder, ids, pointers, count) != 0;
+}
+
+// Compare original and repair blocks against a fresh encoder for the current message
+static bool Compare(wirehair_state encoder) {
+	u8 expected[MAX_BLOCK_BYTES], block[MAX_BLOCK_BYTES];
+
+	wirehair_state fresh = wirehair_encode(0, m_current, m_bytes, m_block_bytes);
+	if (!fresh) {
+		return false;
+	}
+
+	bool matched = true;
+	for (u32 id = 0; id < (u32)m_n + REPAIR_COUNT && matched; ++id) {
+		wirehair_write(encoder, id, block);
+		wirehair_write(fresh, id, expected);
+
+		const int bytes = id < (u32)m_n ? BlockSize(id) : m_block_bytes;
+		matched = !memcmp(block, expected, bytes);
+	}
+
+	wirehair_free(fresh);
+
+	return matched;
+}
+
+static bool TestMessage() {
+	wirehair_state encoder = NewMessage();
+
+	bool success = true;
+	for (int round = 0; round < ROUNDS && success; ++round) {
+		success = Update(encoder);
+
+		// The encoder has its own copy after the first update
+		if (round == 0) {
+			memset(m_message, 0xaa, m_bytes);
+		}
+
+		success = success && Compare(encoder);
+	}
+
+	// A trimmed encoder no longer has the message, so it cannot be updated
+	if (success) {
+		u32 id = 0;
+		const void *block = m_current;
+
+		success = wirehair_trim(encoder) && !wirehair_update_blocks(encoder, &id, &block, 1);
+	}
+
+	wirehair_free(encoder);
+
+	return success;
+}
+
+
+//// Entrypoint
+
+int main() {
+	if (!wirehair_init()) {
+		cout << "wirehair_init failed" << endl;
+		return 1;
+	}
+
+	m_clock.OnInitialize();
+
+	m_prng.Initialize(0);
+
+	m_message = new u8[MAX_N * MAX_BLOCK_BYTES];
+	m_current = new u8[MAX_N * MAX_BLOCK_BYTES];
+
+	int failures = 0;
+
+	double t0 = m_clock.usec();
+
+	for (int trial = 0; trial < TRIALS; ++trial) {
+		if (!TestMessage()) {
+			cout << "Update failed for N = " << m_n << ", block_bytes = " << m_block_bytes << endl;
+			++failures;
+		}
+	}
+
+	double t1 = m_clock.usec();
+
+	cout << "Updated encoder: " << TRIALS - failures << " of " << TRIALS << " matched a fresh encoder over "
+		<< ROUNDS << " rounds, " << (t1 - t0) / TRIALS << " usec/message" << endl;
+
+	delete []m_message;
+	delete []m_current;
+
+	m_clock.OnFinalize();
+
+	if (failures) {
+		cout << "*** FAILED ***" << endl;
+		return 1;
+	}
+
+	return 0;
+}